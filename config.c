@@ -22,6 +22,9 @@
 #include "qrouter.h"
 #include "config.h"
 #include "lef.h"
+#include "node.h"
+#include "mem.h"
+#include "hash.h"
 
 int    CurrentPin = 0;
 int    Firstcall = TRUE;
@@ -43,6 +46,26 @@ char	StackedContacts = MAX_LAYERS;	// Value is number of contacts that may
 					// be stacked on top of each other.
 char	ViaPattern = VIA_PATTERN_NONE;	// Patterning to be used for vias based
 					// on grid position (i.e., checkerboarding)
+char	SearchMode = SEARCH_STACK;	// Order in which route_segs() expands
+					// grid positions (stack or heap)
+char	SearchCorridor = FALSE;		// If TRUE, search first within a mask
+					// around the net, expanding on failure
+char	SearchSteiner = FALSE;		// If TRUE, continue one search for all
+					// connections of a net
+char	NetOrderMode = ORDER_PINS;	// Key by which nets are ordered for
+					// routing
+int	RouteThreads = 1;		// Number of threads for the first
+					// routing stage
+int	RouteHalo = 10;			// Grid positions around the taps of a
+					// net that its parallel search may use
+char	ParallelMode = PARALLEL_REGIONS;	// How the first stage is split
+					// among threads
+int	NegotiatePasses = 0;		// Passes of negotiated congestion
+					// routing before rip-up and reroute
+char	GlobalRoute = FALSE;		// If TRUE, route on a coarse grid of
+					// tiles first, to limit each search
+int	GlobalTile = 0;			// Size of the tiles in grid positions,
+					// or 0 for the DEF GCELLGRID
 
 double  Xlowerbound=0.0;		// Bounding Box of routes, in microns
 double  Xupperbound=0.0;      
@@ -57,6 +80,15 @@ int     BlockCost = 25;            // Cost of a crossover when node has
 				   // only one tap point
 int 	ConflictCost = 50;	   // Cost of shorting another route
 				   // during the rip-up and reroute stage
+int	CongestionCost = 0;	   // Cost of crossing a tile estimated
+				   // to be fully used
+char	*CongestionFile = NULL;	   // Prefix of the congestion map files
+char	*ScratchDir = NULL;	   // Directory of the files backing the
+				   // grids, or NULL to keep them in memory
+int	ShareCost = 10;		   // Cost of sharing a position with
+				   // another route, first negotiation pass
+int	HistoryCost = 10;	   // Cost added to a position for each
+				   // pass that ended with it shared
 
 char    *ViaX[MAX_LAYERS];
 char    *ViaY[MAX_LAYERS];
@@ -115,6 +147,14 @@ int read_config(FILE *fconfig)
 	lineptr = line;
 	while (isspace(*lineptr)) lineptr++;
 
+	// Skip comments and blank lines before matching any keyword;
+	// several keywords are found anywhere in the line, and would
+	// otherwise match the commented examples.
+	if ((*lineptr == '#') || (*lineptr == '\0')) {
+	    line[0] = line[1] = '\0';
+	    continue;
+	}
+
 	if (!strncasecmp(lineptr, "lef", 3)) {
 	    if ((i = sscanf(lineptr, "%*s %s\n", sarg)) == 1) {
 	       // Argument is a filename of a LEF file from which we
@@ -124,6 +164,24 @@ int read_config(FILE *fconfig)
 	    }
 	}
 
+	// "congestion map <prefix>" writes the estimated congestion of
+	// each layer, before routing, to <prefix>_<layer>.csv.
+	if (!strncasecmp(lineptr, "congestion map", 14)) {
+	    if ((i = sscanf(lineptr, "%*s %*s %s\n", sarg)) == 1) {
+	       OK = 1;
+	       CongestionFile = strdup(sarg);
+	    }
+	}
+
+	// "scratch directory <dir>" keeps the grids in files made in
+	// <dir>, mapped into memory (see mem.c).
+	if (!strncasecmp(lineptr, "scratch directory", 17)) {
+	    if ((i = sscanf(lineptr, "%*s %*s %s\n", sarg)) == 1) {
+	       OK = 1;
+	       ScratchDir = strdup(sarg);
+	    }
+	}
+
 	// The remainder of the statements is not case sensitive.
 
 	for (i = 0; line[i] && i < MAXLINE - 1; i++) {
@@ -232,10 +290,22 @@ int read_config(FILE *fconfig)
 	    OK = 1; BlockCost = iarg;
 	}
 
+	if ((i = sscanf(lineptr, "route congestion cost %d", &iarg)) == 1) {
+	    OK = 1; CongestionCost = iarg;
+	}
+
+	if ((i = sscanf(lineptr, "route share cost %d", &iarg)) == 1) {
+	    OK = 1; ShareCost = iarg;
+	}
+
+	if ((i = sscanf(lineptr, "route history cost %d", &iarg)) == 1) {
+	    OK = 1; HistoryCost = iarg;
+	}
+
 	if ((i = sscanf(lineptr, "do not route node %s\n", sarg)) == 1) {
 	    OK = 1; 
 	    dnr = (STRING)malloc(sizeof(struct string_));
-	    dnr->name = strdup(sarg);
+	    dnr->name = name_intern(sarg);
 	    if (DontRoute != NULL) {
 	       for (strl = DontRoute; strl->next; strl = strl->next);
 	       strl->next = dnr;
@@ -249,7 +319,7 @@ int read_config(FILE *fconfig)
 	if ((i = sscanf(lineptr, "route priority %s\n", sarg)) == 1) {
 	    OK = 1; 
 	    cn = (STRING)malloc(sizeof(struct string_));
-	    cn->name = strdup(sarg);
+	    cn->name = name_intern(sarg);
 	    if (CriticalNet != NULL) {
 	       for (strl = CriticalNet; strl->next; strl = strl->next);
 	       strl->next = cn;
@@ -263,7 +333,7 @@ int read_config(FILE *fconfig)
 	if ((i = sscanf(lineptr, "critical net %s\n", sarg)) == 1) {
 	    OK = 1; 
 	    cn = (STRING)malloc(sizeof(struct string_));
-	    cn->name = strdup(sarg);
+	    cn->name = name_intern(sarg);
 	    if (CriticalNet != NULL) {
 	       for (strl = CriticalNet; strl->next; strl = strl->next);
 	       strl->next = cn;
@@ -303,10 +373,106 @@ int read_config(FILE *fconfig)
 		ViaPattern = VIA_PATTERN_INVERT;
  	}
 
+	// Look for search mode specifications.  "heap" expands grid
+	// positions in order of increasing cost;  "astar" adds an estimate
+	// of the remaining cost to the target;  "dial" is the same as
+	// "heap" but uses a bucket queue;  "stack" is the original
+	// depth-first search.
+	if (strcasestr(lineptr, "search mode") != NULL) {
+	    if (strcasestr(lineptr + 11, "dial") != NULL) {
+		OK = 1; SearchMode = SEARCH_DIAL;
+	    }
+	    else if (strcasestr(lineptr + 11, "astar") != NULL) {
+		OK = 1; SearchMode = SEARCH_ASTAR;
+	    }
+	    else if (strcasestr(lineptr + 11, "heap") != NULL) {
+		OK = 1; SearchMode = SEARCH_HEAP;
+	    }
+	    else if (strcasestr(lineptr + 11, "stack") != NULL) {
+		OK = 1; SearchMode = SEARCH_STACK;
+	    }
+ 	}
+
+	// "search corridor" restricts the search to the area around the
+	// net given by createMask(), widening it on each failed pass.
+	if (strcasestr(lineptr, "search corridor") != NULL) {
+	    OK = 1; SearchCorridor = TRUE;
+	}
+
+	// "search steiner" continues the search for each net after
+	// each connection is made, with the new route added to the
+	// source, rather than starting it over.  It applies to the
+	// "heap", "astar", and "dial" modes, without "search corridor".
+	if (strcasestr(lineptr, "search steiner") != NULL) {
+	    OK = 1; SearchSteiner = TRUE;
+	}
+
+	// "threads N" routes the first stage with N threads, each
+	// taking nets whose areas do not overlap.  The area of a net
+	// is the extent of its taps, widened by "route halo N" grid
+	// positions on each side (see parallel.c).
+	if ((i = sscanf(lineptr, "threads %d", &iarg)) == 1) {
+	    OK = 1; RouteThreads = (iarg < 1) ? 1 : iarg;
+	}
+
+	if ((i = sscanf(lineptr, "route halo %d", &iarg)) == 1) {
+	    OK = 1; RouteHalo = (iarg < 0) ? 0 : iarg;
+	}
+
+	// "parallel mode speculative" instead routes the next nets of
+	// the queue at once, each against the grid as it was before
+	// any of them, and keeps each route only if no net before it
+	// changed the area its search read.  Others are routed again
+	// in turn.  The routes are the same as with one thread.
+	if (strcasestr(lineptr, "parallel mode") != NULL) {
+	    if (strcasestr(lineptr + 13, "speculative") != NULL) {
+		OK = 1; ParallelMode = PARALLEL_SPECULATIVE;
+	    }
+	    else if (strcasestr(lineptr + 13, "regions") != NULL) {
+		OK = 1; ParallelMode = PARALLEL_REGIONS;
+	    }
+	}
+
+	// "negotiate N" routes the nets that failed the first stage
+	// in up to N passes of negotiated congestion routing, before
+	// the rip-up and reroute stage (see negotiate.c).
+	if ((i = sscanf(lineptr, "negotiate %d", &iarg)) == 1) {
+	    OK = 1; NegotiatePasses = (iarg < 0) ? 0 : iarg;
+	}
+
+	// "global route" routes all nets on a coarse grid of tiles
+	// before the detailed routing, and searches each net first
+	// within the tiles it was routed through (see global.c).
+	// The tiles are "global tile N" grid positions on a side.
+	if (strcasestr(lineptr, "global route") != NULL) {
+	    OK = 1; GlobalRoute = TRUE;
+	}
+
+	if ((i = sscanf(lineptr, "global tile %d", &iarg)) == 1) {
+	    OK = 1; GlobalTile = (iarg < 0) ? 0 : iarg;
+	}
+
+	// Look for the net ordering key.  "pins" routes the nets with
+	// the most nodes first;  "length" routes those with the smallest
+	// bounding box first;  "congestion" routes those in the areas
+	// estimated to be most congested first.  Critical nets are
+	// always routed first.
+	if (strcasestr(lineptr, "net order") != NULL) {
+	    if (strcasestr(lineptr + 9, "pins") != NULL) {
+		OK = 1; NetOrderMode = ORDER_PINS;
+	    }
+	    else if (strcasestr(lineptr + 9, "length") != NULL) {
+		OK = 1; NetOrderMode = ORDER_LENGTH;
+	    }
+	    else if (strcasestr(lineptr + 9, "congestion") != NULL) {
+		OK = 1; NetOrderMode = ORDER_CONGESTION;
+	    }
+ 	}
+
 	if ((i = sscanf(lineptr, "obstruction %lf %lf %lf %lf %s\n",
 			&darg, &darg2, &darg3, &darg4, sarg)) == 5) {
 	    OK = 1;
-	    drect = (DSEG)malloc(sizeof(struct dseg_));
+	    drect = (DSEG)mem_malloc(MEM_GEOMETRY, sizeof(struct dseg_));
 	    drect->x1 = darg;
 	    drect->y1 = darg2;
 	    drect->x2 = darg3;
@@ -325,16 +491,21 @@ int read_config(FILE *fconfig)
 		UserObs = drect;
 	    }
 	    else {
-		free(drect);
+		mem_free(MEM_GEOMETRY, drect, sizeof(struct dseg_));
 	    }
 	}
 
 	if ((i = sscanf(lineptr, "gate %s %lf %lf\n", sarg, &darg, &darg2)) == 3) {
 	    OK = 1; 
 	    CurrentPin = 0;
-	    gateinfo = (GATE)malloc(sizeof(struct gate_));
-	    gateinfo->gatetype = strdup(sarg);
+	    gateinfo = (GATE)mem_malloc(MEM_NETLIST, sizeof(struct gate_));
+	    gateinfo->gatetype = name_intern(sarg);
 	    gateinfo->gatename = NULL;
+	    gateinfo->nodes = 0;
+	    gateinfo->node = NULL;
+	    gateinfo->netnum = NULL;
+	    gateinfo->noderec = NULL;
+	    gateinfo->taps = NULL;
 	    gateinfo->width = darg;
 	    gateinfo->height = darg2;
 	    gateinfo->placedX = 0.0;	// implicit cell origin
@@ -345,7 +516,6 @@ int read_config(FILE *fconfig)
 	
         if ((i = sscanf(lineptr, "endgate %s\n", sarg)) == 1) {
 	    OK = 1; 
-	    gateinfo->nodes = CurrentPin;
 
 	    // This syntax does not include declaration of obstructions
 	    gateinfo->obs = (DSEG)NULL;
@@ -354,12 +524,13 @@ int read_config(FILE *fconfig)
 
 	if ((i = sscanf(lineptr, "pin %s %lf %lf\n", sarg, &darg, &darg2)) == 3) {
 	    OK = 1; 
-	    gateinfo->node[CurrentPin] = strdup(sarg);
+	    gate_add_pins(gateinfo, CurrentPin + 1);
+	    gateinfo->node[CurrentPin] = name_intern(sarg);
 
 	    // These style gates have only one tap per gate;  LEF file reader
 	    // allows multiple taps per gate node.
 
-	    drect = (DSEG)malloc(sizeof(struct dseg_));
+	    drect = (DSEG)mem_malloc(MEM_GEOMETRY, sizeof(struct dseg_));
 	    gateinfo->taps[CurrentPin] = drect;
 	    drect->x1 = drect->x2 = darg;
 	    drect->y1 = drect->y2 = darg2;
@@ -372,11 +543,8 @@ int read_config(FILE *fconfig)
 	    CurrentPin++;
 	}
 
-	if (OK == 0) {
-	    if (!(lineptr[0] == '\n' || lineptr[0] == '#' || lineptr[0] == 0)) {
-		fprintf(stderr, "line not understood: %s\n", line);
-	    }
-	}
+	if (OK == 0)
+	    fprintf(stderr, "line not understood: %s\n", line);
 	OK = 0;
 	line[0] = line[1] = '\0';
     }
@@ -419,3 +587,30 @@ int read_config(FILE *fconfig)
 
 } /* read_config() */
 
+/*--------------------------------------------------------------*/
+/* max_step_cost - the most that eval_pt() can add to a route	*/
+/*	cost in a single step outside negotiated routing:  the	*/
+/*	largest of the segment, jog and via costs, plus a	*/
+/*	crossover or block cost from the layers above and	*/
+/*	below, plus the conflict cost (which eval_pt() may	*/
+/*	apply twice in the rip-up stage), plus the congestion	*/
+/*	cost of the most congested tile.  The negotiated cost	*/
+/*	grows from pass to pass, so the value is only the	*/
+/*	number of buckets a Dial queue starts with; pq_push()	*/
+/*	adds more when a step costs more.			*/
+/*								*/
+/*      RETURNS: maximum cost of one step			*/
+/*--------------------------------------------------------------*/
+
+int max_step_cost()
+{
+    int stepcost;
+
+    stepcost = MAX(SegCost, JogCost);
+    stepcost = MAX(stepcost, ViaCost);
+    stepcost += 2 * MAX(XverCost, BlockCost);
+    stepcost += 2 * ConflictCost;
+    stepcost += (int)(CongestionCost * MAX_CONGESTION / ORDER_TILE + 0.5);
+    return stepcost;
+}
+
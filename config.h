@@ -25,6 +25,16 @@ extern int     Vert[MAX_LAYERS];        // 1 if verticle, 0 if horizontal
 extern int     Numpasses;               // number of times to iterate in route_segs
 extern char    StackedContacts;	  	// Number of vias that can be stacked together
 extern char    ViaPattern;		// Type of via patterning to use
+extern char    SearchMode;		// Type of wavefront search to use
+extern char    SearchCorridor;		// Restrict search to a mask around the net
+extern char    SearchSteiner;		// Keep the search alive across connections
+extern char    NetOrderMode;		// Key used to order nets for routing
+extern int     RouteThreads;		// Threads for the first routing stage
+extern int     RouteHalo;		// Search area of a net around its taps
+extern char    ParallelMode;		// How the first stage uses threads
+extern int     NegotiatePasses;		// Negotiated congestion routing passes
+extern char    GlobalRoute;		// Route on a coarse grid of tiles first
+extern int     GlobalTile;		// Tile size for global routing
 
 extern double  Xlowerbound;  // Bounding Box of routes
 extern double  Xupperbound;      
@@ -37,11 +47,17 @@ extern int     JogCost;
 extern int     XverCost;
 extern int     BlockCost;
 extern int     ConflictCost;
+extern int     CongestionCost;
+extern char    *CongestionFile;
+extern char    *ScratchDir;
+extern int     ShareCost;
+extern int     HistoryCost;
 
 extern char    *ViaX[MAX_LAYERS];
 extern char    *ViaY[MAX_LAYERS];
 
 int  read_config(FILE *configfileptr);
+int  max_step_cost();
 
 #define CONFIG_H
 #endif 
@@ -31,6 +31,195 @@
 #include "config.h"
 #include "maze.h"
 #include "lef.h"
+#include "hash.h"
+#include "mem.h"
+
+/* Indexes of instances (including pins) and of macros by name,	*/
+/* built while reading the DEF file.  Names are not case-	*/
+/* sensitive, as elsewhere in the LEF and DEF readers.		*/
+
+struct hashtable_ InstanceTable;
+struct hashtable_ MacroTable;
+
+/*
+ *------------------------------------------------------------
+ *
+ * DefHashMacros --
+ *
+ *	Index all macros in GateInfo by name.  Where two
+ *	macros have the same name, the one earlier in the
+ *	list is found, as with a linear search.
+ *
+ *------------------------------------------------------------
+ */
+
+void
+DefHashMacros()
+{
+    GATE gateginfo;
+
+    hash_init(&MacroTable, 0, TRUE);
+    for (gateginfo = GateInfo; gateginfo; gateginfo = gateginfo->next)
+	if (hash_lookup(&MacroTable, gateginfo->gatetype) == NULL)
+	    hash_insert(&MacroTable, gateginfo->gatetype, gateginfo);
+}
+
+/*
+ *------------------------------------------------------------
+ *
+ * DefHashMacroNodes --
+ *
+ *	Index the pin names of a macro, if not done already.
+ *	The index is kept with the macro in GateInfo.
+ *
+ *------------------------------------------------------------
+ */
+
+void
+DefHashMacroNodes(GATE gateginfo)
+{
+    int i;
+
+    if (gateginfo->nodetable != NULL) return;
+
+    gateginfo->nodetable = (HASHTABLE)malloc(sizeof(struct hashtable_));
+    hash_init(gateginfo->nodetable, gateginfo->nodes, TRUE);
+    for (i = 0; i < gateginfo->nodes; i++)
+	if ((gateginfo->node[i] != NULL) &&
+		(hash_lookup(gateginfo->nodetable, gateginfo->node[i]) == NULL))
+	    hash_insert(gateginfo->nodetable, gateginfo->node[i],
+			&gateginfo->node[i]);
+}
+
+/*
+ *------------------------------------------------------------
+ *
+ * DefFindMacroNode --
+ *
+ *	Find a pin of a macro by name.
+ *
+ * Results:
+ *	Index of the pin in the macro's node[] array, or -1
+ *	if the macro has no such pin.
+ *
+ *------------------------------------------------------------
+ */
+
+int
+DefFindMacroNode(GATE gateginfo, char *pinname)
+{
+    char **nodeptr;
+
+    DefHashMacroNodes(gateginfo);
+    nodeptr = (char **)hash_lookup(gateginfo->nodetable, pinname);
+    if (nodeptr == NULL) return -1;
+    return (int)(nodeptr - gateginfo->node);
+}
+
+/* Indexes of nets by name and by net number, kept in step with	*/
+/* Nlnets as nets are read.  Net names are case-sensitive.	*/
+
+struct hashtable_ NetTable;
+NET *NetNumTable = NULL;
+int NetNumTableSize = 0;
+
+/* Spacing of the GCELLGRID in X and Y, in microns, or 0 if none */
+
+double GCellStepX = 0.0;
+double GCellStepY = 0.0;
+
+/*
+ *------------------------------------------------------------
+ *
+ * DefAddNet --
+ *
+ *	Add a net to the indexes by name and by net number.
+ *	Where two nets have the same name or number, the one
+ *	added last is found, as with a linear search of
+ *	Nlnets (which is built by prepending).
+ *
+ *------------------------------------------------------------
+ */
+
+void
+DefAddNet(NET net)
+{
+    int newsize;
+
+    hash_insert(&NetTable, net->netname, net);
+
+    if (net->netnum < 0) return;
+    if (net->netnum >= NetNumTableSize) {
+	newsize = (NetNumTableSize == 0) ? 1024 : NetNumTableSize;
+	while (newsize <= net->netnum) newsize <<= 1;
+	NetNumTable = (NET *)realloc(NetNumTable, newsize * sizeof(NET));
+	if (NetNumTable == NULL) {
+	    fprintf(stderr, "Out of memory in DefAddNet().\n");
+	    exit(10);
+	}
+	memset(NetNumTable + NetNumTableSize, 0,
+		(newsize - NetNumTableSize) * sizeof(NET));
+	NetNumTableSize = newsize;
+    }
+    NetNumTable[net->netnum] = net;
+}
+
+/*
+ *------------------------------------------------------------
+ *
+ * DefClearNets --
+ *
+ *	Empty the net indexes, when Nlnets is reset.
+ *
+ *------------------------------------------------------------
+ */
+
+void
+DefClearNets()
+{
+    hash_clear(&NetTable);
+    if (NetNumTable != NULL)
+	memset(NetNumTable, 0, NetNumTableSize * sizeof(NET));
+}
+
+/*
+ *------------------------------------------------------------
+ *
+ * DefFindNet --
+ *
+ *	Find a net by name.
+ *
+ * Results:
+ *	The net, or NULL if there is no net of that name.
+ *
+ *------------------------------------------------------------
+ */
+
+NET
+DefFindNet(char *netname)
+{
+    return (NET)hash_lookup(&NetTable, netname);
+}
+
+/*
+ *------------------------------------------------------------
+ *
+ * DefFindNetNum --
+ *
+ *	Find a net by net number.
+ *
+ * Results:
+ *	The net, or NULL if no net has that number.
+ *
+ *------------------------------------------------------------
+ */
+
+NET
+DefFindNetNum(int netnum)
+{
+    if ((u_int)netnum >= (u_int)NetNumTableSize) return NULL;
+    return NetNumTable[netnum];
+}
 
 /*
  *------------------------------------------------------------
@@ -114,7 +303,8 @@ DefAddRoutes(FILE *f, float oscale, NET net, char special)
 	    // Create a new route record, add to the 1st node
 
 	    if (special == (char)0) {
-	       routednet = (ROUTE)malloc(sizeof(struct route_));
+	       routednet = (ROUTE)arena_alloc(net_arena(net),
+				sizeof(struct route_));
 	       routednet->next = net->routes;
 	       net->routes = routednet;
 
@@ -150,7 +340,8 @@ DefAddRoutes(FILE *f, float oscale, NET net, char special)
 			   if (routeLayer < paintLayer) paintLayer = routeLayer;
 			   if ((routeLayer >= 0) && (special == (char)1) &&
 					(valid == TRUE)) {
-			      drect = (DSEG)malloc(sizeof(struct dseg_));
+			      drect = (DSEG)mem_malloc(MEM_GEOMETRY,
+					      sizeof(struct dseg_));
 			      drect->x1 = x + lr->x1;
 			      drect->x2 = x + lr->x2;
 			      drect->y1 = y + lr->y1;
@@ -173,7 +364,8 @@ DefAddRoutes(FILE *f, float oscale, NET net, char special)
 		}
 		if ((special == (char)0) && (paintLayer >= 0)) {
 
-		    newRoute = (SEG)malloc(sizeof(struct seg_));
+		    newRoute = (SEG)arena_alloc(net_arena(net),
+				sizeof(struct seg_));
 		    newRoute->segtype = ST_VIA;
 		    newRoute->x1 = refp.x1;
 		    newRoute->x2 = refp.x1;
@@ -234,7 +426,6 @@ DefAddRoutes(FILE *f, float oscale, NET net, char special)
 		if (valid == FALSE)
 		{
 		    LefError("No reference point for \"*\" wildcard\n"); 
-		    free(newRoute);
 		    newRoute = NULL;
 		    goto endCoord;
 		}
@@ -276,7 +467,8 @@ DefAddRoutes(FILE *f, float oscale, NET net, char special)
 
 		if (special == (char)1) {
 		   if (valid == TRUE) {
-		      drect = (DSEG)malloc(sizeof(struct dseg_));
+		      drect = (DSEG)mem_malloc(MEM_GEOMETRY,
+				      sizeof(struct dseg_));
 		      if (lx > x) {
 		         drect->x1 = x - w;
 		         drect->x2 = lx + w;
@@ -299,7 +491,8 @@ DefAddRoutes(FILE *f, float oscale, NET net, char special)
 		   }
 		}
 		else {
-		   newRoute = (SEG)malloc(sizeof(struct seg_));
+		   newRoute = (SEG)arena_alloc(net_arena(net),
+				sizeof(struct seg_));
 		   newRoute->segtype = ST_WIRE;
 		   newRoute->x1 = locarea.x1;
 		   newRoute->x2 = locarea.x2;
@@ -362,86 +555,80 @@ DefReadGatePin(NET net, NODE node, char *instname, char *pinname, double *home)
     int gridx, gridy;
     DPOINT dp;
 
-    for (g = Nlgates; g; g = g->next) {
-	if (!strcasecmp(instname, g->gatename)) {
-	    for (gateginfo = GateInfo; gateginfo; gateginfo = gateginfo->next) {
-		if (!strcasecmp(g->gatetype, gateginfo->gatetype)) {
-		    for (i = 0; i < gateginfo->nodes; i++) {
-			if (!strcasecmp(gateginfo->node[i], pinname)) {
-			    node->taps = (DPOINT)NULL;
-			    node->extend = (DPOINT)NULL;
-
-			    for (drect = g->taps[i]; drect; drect = drect->next) {
-
-				// Add all routing gridpoints that fall inside
-				// the rectangle.  Much to do here:
-				// (1) routable area should extend 1/2 route width
-				// to each side, as spacing to obstructions allows.
-				// (2) terminals that are wide enough to route to
-				// but not centered on gridpoints should be marked
-				// in some way, and handled appropriately.
-
-				gridx = (int)((drect->x1 - Xlowerbound) /
-					PitchX[drect->layer]) - 1;
-				while (1) {
-				    dx = (gridx * PitchX[drect->layer]) + Xlowerbound;
-				    if (dx > drect->x2 + home[drect->layer]) break;
-				    if (dx < drect->x1 - home[drect->layer]) {
-					gridx++;
-				 	continue;
-				    }
-				    gridy = (int)((drect->y1 - Ylowerbound) /
-						PitchY[drect->layer]) - 1;
-				    while (1) {
-					dy = (gridy * PitchY[drect->layer])
-						+ Ylowerbound;
-					if (dy > drect->y2 + home[drect->layer]) break;
-					if (dy < drect->y1 - home[drect->layer]) {
-					    gridy++;
-					    continue;
-					}
-
-					// Routing grid point is an interior point
-					// of a gate port.  Record the position
-
-					dp = (DPOINT)malloc(sizeof(struct dpoint_));
-					dp->layer = drect->layer;
-					dp->x = dx;
-					dp->y = dy;
-					dp->gridx = gridx;
-					dp->gridy = gridy;
-
-					if (dy >= drect->y1 && dx >= drect->x1 &&
-						dy <= drect->y2 && dx <= drect->x2) {
-					    dp->next = node->taps;
-					    node->taps = dp;
-					}
-					else {
-					    dp->next = node->extend;
-					    node->extend = dp;
-					}
-					gridy++;
-				    }
-				    gridx++;
-				}
-			    }
-			    node->netnum = net->netnum;
-			    g->netnum[i] = net->netnum;
-			    g->noderec[i] = node;
-			    node->netname = net->netname;
-			    node->next = net->netnodes;
-			    net->netnodes = node;
-			    break;
-			}
-		    }
-		    if (i < gateginfo->nodes) break;
+    g = (GATE)hash_lookup(&InstanceTable, instname);
+    if (g == NULL) return;
+
+    gateginfo = (GATE)hash_lookup(&MacroTable, g->gatetype);
+    i = (gateginfo == NULL) ? -1 : DefFindMacroNode(gateginfo, pinname);
+    if (i < 0) {
+	LefError("Endpoint %s/%s of net %s not found\n",
+			instname, pinname, net->netname);
+	return;
+    }
+
+    node->taps = (DPOINT)NULL;
+    node->extend = (DPOINT)NULL;
+
+    for (drect = g->taps[i]; drect; drect = drect->next) {
+
+	// Add all routing gridpoints that fall inside
+	// the rectangle.  Much to do here:
+	// (1) routable area should extend 1/2 route width
+	// to each side, as spacing to obstructions allows.
+	// (2) terminals that are wide enough to route to
+	// but not centered on gridpoints should be marked
+	// in some way, and handled appropriately.
+
+	gridx = (int)((drect->x1 - Xlowerbound) /
+		PitchX[drect->layer]) - 1;
+	while (1) {
+	    dx = (gridx * PitchX[drect->layer]) + Xlowerbound;
+	    if (dx > drect->x2 + home[drect->layer]) break;
+	    if (dx < drect->x1 - home[drect->layer]) {
+		gridx++;
+		continue;
+	    }
+	    gridy = (int)((drect->y1 - Ylowerbound) /
+			PitchY[drect->layer]) - 1;
+	    while (1) {
+		dy = (gridy * PitchY[drect->layer])
+			+ Ylowerbound;
+		if (dy > drect->y2 + home[drect->layer]) break;
+		if (dy < drect->y1 - home[drect->layer]) {
+		    gridy++;
+		    continue;
+		}
+
+		// Routing grid point is an interior point
+		// of a gate port.  Record the position
+
+		dp = (DPOINT)mem_malloc(MEM_GEOMETRY, sizeof(struct dpoint_));
+		dp->layer = drect->layer;
+		dp->x = dx;
+		dp->y = dy;
+		dp->gridx = gridx;
+		dp->gridy = gridy;
+
+		if (dy >= drect->y1 && dx >= drect->x1 &&
+			dy <= drect->y2 && dx <= drect->x2) {
+		    dp->next = node->taps;
+		    node->taps = dp;
+		}
+		else {
+		    dp->next = node->extend;
+		    node->extend = dp;
 		}
+		gridy++;
 	    }
-	    if (!gateginfo)
-		LefError("Endpoint %s/%s of net %s not found\n",
-				instname, pinname, net->netname);
+	    gridx++;
 	}
     }
+    node->netnum = net->netnum;
+    g->netnum[i] = net->netnum;
+    g->noderec[i] = node;
+    node->netname = net->netname;
+    node->next = net->netnodes;
+    net->netnodes = node;
 }
 					   
 
@@ -510,6 +697,7 @@ DefReadNets(FILE *f, char *sname, float oscale, char special, int total)
 	// Initialize net and node records
 	Nlnets = (NET)NULL;
 	Numnets = MIN_NET_NUMBER;
+	DefClearNets();
 
 	// Compute distance for keepout halo for each route layer
 	// NOTE:  This must match the definition for the keepout halo
@@ -538,20 +726,25 @@ DefReadNets(FILE *f, char *sname, float oscale, char special, int total)
 		/* Get net name */
 		token = LefNextToken(f, TRUE);
 
-		net = (NET)malloc(sizeof(struct net_));
-		if (vddnet && !strcmp(token, vddnet))
+		net = (NET)mem_malloc(MEM_NETLIST, sizeof(struct net_));
+		net->netname = name_intern(token);
+		if (vddnet && (net->netname == vddnet))
 		   net->netnum = VDD_NET;
-		else if (gndnet && !strcmp(token, gndnet))
+		else if (gndnet && (net->netname == gndnet))
 		   net->netnum = GND_NET;
 		else
 		   net->netnum = Numnets++;
 		net->netorder = 0;
-		net->netname = strdup(token);
 		net->netnodes = (NODE)NULL;
+		net->numnodes = 0;
+		net->flags = 0;
 		net->noripup = (NETLIST)NULL;
+		net->routes = (ROUTE)NULL;
+		net->arena = (ARENA)NULL;
 
 		net->next = Nlnets;
 		Nlnets = net;
+		DefAddNet(net);
 
 		nodeidx = 0;
 
@@ -580,7 +773,8 @@ DefReadNets(FILE *f, char *sname, float oscale, char special, int total)
 			else
 			    strcpy(pinname, token);
 
-			node = (NODE)calloc(1, sizeof(struct node_));
+			node = (NODE)mem_calloc(MEM_NETLIST, 1,
+					sizeof(struct node_));
 			node->nodenum = nodeidx++;
 			DefReadGatePin(net, node, instname, pinname, home);
 
@@ -854,12 +1048,17 @@ DefReadPins(FILE *f, char *sname, float oscale, int total)
 		}
 
 		/* Create the pin record */
-		gate = (GATE)malloc(sizeof(struct gate_));
-		gate->gatetype = (char *)malloc(4);
-		strcpy(gate->gatetype, "pin");
+		gate = (GATE)mem_malloc(MEM_NETLIST, sizeof(struct gate_));
+		gate->gatetype = name_intern("pin");
 		Numpins++;
 		gate->gatename = NULL;	/* Use NET, but if none, use	*/
 					/* the pin name, set at end.	*/
+		gate->nodes = 0;
+		gate->node = NULL;
+		gate->taps = NULL;
+		gate_add_pins(gate, 1);
+		gate->netnum = (int *)mem_calloc(MEM_NETLIST, 1, sizeof(int));
+		gate->noderec = (NODE *)mem_calloc(MEM_NETLIST, 1, sizeof(NODE));
 		gate->width = gate->height = 0;
 		curlayer = -1;
 
@@ -884,8 +1083,8 @@ DefReadPins(FILE *f, char *sname, float oscale, int total)
 			case DEF_PINS_PROP_NET:
 			    /* Get the net name */
 			    token = LefNextToken(f, TRUE);
-			    gate->gatename = strdup(token);
-			    gate->node[0] = strdup(token);
+			    gate->gatename = name_intern(token);
+			    gate->node[0] = gate->gatename;
 			    break;
 			case DEF_PINS_PROP_DIR:
 			    token = LefNextToken(f, TRUE);
@@ -916,10 +1115,11 @@ DefReadPins(FILE *f, char *sname, float oscale, int total)
 
 		    /* If no NET was declared for pin, use pinname */
 		    if (gate->gatename == NULL)
-			gate->gatename = strdup(pinname);
+			gate->gatename = name_intern(pinname);
 
 		    /* Make sure pin is at least the size of the route layer */
-		    drect = (DSEG)malloc(sizeof(struct dseg_));
+		    drect = (DSEG)mem_malloc(MEM_GEOMETRY,
+				    sizeof(struct dseg_));
 		    gate->taps[0] = drect;
 		    drect->next = (DSEG)NULL;
 
@@ -933,16 +1133,20 @@ DefReadPins(FILE *f, char *sname, float oscale, int total)
 		    drect->y2 = gate->placedY + hwidth;
 		    drect->layer = curlayer;
 		    gate->obs = (DSEG)NULL;
-		    gate->nodes = 1;
 		    gate->glue = TRUE;
 		    gate->vert = FALSE;
 		    gate->next = Nlgates;
 		    Nlgates = gate;
+		    hash_insert(&InstanceTable, gate->gatename, gate);
 		}
 		else {
 		    LefError("Pin %s is defined outside of route layer area!\n",
 				pinname);
-		    free(gate);
+		    mem_free(MEM_NETLIST, gate->node, sizeof(char *));
+		    mem_free(MEM_NETLIST, gate->taps, sizeof(DSEG));
+		    mem_free(MEM_NETLIST, gate->netnum, sizeof(int));
+		    mem_free(MEM_NETLIST, gate->noderec, sizeof(NODE));
+		    mem_free(MEM_NETLIST, gate, sizeof(struct gate_));
 		}
 
 		break;
@@ -1200,23 +1404,19 @@ DefReadComponents(FILE *f, char *sname, float oscale, int total)
 		token = LefNextToken(f, TRUE);
 
 		/* Find the corresponding macro */
-		OK = 0;
-		for (gateginfo = GateInfo; gateginfo; gateginfo = gateginfo->next) {
-		    if (!strcasecmp(gateginfo->gatetype, token)) {
-			OK = 1;
-			break;
-		    }
-		}
+		gateginfo = (GATE)hash_lookup(&MacroTable, token);
+		OK = (gateginfo == NULL) ? 0 : 1;
 		if (!OK) {
 		    LefError("Could not find a macro definition for \"%s\"\n",
 				token);
 		    gate = NULL;
 		}
 		else {
-		    gate = (GATE)malloc(sizeof(struct gate_));
-		    gate->gatename = strdup(usename);
-		    gate->gatetype = strdup(token);
+		    gate = (GATE)mem_malloc(MEM_NETLIST, sizeof(struct gate_));
+		    gate->gatename = name_intern(usename);
+		    gate->gatetype = name_intern(token);
 		    gate->gatenum = processed;
+		    DefHashMacroNodes(gateginfo);
 		}
 		if (Numgates < processed) Numgates = processed;
 
@@ -1262,40 +1462,48 @@ DefReadComponents(FILE *f, char *sname, float oscale, int total)
 		    /* Process the gate */
 		    gate->width = gateginfo->width;   
 		    gate->height = gateginfo->height;   
-		    gate->nodes = gateginfo->nodes;   
 		    gate->obs = (DSEG)NULL;
 
-		    for (i = 0; i < gate->nodes; i++) {
-			/* Let the node names point to the master cell;	*/
-			/* this is just diagnostic;  allows us, for	*/
-			/* instance, to identify vdd and gnd nodes, so	*/
-			/* we don't complain about them being		*/
-			/* disconnected.				*/
+		    /* Let the node names point to the master cell;	*/
+		    /* this is just diagnostic;  allows us, for		*/
+		    /* instance, to identify vdd and gnd nodes, so	*/
+		    /* we don't complain about them being		*/
+		    /* disconnected.					*/
 
-			gate->node[i] = gateginfo->node[i];  /* copy pointer */
-			gate->taps[i] = (DSEG)NULL;
+		    gate_alloc_pins(gate, gateginfo);
+
+		    for (i = 0; i < gate->nodes; i++) {
 
 			/* Global power/ground bus check */
-			if (vddnet && !strcmp(gate->node[i], vddnet)) {
+			if (gate->node[i] == NULL) {
+			   gate->netnum[i] = 0;		/* Pin with no ports */
+			   gate->noderec[i] = (NODE)NULL;
+			}
+			else if (vddnet && (gate->node[i] == vddnet)) {
 			   /* Create a placeholder node with no taps */
 			   gate->netnum[i] = VDD_NET;
-			   gate->noderec[i] = (NODE)calloc(1, sizeof(struct node_));
+			   gate->noderec[i] = (NODE)mem_calloc(MEM_NETLIST, 1,
+					   sizeof(struct node_));
 			   gate->noderec[i]->netnum = VDD_NET;
 			}
-			else if (gndnet && !strcmp(gate->node[i], gndnet)) {
+			else if (gndnet && (gate->node[i] == gndnet)) {
 			   /* Create a placeholder node with no taps */
 			   gate->netnum[i] = GND_NET;
-			   gate->noderec[i] = (NODE)calloc(1, sizeof(struct node_));
+			   gate->noderec[i] = (NODE)mem_calloc(MEM_NETLIST, 1,
+					   sizeof(struct node_));
 			   gate->noderec[i]->netnum = GND_NET;
 			}
-			else
+			else {
 			   gate->netnum[i] = 0;		/* Until we read NETS */
+			   gate->noderec[i] = (NODE)NULL;
+			}
 
 			/* Make a copy of the gate nodes and adjust for	*/
 			/* instance position				*/
 
 			for (drect = gateginfo->taps[i]; drect; drect = drect->next) {
-			    newrect = (DSEG)malloc(sizeof(struct dseg_));
+			    newrect = (DSEG)mem_malloc(MEM_GEOMETRY,
+					    sizeof(struct dseg_));
 			    *newrect = *drect;
 			    newrect->next = gate->taps[i];
 			    gate->taps[i] = newrect;
@@ -1347,7 +1555,8 @@ DefReadComponents(FILE *f, char *sname, float oscale, int total)
 		    /* Make a copy of the gate obstructions and adjust	*/
 		    /* for instance position				*/
 		    for (drect = gateginfo->obs; drect; drect = drect->next) {
-			newrect = (DSEG)malloc(sizeof(struct dseg_));
+			newrect = (DSEG)mem_malloc(MEM_GEOMETRY,
+					sizeof(struct dseg_));
 			*newrect = *drect;
 			newrect->next = gate->obs;
 			gate->obs = newrect;
@@ -1385,6 +1594,7 @@ DefReadComponents(FILE *f, char *sname, float oscale, int total)
 		    }
 		    gate->next = Nlgates;
 		    Nlgates = gate;
+		    hash_insert(&InstanceTable, gate->gatename, gate);
 		}
 		break;
 
@@ -1451,11 +1661,12 @@ DefRead(char *inName)
     char *token;
     int keyword, dscale, total;
     int curlayer, channels;
-    int v, h, i;
+    int v, h, i, gcellsx, gcellsy;
     float oscale;
     double start, step;
     double llx, lly, urx, ury;
     char corient = '.';
+    char gorient;
     DSEG diearea;
 
     static char *sections[] = {
@@ -1511,6 +1722,11 @@ DefRead(char *inName)
     oscale = 1;
     lefCurrentLine = 0;
     v = h = -1;
+    gcellsx = gcellsy = 0;
+
+    hash_init(&InstanceTable, 0, TRUE);
+    hash_init(&NetTable, 0, FALSE);
+    DefHashMacros();
 
     /* Read file contents */
 
@@ -1662,6 +1878,49 @@ DefRead(char *inName)
 		LefEndStatement(f);
 		break;
 	    case DEF_GCELLGRID:
+		// Keep the spacing of the global routing cells for the
+		// global routing stage.  Where there are several grids
+		// in one direction, the one with the most cells is used.
+		token = LefNextToken(f, TRUE);
+		gorient = tolower(token[0]);	// X or Y
+		token = LefNextToken(f, TRUE);
+		if (sscanf(token, "%lg", &start) != 1) {
+		    LefError("Problem parsing gcell grid start position.\n");
+		    LefEndStatement(f);
+		    break;
+		}
+		token = LefNextToken(f, TRUE);
+		if (strcmp(token, "DO")) {
+		    LefError("GCELLGRID missing DO loop.\n");
+		    LefEndStatement(f);
+		    break;
+		}
+		token = LefNextToken(f, TRUE);
+		if (sscanf(token, "%d", &channels) != 1) {
+		    LefError("Problem parsing number of gcell grid lines.\n");
+		    LefEndStatement(f);
+		    break;
+		}
+		token = LefNextToken(f, TRUE);
+		if (strcmp(token, "STEP")) {
+		    LefError("GCELLGRID missing STEP size.\n");
+		    LefEndStatement(f);
+		    break;
+		}
+		token = LefNextToken(f, TRUE);
+		if (sscanf(token, "%lg", &step) != 1) {
+		    LefError("Problem parsing gcell grid step size.\n");
+		    LefEndStatement(f);
+		    break;
+		}
+		if ((gorient == 'x') && (channels > gcellsx)) {
+		    gcellsx = channels;
+		    GCellStepX = step / oscale;
+		}
+		else if ((gorient == 'y') && (channels > gcellsy)) {
+		    gcellsy = channels;
+		    GCellStepY = step / oscale;
+		}
 		LefEndStatement(f);
 		break;
 	    case DEF_DIVIDERCHAR:
@@ -0,0 +1,540 @@
+/*--------------------------------------------------------------*/
+/* global.c -- global routing on a coarse grid of tiles		*/
+/*								*/
+/* With "global route" in the configuration file, every net is	*/
+/* first routed over a grid of tiles, each "global tile" grid	*/
+/* positions on a side, or the size of the DEF GCELLGRID cells	*/
+/* if no tile size is given.  The capacity of the boundary	*/
+/* between two tiles is the number of tracks crossing it, on	*/
+/* layers routed in that direction, that are free of		*/
+/* obstructions in Obs[].  Nets are routed in the order of the	*/
+/* routing queue, by a shortest path search over the tiles	*/
+/* from the tiles already reached by the net to the nearest	*/
+/* tile of a node not yet reached.  A boundary costs more as	*/
+/* it fills up, and much more once it is full.  Further passes	*/
+/* reroute the nets crossing full boundaries, with the cost of	*/
+/* each boundary raised by the amount it was overfull.		*/
+/*								*/
+/* The tiles used by a net, plus the tiles of its nodes, are	*/
+/* its corridor.  route_segs() searches within the corridor	*/
+/* first, widening it on each pass, as it does for the mask of	*/
+/* "search corridor" (see createMask()).			*/
+/*--------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "qrouter.h"
+#include "config.h"
+#include "node.h"
+#include "lef.h"
+#include "global.h"
+#include "grid.h"
+#include "mem.h"
+
+#define GLOBAL_TILE		8	// tile size if none is given
+#define GLOBAL_MARGIN		2	// tiles around a net that it may use
+#define GLOBAL_PASSES		5	// most global routing passes
+#define GLOBAL_OVERFLOW_COST	10.0	// cost of each route over capacity
+#define GLOBAL_HISTORY_COST	2.0	// cost added per route over capacity
+					// at the end of a pass
+
+int	GTileX, GTileY;		// size of a tile in grid positions
+int	GTilesX, GTilesY;	// number of tiles in X and Y
+
+// Boundaries between tiles.  Boundary 2 * t is the east side of
+// tile t, and boundary 2 * t + 1 its north side.
+
+u_short	*GCapacity = NULL;	// tracks crossing each boundary
+u_short	*GUsage;		// nets crossing each boundary
+float	*GHistory;		// cost of past overflow of each boundary
+
+// Boundaries crossed by each net, by net number.  NetNumEdges[n]
+// is -1 if net n has no corridor.
+
+int	**NetEdges;
+int	*NetNumEdges;
+
+// Shortest path search
+
+double	*GDist;			// cost to reach each tile
+int	*GPrev;			// boundary by which each tile was reached
+int	*GMark;			// search that last reached each tile
+int	*GTree;			// net route whose tree includes each tile
+int	*GTarget;		// net route with a node on each tile
+int	GSearch = 0;		// searches made
+int	GNetRoutes = 0;		// net routes made
+
+#define GTILE(x, y)	(((y) / GTileY) * GTilesX + ((x) / GTileX))
+
+/*--------------------------------------------------------------*/
+/* track_free --- TRUE if a route may pass grid position x, y	*/
+/*	on layer "lay".						*/
+/*--------------------------------------------------------------*/
+
+u_char track_free(int x, int y, int lay)
+{
+   u_int val = OBSVAL(x, y, lay);
+
+   return (val & (NO_NET | ROUTED_NET)) ? FALSE : TRUE;
+}
+
+/*--------------------------------------------------------------*/
+/* global_capacity --- count the free tracks crossing each	*/
+/*	tile boundary.						*/
+/*--------------------------------------------------------------*/
+
+void global_capacity()
+{
+   int tx, ty, x, y, lay, cap;
+
+   for (ty = 0; ty < GTilesY; ty++) {
+      for (tx = 0; tx < GTilesX; tx++) {
+
+	 // East side:  horizontal tracks on the last column of the
+	 // tile and the first column of the next.
+
+	 cap = 0;
+	 x = (tx + 1) * GTileX - 1;
+	 if (tx < GTilesX - 1) {
+	    for (lay = 0; lay < Num_layers; lay++) {
+	       if (LefGetRouteOrientation(lay) != 1) continue;
+	       for (y = ty * GTileY; (y < (ty + 1) * GTileY) &&
+				(y < NumChannelsY[lay]); y++)
+		  if (track_free(x, y, lay) && track_free(x + 1, y, lay))
+		     cap++;
+	    }
+	 }
+	 GCapacity[2 * (ty * GTilesX + tx)] = cap;
+
+	 // North side
+
+	 cap = 0;
+	 y = (ty + 1) * GTileY - 1;
+	 if (ty < GTilesY - 1) {
+	    for (lay = 0; lay < Num_layers; lay++) {
+	       if (LefGetRouteOrientation(lay) == 1) continue;
+	       for (x = tx * GTileX; (x < (tx + 1) * GTileX) &&
+				(x < NumChannelsX[lay]); x++)
+		  if (track_free(x, y, lay) && track_free(x, y + 1, lay))
+		     cap++;
+	    }
+	 }
+	 GCapacity[2 * (ty * GTilesX + tx) + 1] = cap;
+      }
+   }
+}
+
+/*--------------------------------------------------------------*/
+/* edge_cost --- cost for one more net to cross boundary "e"	*/
+/*--------------------------------------------------------------*/
+
+double edge_cost(int e)
+{
+   double cost;
+   int u = GUsage[e];
+   int c = GCapacity[e];
+
+   cost = 1.0 + GHistory[e];
+   if (u + 1 > c)
+      cost += GLOBAL_OVERFLOW_COST * (u + 1 - c);
+   else
+      cost += (double)u / (double)c;
+   return cost;
+}
+
+/*--------------------------------------------------------------*/
+/* Binary heap of tiles keyed by GDist[], used by		*/
+/* global_route_net().  A tile may be pushed more than once;	*/
+/* stale entries are skipped when popped.			*/
+/*--------------------------------------------------------------*/
+
+typedef struct gheap_ {
+   double *key;
+   int    *tile;
+   int    size;
+   int    alloc;
+} GHEAP;
+
+void gheap_push(GHEAP *h, double key, int tile)
+{
+   int i, p, oldalloc;
+
+   if (h->size == h->alloc) {
+      oldalloc = h->alloc;
+      h->alloc = (h->alloc == 0) ? 256 : 2 * h->alloc;
+      h->key = (double *)mem_realloc(MEM_CONGESTION, h->key,
+		oldalloc * sizeof(double), h->alloc * sizeof(double));
+      h->tile = (int *)mem_realloc(MEM_CONGESTION, h->tile,
+		oldalloc * sizeof(int), h->alloc * sizeof(int));
+      if (!h->key || !h->tile) {
+	 fprintf(stderr, "Out of memory in global_route().\n");
+	 exit(10);
+      }
+   }
+   for (i = h->size++; i > 0; i = p) {
+      p = (i - 1) / 2;
+      if (h->key[p] <= key) break;
+      h->key[i] = h->key[p];
+      h->tile[i] = h->tile[p];
+   }
+   h->key[i] = key;
+   h->tile[i] = tile;
+}
+
+int gheap_pop(GHEAP *h, double *tilekey)
+{
+   int i, c, tile;
+   double key;
+
+   tile = h->tile[0];
+   *tilekey = h->key[0];
+   h->size--;
+   key = h->key[h->size];
+   for (i = 0; (c = 2 * i + 1) < h->size; i = c) {
+      if ((c + 1 < h->size) && (h->key[c + 1] < h->key[c])) c++;
+      if (key <= h->key[c]) break;
+      h->key[i] = h->key[c];
+      h->tile[i] = h->tile[c];
+   }
+   h->key[i] = key;
+   h->tile[i] = h->tile[h->size];
+   return tile;
+}
+
+/*--------------------------------------------------------------*/
+/* node_tile --- tile of the first tap of node "node", or -1	*/
+/*--------------------------------------------------------------*/
+
+int node_tile(NODE node)
+{
+   DPOINT dp;
+
+   dp = (node->taps != NULL) ? node->taps : node->extend;
+   if (dp == NULL) return -1;
+   return GTILE(dp->gridx, dp->gridy);
+}
+
+/*--------------------------------------------------------------*/
+/* global_route_net --- route net "net" over the tiles,	*/
+/*	recording the boundaries it crosses in NetEdges[] and	*/
+/*	adding them to GUsage[].				*/
+/*--------------------------------------------------------------*/
+
+void global_route_net(NET net, GHEAP *heap, int *tree)
+{
+   NODE node;
+   int t, t2, e, tx, ty, ntree, nleft, netnum, route, d;
+   int wx1, wy1, wx2, wy2;
+   int *edges, nedges;
+   double cost, key;
+
+   netnum = net->netnum;
+   route = ++GNetRoutes;
+   edges = NULL;
+   nedges = 0;
+
+   // Mark the tiles of the nodes, and find the window of tiles
+   // the net may use.
+
+   wx1 = GTilesX;
+   wy1 = GTilesY;
+   wx2 = wy2 = -1;
+   ntree = nleft = 0;
+   for (node = net->netnodes; node; node = node->next) {
+      t = node_tile(node);
+      if (t < 0) continue;
+      tx = t % GTilesX;
+      ty = t / GTilesX;
+      if (tx < wx1) wx1 = tx;
+      if (tx > wx2) wx2 = tx;
+      if (ty < wy1) wy1 = ty;
+      if (ty > wy2) wy2 = ty;
+      if (ntree == 0) {
+	 GTree[t] = route;
+	 tree[ntree++] = t;
+      }
+      else if ((GTree[t] != route) && (GTarget[t] != route)) {
+	 GTarget[t] = route;
+	 nleft++;
+      }
+   }
+   wx1 = MAX(wx1 - GLOBAL_MARGIN, 0);
+   wy1 = MAX(wy1 - GLOBAL_MARGIN, 0);
+   wx2 = MIN(wx2 + GLOBAL_MARGIN, GTilesX - 1);
+   wy2 = MIN(wy2 + GLOBAL_MARGIN, GTilesY - 1);
+
+   // Grow the tree from all of its tiles to the nearest node not
+   // yet reached, until all are reached.
+
+   while (nleft > 0) {
+      GSearch++;
+      heap->size = 0;
+      for (t = 0; t < ntree; t++) {
+	 GMark[tree[t]] = GSearch;
+	 GDist[tree[t]] = 0.0;
+	 GPrev[tree[t]] = -1;
+	 gheap_push(heap, 0.0, tree[t]);
+      }
+
+      t = -1;
+      while (heap->size > 0) {
+	 t = gheap_pop(heap, &key);
+	 if (key > GDist[t]) {		// Reached again at lower cost
+	    t = -1;
+	    continue;
+	 }
+	 if ((GTarget[t] == route) && (GTree[t] != route)) break;
+	 tx = t % GTilesX;
+	 ty = t / GTilesX;
+
+	 for (d = 0; d < 4; d++) {
+	    switch (d) {
+	       case 0:		// East
+		  if (tx >= wx2) continue;
+		  t2 = t + 1;
+		  e = 2 * t;
+		  break;
+	       case 1:		// West
+		  if (tx <= wx1) continue;
+		  t2 = t - 1;
+		  e = 2 * t2;
+		  break;
+	       case 2:		// North
+		  if (ty >= wy2) continue;
+		  t2 = t + GTilesX;
+		  e = 2 * t + 1;
+		  break;
+	       default:		// South
+		  if (ty <= wy1) continue;
+		  t2 = t - GTilesX;
+		  e = 2 * t2 + 1;
+		  break;
+	    }
+	    cost = GDist[t] + edge_cost(e);
+	    if ((GMark[t2] != GSearch) || (cost < GDist[t2])) {
+	       GMark[t2] = GSearch;
+	       GDist[t2] = cost;
+	       GPrev[t2] = e;
+	       gheap_push(heap, cost, t2);
+	    }
+	 }
+	 t = -1;
+      }
+      if (t < 0) break;		// Cannot happen:  the nodes left are in
+				// the window, whose tiles are all reachable
+
+      // Add the path back to the tree, counting any other nodes it
+      // passes through as reached.
+
+      while (GPrev[t] >= 0) {
+	 if (GTarget[t] == route) nleft--;
+	 GTree[t] = route;
+	 tree[ntree++] = t;
+	 e = GPrev[t];
+	 GUsage[e]++;
+	 if ((nedges & 15) == 0)
+	    edges = (int *)mem_realloc(MEM_CONGESTION, edges,
+			nedges * sizeof(int), (nedges + 16) * sizeof(int));
+	 edges[nedges++] = e;
+	 t = ((e & 1) == 0) ? ((e / 2 == t) ? t + 1 : e / 2)
+			: ((e / 2 == t) ? t + GTilesX : e / 2);
+	 if (GTree[t] == route) break;
+      }
+   }
+
+   NetEdges[netnum] = edges;
+   NetNumEdges[netnum] = nedges;
+}
+
+/*--------------------------------------------------------------*/
+/* global_unroute_net --- remove the boundaries crossed by net	*/
+/*	"net" from GUsage[].  Return TRUE if any of them was	*/
+/*	over capacity.						*/
+/*--------------------------------------------------------------*/
+
+u_char global_unroute_net(NET net)
+{
+   int i, e;
+   u_char over = FALSE;
+
+   for (i = 0; i < NetNumEdges[net->netnum]; i++) {
+      e = NetEdges[net->netnum][i];
+      if (GUsage[e] > GCapacity[e]) over = TRUE;
+      GUsage[e]--;
+   }
+   mem_free(MEM_CONGESTION, NetEdges[net->netnum],
+		((NetNumEdges[net->netnum] + 15) & ~15) * sizeof(int));
+   NetEdges[net->netnum] = NULL;
+   NetNumEdges[net->netnum] = -1;
+   return over;
+}
+
+/*--------------------------------------------------------------*/
+/* net_overflows --- TRUE if net "net" crosses any boundary	*/
+/*	that is over capacity.					*/
+/*--------------------------------------------------------------*/
+
+u_char net_overflows(NET net)
+{
+   int i, e;
+
+   for (i = 0; i < NetNumEdges[net->netnum]; i++) {
+      e = NetEdges[net->netnum][i];
+      if (GUsage[e] > GCapacity[e]) return TRUE;
+   }
+   return FALSE;
+}
+
+/*--------------------------------------------------------------*/
+/* global_route --- route all nets of the routing queue over	*/
+/*	the tiles, as described at the top of this file.	*/
+/*	Power and ground nets are not routed, and are given	*/
+/*	no corridor.						*/
+/*--------------------------------------------------------------*/
+
+void global_route()
+{
+   int i, e, n, pass, rerouted, overflow, *tree;
+   NET net;
+   GHEAP heap;
+
+   // Tile size
+
+   if (GlobalTile > 0)
+      GTileX = GTileY = GlobalTile;
+   else {
+      GTileX = (GCellStepX > 0.0) ? (int)(0.5 + GCellStepX / PitchX[0])
+			: GLOBAL_TILE;
+      GTileY = (GCellStepY > 0.0) ? (int)(0.5 + GCellStepY / PitchY[0])
+			: GLOBAL_TILE;
+   }
+   if (GTileX < 2) GTileX = 2;
+   if (GTileY < 2) GTileY = 2;
+   GTilesX = (NumChannelsX[0] + GTileX - 1) / GTileX;
+   GTilesY = (NumChannelsY[0] + GTileY - 1) / GTileY;
+   n = GTilesX * GTilesY;
+
+   GCapacity = (u_short *)mem_calloc(MEM_CONGESTION, 2 * n, sizeof(u_short));
+   GUsage = (u_short *)mem_calloc(MEM_CONGESTION, 2 * n, sizeof(u_short));
+   GHistory = (float *)mem_calloc(MEM_CONGESTION, 2 * n, sizeof(float));
+   GDist = (double *)mem_malloc(MEM_CONGESTION, n * sizeof(double));
+   GPrev = (int *)mem_malloc(MEM_CONGESTION, n * sizeof(int));
+   GMark = (int *)mem_calloc(MEM_CONGESTION, n, sizeof(int));
+   GTree = (int *)mem_calloc(MEM_CONGESTION, n, sizeof(int));
+   GTarget = (int *)mem_calloc(MEM_CONGESTION, n, sizeof(int));
+   tree = (int *)mem_malloc(MEM_CONGESTION, n * sizeof(int));
+   NetEdges = (int **)mem_calloc(MEM_CONGESTION, Numnets + 1, sizeof(int *));
+   NetNumEdges = (int *)mem_malloc(MEM_CONGESTION,
+		(Numnets + 1) * sizeof(int));
+   if (!GCapacity || !GUsage || !GHistory || !GDist || !GPrev || !GMark ||
+		!GTree || !GTarget || !tree || !NetEdges || !NetNumEdges) {
+      fprintf(stderr, "Out of memory in global_route().\n");
+      exit(10);
+   }
+   for (i = 0; i <= Numnets; i++) NetNumEdges[i] = -1;
+   for (i = 0; i < n; i++) GTree[i] = GTarget[i] = -1;
+   heap.key = NULL;
+   heap.tile = NULL;
+   heap.size = heap.alloc = 0;
+
+   global_capacity();
+
+   fprintf(stdout, "Global routing on %d x %d tiles of %d x %d grid "
+		"positions\n", GTilesX, GTilesY, GTileX, GTileY);
+
+   for (pass = 1; pass <= GLOBAL_PASSES; pass++) {
+      rerouted = 0;
+      for (i = 0; i < NetOrderTableSize; i++) {
+	 net = NetOrderTable[i];
+	 if ((net->netnodes == NULL) || (net->netnum == VDD_NET) ||
+			(net->netnum == GND_NET))
+	    continue;
+	 if (pass > 1) {
+	    if (!net_overflows(net)) continue;
+	    global_unroute_net(net);
+	 }
+	 global_route_net(net, &heap, tree);
+	 rerouted++;
+      }
+
+      overflow = 0;
+      for (e = 0; e < 2 * n; e++) {
+	 if (GUsage[e] > GCapacity[e]) {
+	    overflow += GUsage[e] - GCapacity[e];
+	    GHistory[e] += GLOBAL_HISTORY_COST * (GUsage[e] - GCapacity[e]);
+	 }
+      }
+      fprintf(stdout, "Global routing pass %d:  %d nets routed, "
+		"overflow %d\n", pass, rerouted, overflow);
+      if (overflow == 0) break;
+   }
+   fflush(stdout);
+
+   mem_free(MEM_CONGESTION, GDist, n * sizeof(double));
+   mem_free(MEM_CONGESTION, GPrev, n * sizeof(int));
+   mem_free(MEM_CONGESTION, GMark, n * sizeof(int));
+   mem_free(MEM_CONGESTION, GTarget, n * sizeof(int));
+   mem_free(MEM_CONGESTION, tree, n * sizeof(int));
+   mem_free(MEM_CONGESTION, heap.key, heap.alloc * sizeof(double));
+   mem_free(MEM_CONGESTION, heap.tile, heap.alloc * sizeof(int));
+}
+
+/*--------------------------------------------------------------*/
+/* global_corridor --- TRUE if net "net" has a corridor from	*/
+/*	global routing.						*/
+/*--------------------------------------------------------------*/
+
+u_char global_corridor(NET net)
+{
+   if (GCapacity == NULL) return FALSE;
+   if ((net->netnum < 0) || (net->netnum > Numnets)) return FALSE;
+   return (NetNumEdges[net->netnum] >= 0) ? TRUE : FALSE;
+}
+
+/*--------------------------------------------------------------*/
+/* set_tile_mask --- set the mask of "ctx" over tile "t" on	*/
+/*	all layers, if not already set.				*/
+/*--------------------------------------------------------------*/
+
+void set_tile_mask(ROUTECTX ctx, int t)
+{
+   int l, x, y;
+
+   x = (t % GTilesX) * GTileX;
+   y = (t / GTilesX) * GTileY;
+   if (MASK_TEST(ctx, x, y, 0)) return;
+   for (l = 0; l < Num_layers; l++)
+      setMaskBox(ctx, x, y, x + GTileX - 1, y + GTileY - 1, l);
+}
+
+/*--------------------------------------------------------------*/
+/* corridor_mask --- set the search mask of "ctx" to the	*/
+/*	corridor of net "net":  the tiles on both sides of each	*/
+/*	boundary it crosses, and the tiles of all of its taps.	*/
+/*--------------------------------------------------------------*/
+
+void corridor_mask(ROUTECTX ctx, NET net)
+{
+   NODE node;
+   DPOINT dp;
+   int i, e, t, pass;
+
+   fillMask(ctx, 0);
+
+   for (i = 0; i < NetNumEdges[net->netnum]; i++) {
+      e = NetEdges[net->netnum][i];
+      t = e / 2;
+      set_tile_mask(ctx, t);
+      set_tile_mask(ctx, (e & 1) ? t + GTilesX : t + 1);
+   }
+
+   for (node = net->netnodes; node; node = node->next)
+      for (pass = 0; pass < 2; pass++)
+	 for (dp = (pass == 0) ? node->taps : node->extend; dp; dp = dp->next)
+	    set_tile_mask(ctx, GTILE(dp->gridx, dp->gridy));
+}
+
+/* end of global.c */
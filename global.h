@@ -0,0 +1,14 @@
+/*--------------------------------------------------------------*/
+/* global.h -- global routing on a coarse grid of tiles		*/
+/*--------------------------------------------------------------*/
+
+#ifndef GLOBAL_H
+
+void	global_route();
+u_char	global_corridor(NET net);
+void	corridor_mask(ROUTECTX ctx, NET net);
+
+#define GLOBAL_H
+#endif
+
+/* end of global.h */
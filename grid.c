@@ -0,0 +1,326 @@
+/*--------------------------------------------------------------*/
+/* grid.c -- sparse and paged grids of values kept in tiles	*/
+/*								*/
+/* See grid.h.  Tiles of an FGRID are only ever added, so a	*/
+/* grid that is no longer written may be read from several	*/
+/* threads.  Pages of a PGRID are counted by the grids holding	*/
+/* them, and freed when the last one lets go.			*/
+/*--------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "qrouter.h"
+#include "grid.h"
+#include "mem.h"
+
+/*--------------------------------------------------------------*/
+/* fgrid_new --- make an empty sparse grid of "nx" by "ny"	*/
+/*	positions, counting its memory in "category".		*/
+/*								*/
+/* Return value:  the new grid					*/
+/*--------------------------------------------------------------*/
+
+FGRID fgrid_new(int nx, int ny, int category)
+{
+   FGRID g;
+
+   g = (FGRID)mem_malloc(category, sizeof(struct fgrid_));
+   if (g == NULL) {
+      fprintf(stderr, "Out of memory in fgrid_new().\n");
+      exit(5);
+   }
+   g->tilesx = (nx + GRID_TILE - 1) >> GRID_TILE_SHIFT;
+   g->tilesy = (ny + GRID_TILE - 1) >> GRID_TILE_SHIFT;
+   g->category = category;
+   g->tiles = (float **)mem_calloc(category, g->tilesx * g->tilesy,
+		sizeof(float *));
+   if (g->tiles == NULL) {
+      fprintf(stderr, "Out of memory in fgrid_new().\n");
+      exit(5);
+   }
+   return g;
+}
+
+/*--------------------------------------------------------------*/
+/* fgrid_set --- set the value at position (x, y) of grid "g",	*/
+/*	allocating its tile unless the value is zero.		*/
+/*--------------------------------------------------------------*/
+
+void fgrid_set(FGRID g, int x, int y, float value)
+{
+   float **tile;
+
+   tile = &FGRID_TILE(g, x, y);
+   if (*tile == NULL) {
+      if (value == 0.0) return;
+      *tile = (float *)mem_page_alloc(g->category, GRID_TILE * GRID_TILE *
+		sizeof(float));
+      if (*tile == NULL) {
+	 fprintf(stderr, "Out of memory in fgrid_set().\n");
+	 exit(5);
+      }
+      memset(*tile, 0, GRID_TILE * GRID_TILE * sizeof(float));
+   }
+   (*tile)[FGRID_OFFSET(x, y)] = value;
+}
+
+/*--------------------------------------------------------------*/
+/* fgrid_advise --- pass "advice" (see mem_advise()) on the	*/
+/*	tiles of grid "g" covering positions (x1, y1) to	*/
+/*	(x2, y2).						*/
+/*--------------------------------------------------------------*/
+
+void fgrid_advise(FGRID g, int x1, int y1, int x2, int y2, int advice)
+{
+   int x, y;
+
+   for (y = y1 & ~GRID_TILE_MASK; y <= y2; y += GRID_TILE)
+      for (x = x1 & ~GRID_TILE_MASK; x <= x2; x += GRID_TILE)
+	 mem_advise(FGRID_TILE(g, x, y), GRID_TILE * GRID_TILE *
+		sizeof(float), advice);
+}
+
+/*--------------------------------------------------------------*/
+/* fgrid_free --- free grid "g" and all of its tiles		*/
+/*--------------------------------------------------------------*/
+
+void fgrid_free(FGRID g)
+{
+   int i;
+
+   for (i = 0; i < g->tilesx * g->tilesy; i++)
+      mem_page_free(g->category, g->tiles[i], GRID_TILE * GRID_TILE *
+		sizeof(float));
+   mem_free(g->category, g->tiles, g->tilesx * g->tilesy * sizeof(float *));
+   mem_free(g->category, g, sizeof(struct fgrid_));
+}
+
+// The page of zeros every PGRID starts with, and the shared pages
+// of other values made by pgrid_share_uniform()
+
+static struct pgpage_ PgridZero = { PGRID_SHARED };
+static PGPAGE *PgridUniform = NULL;
+static int PgridNumUniform = 0;
+
+/*--------------------------------------------------------------*/
+/* pgrid_new --- make a paged grid of "nx" by "ny" positions,	*/
+/*	all zero, counting its memory in "category".		*/
+/*								*/
+/* Return value:  the new grid					*/
+/*--------------------------------------------------------------*/
+
+PGRID pgrid_new(int nx, int ny, int category)
+{
+   PGRID g;
+   int i;
+
+   g = (PGRID)mem_malloc(category, sizeof(struct pgrid_));
+   if (g == NULL) {
+      fprintf(stderr, "Out of memory in pgrid_new().\n");
+      exit(5);
+   }
+   g->pagesx = (nx + PGRID_PAGE - 1) >> PGRID_SHIFT;
+   g->pagesy = (ny + PGRID_PAGE - 1) >> PGRID_SHIFT;
+   g->category = category;
+   g->pages = (PGPAGE *)mem_malloc(category, g->pagesx * g->pagesy *
+		sizeof(PGPAGE));
+   if (g->pages == NULL) {
+      fprintf(stderr, "Out of memory in pgrid_new().\n");
+      exit(5);
+   }
+   for (i = 0; i < g->pagesx * g->pagesy; i++)
+      g->pages[i] = &PgridZero;
+   return g;
+}
+
+/*--------------------------------------------------------------*/
+/* pgrid_release --- let go of "page", held by a grid counted	*/
+/*	in "category", freeing it if no other grid holds it.	*/
+/*--------------------------------------------------------------*/
+
+static void pgrid_release(int category, PGPAGE page)
+{
+   if (page->refs == PGRID_SHARED) return;
+   if (__sync_sub_and_fetch(&page->refs, 1) == 0)
+      mem_page_free(category, page, sizeof(struct pgpage_));
+}
+
+/*--------------------------------------------------------------*/
+/* pgrid_write --- make the page of grid "g" holding position	*/
+/*	(x, y) private to the grid, copying it if it is shared.	*/
+/*	If another thread makes the page private first, its	*/
+/*	copy is used.						*/
+/*								*/
+/* Return value:  pointer to position (x, y), which may be	*/
+/*	written							*/
+/*--------------------------------------------------------------*/
+
+u_int *pgrid_write(PGRID g, int x, int y)
+{
+   PGPAGE *slot, page, copy;
+
+   slot = &PGRID_AT(g, x, y);
+   while ((page = *slot)->refs != 1) {
+      copy = (PGPAGE)mem_page_alloc(g->category, sizeof(struct pgpage_));
+      if (copy == NULL) {
+	 fprintf(stderr, "Out of memory in pgrid_write().\n");
+	 exit(5);
+      }
+      copy->refs = 1;
+      memcpy(copy->data, page->data, sizeof(copy->data));
+      if (__sync_bool_compare_and_swap(slot, page, copy)) {
+	 pgrid_release(g->category, page);
+	 break;
+      }
+      mem_page_free(g->category, copy, sizeof(struct pgpage_));
+   }
+   return &(*slot)->data[PGRID_OFFSET(x, y)];
+}
+
+/*--------------------------------------------------------------*/
+/* pgrid_uniform --- find the shared page holding "value" at	*/
+/*	every position, making it if there is none yet.		*/
+/*	Called from the main thread only.			*/
+/*								*/
+/* Return value:  the shared page				*/
+/*--------------------------------------------------------------*/
+
+static PGPAGE pgrid_uniform(u_int value, int category)
+{
+   PGPAGE page;
+   int i;
+
+   if (value == 0) return &PgridZero;
+   for (i = 0; i < PgridNumUniform; i++)
+      if (PgridUniform[i]->data[0] == value)
+	 return PgridUniform[i];
+
+   page = (PGPAGE)mem_page_alloc(category, sizeof(struct pgpage_));
+   PgridUniform = (PGPAGE *)realloc(PgridUniform, (PgridNumUniform + 1) *
+		sizeof(PGPAGE));
+   if ((page == NULL) || (PgridUniform == NULL)) {
+      fprintf(stderr, "Out of memory in pgrid_uniform().\n");
+      exit(5);
+   }
+   page->refs = PGRID_SHARED;
+   for (i = 0; i < PGRID_PAGE * PGRID_PAGE; i++)
+      page->data[i] = value;
+   PgridUniform[PgridNumUniform++] = page;
+   return page;
+}
+
+/*--------------------------------------------------------------*/
+/* pgrid_share_uniform --- replace every private page of grid	*/
+/*	"g" holding the same value at all of its positions with	*/
+/*	the shared page of that value.  Positions past the edge	*/
+/*	of the grid are never written, so a page at the edge is	*/
+/*	only replaced if it is all zero.			*/
+/*--------------------------------------------------------------*/
+
+void pgrid_share_uniform(PGRID g)
+{
+   PGPAGE page;
+   u_int value;
+   int i, k;
+
+   for (i = 0; i < g->pagesx * g->pagesy; i++) {
+      page = g->pages[i];
+      if (page->refs != 1) continue;
+      value = page->data[0];
+      for (k = 1; k < PGRID_PAGE * PGRID_PAGE; k++)
+	 if (page->data[k] != value) break;
+      if (k < PGRID_PAGE * PGRID_PAGE) continue;
+      g->pages[i] = pgrid_uniform(value, g->category);
+      pgrid_release(g->category, page);
+   }
+}
+
+/*--------------------------------------------------------------*/
+/* pgrid_copy --- make grid "dst" a copy of grid "src", sharing	*/
+/*	all of its pages.  If "dst" is NULL, a new grid is made.	*/
+/*	Neither grid may be written by another thread meanwhile.	*/
+/*								*/
+/* Return value:  the copy					*/
+/*--------------------------------------------------------------*/
+
+PGRID pgrid_copy(PGRID dst, PGRID src)
+{
+   PGPAGE page;
+   int i;
+
+   if (dst == NULL)
+      dst = pgrid_new(src->pagesx << PGRID_SHIFT, src->pagesy << PGRID_SHIFT,
+		src->category);
+
+   for (i = 0; i < src->pagesx * src->pagesy; i++) {
+      page = src->pages[i];
+      if (page == dst->pages[i]) continue;
+      if (page->refs != PGRID_SHARED)
+	 __sync_add_and_fetch(&page->refs, 1);
+      pgrid_release(dst->category, dst->pages[i]);
+      dst->pages[i] = page;
+   }
+   return dst;
+}
+
+/*--------------------------------------------------------------*/
+/* pgrid_copy_region --- copy the positions from (x1, y1) to	*/
+/*	(x2, y2) of grid "src" into grid "dst".  Positions that	*/
+/*	already match are not written, so that pages the grids	*/
+/*	share stay shared.					*/
+/*--------------------------------------------------------------*/
+
+void pgrid_copy_region(PGRID dst, PGRID src, int x1, int y1, int x2, int y2)
+{
+   int x, y;
+   u_int value;
+
+   for (y = y1; y <= y2; y++)
+      for (x = x1; x <= x2; x++) {
+	 if (PGRID_AT(dst, x, y) == PGRID_AT(src, x, y)) {
+	    x |= PGRID_MASK;		// Whole page in common
+	    continue;
+	 }
+	 value = PGRID_GET(src, x, y);
+	 if (PGRID_GET(dst, x, y) != value)
+	    *PGRID_PTR(dst, x, y) = value;
+      }
+}
+
+/*--------------------------------------------------------------*/
+/* pgrid_advise --- pass "advice" (see mem_advise()) on the	*/
+/*	pages of grid "g" covering positions (x1, y1) to	*/
+/*	(x2, y2).						*/
+/*--------------------------------------------------------------*/
+
+void pgrid_advise(PGRID g, int x1, int y1, int x2, int y2, int advice)
+{
+   PGPAGE page;
+   int x, y;
+
+   for (y = y1 & ~PGRID_MASK; y <= y2; y += PGRID_PAGE)
+      for (x = x1 & ~PGRID_MASK; x <= x2; x += PGRID_PAGE) {
+	 page = PGRID_AT(g, x, y);
+	 if (page != &PgridZero)
+	    mem_advise(page, sizeof(struct pgpage_), advice);
+      }
+}
+
+/*--------------------------------------------------------------*/
+/* pgrid_free --- free grid "g", and every page no other grid	*/
+/*	holds.							*/
+/*--------------------------------------------------------------*/
+
+void pgrid_free(PGRID g)
+{
+   int i;
+
+   for (i = 0; i < g->pagesx * g->pagesy; i++)
+      pgrid_release(g->category, g->pages[i]);
+   mem_free(g->category, g->pages, g->pagesx * g->pagesy * sizeof(PGPAGE));
+   mem_free(g->category, g, sizeof(struct pgrid_));
+}
+
+/* end of grid.c */
@@ -0,0 +1,109 @@
+/*--------------------------------------------------------------*/
+/* grid.h -- sparse and paged grids of values kept in tiles	*/
+/*--------------------------------------------------------------*/
+
+#ifndef GRID_H
+
+// A sparse grid of floats covering one route layer.  The grid is
+// cut into square tiles of GRID_TILE x GRID_TILE positions, and a
+// tile is allocated only when a non-zero value is first written in
+// it;  all positions of a missing tile read as zero.  Used where
+// only positions near pins and obstructions hold values, so that
+// memory follows the number of pins rather than the die area.
+
+#define GRID_TILE_SHIFT	4
+#define GRID_TILE	(1 << GRID_TILE_SHIFT)
+#define GRID_TILE_MASK	(GRID_TILE - 1)
+
+struct fgrid_ {
+   float **tiles;	// tiles by row, then column;  NULL if all zero
+   int   tilesx;	// tiles per row
+   int   tilesy;	// rows of tiles
+   int   category;	// memory category of the tiles (see mem.h)
+};
+
+#define FGRID_TILE(g, x, y) ((g)->tiles[((y) >> GRID_TILE_SHIFT) * \
+		(g)->tilesx + ((x) >> GRID_TILE_SHIFT)])
+#define FGRID_OFFSET(x, y) ((((y) & GRID_TILE_MASK) << GRID_TILE_SHIFT) | \
+		((x) & GRID_TILE_MASK))
+#define FGRID_GET(g, x, y) ((FGRID_TILE(g, x, y) == NULL) ? (float)0.0 : \
+		FGRID_TILE(g, x, y)[FGRID_OFFSET(x, y)])
+
+// Stub[] and Obsinfo[] values at grid position (x, y) of a layer
+
+#define STUB(x, y, layer)	FGRID_GET(Stub[layer], x, y)
+#define OBSINFO(x, y, layer)	FGRID_GET(Obsinfo[layer], x, y)
+#define SET_STUB(x, y, layer, value) \
+		fgrid_set(Stub[layer], x, y, value)
+#define SET_OBSINFO(x, y, layer, value) \
+		fgrid_set(Obsinfo[layer], x, y, value)
+
+FGRID	fgrid_new(int nx, int ny, int category);
+void	fgrid_set(FGRID g, int x, int y, float value);
+void	fgrid_advise(FGRID g, int x1, int y1, int x2, int y2, int advice);
+void	fgrid_free(FGRID g);
+
+// A paged grid of u_int covering one route layer, for the grids read
+// everywhere on the die (Obs[] and Nodeidx[]).  The grid is cut into
+// square pages of PGRID_PAGE x PGRID_PAGE positions, and every page
+// of a new grid is one shared, read-only page of zeros.  A shared
+// page is copied the first time it is written, so memory follows
+// the area actually written rather than the die area.  Once the
+// obstructions are in, pgrid_share_uniform() swaps every page
+// holding a single value (an empty or fully blocked area) for a
+// shared page of that value, and pgrid_copy() makes a copy of a grid
+// sharing all of its pages.
+//
+// Reads go through PGRID_GET() and writes through the pointer given
+// by PGRID_PTR(), which makes the page private first.  Pages are
+// swapped in atomically, so threads may write different positions
+// of one grid, but a grid whose pages are shared with a copy must
+// be written by one thread at a time.
+
+#define PGRID_SHIFT	5
+#define PGRID_PAGE	(1 << PGRID_SHIFT)
+#define PGRID_MASK	(PGRID_PAGE - 1)
+#define PGRID_SHARED	(-1)	// refs of a page never freed
+
+struct pgpage_ {
+   int   refs;		// grids holding the page, or PGRID_SHARED
+   u_int data[PGRID_PAGE * PGRID_PAGE];
+};
+
+typedef struct pgpage_ *PGPAGE;
+
+struct pgrid_ {
+   PGPAGE *pages;	// pages by row, then column;  never NULL
+   int    pagesx;	// pages per row
+   int    pagesy;	// rows of pages
+   int    category;	// memory category of the pages (see mem.h)
+};
+
+#define PGRID_AT(g, x, y) ((g)->pages[((y) >> PGRID_SHIFT) * \
+		(g)->pagesx + ((x) >> PGRID_SHIFT)])
+#define PGRID_OFFSET(x, y) ((((y) & PGRID_MASK) << PGRID_SHIFT) | \
+		((x) & PGRID_MASK))
+#define PGRID_GET(g, x, y) (PGRID_AT(g, x, y)->data[PGRID_OFFSET(x, y)])
+#define PGRID_PTR(g, x, y) ((PGRID_AT(g, x, y)->refs == 1) ? \
+		&PGRID_AT(g, x, y)->data[PGRID_OFFSET(x, y)] : \
+		pgrid_write(g, x, y))
+
+// Obs[] value at grid position (x, y) of a layer, and a pointer
+// through which it may be changed
+
+#define OBSVAL(x, y, layer)	PGRID_GET(Obs[layer], x, y)
+#define OBSPTR(x, y, layer)	PGRID_PTR(Obs[layer], x, y)
+
+PGRID	pgrid_new(int nx, int ny, int category);
+u_int	*pgrid_write(PGRID g, int x, int y);
+void	pgrid_share_uniform(PGRID g);
+PGRID	pgrid_copy(PGRID dst, PGRID src);
+void	pgrid_copy_region(PGRID dst, PGRID src, int x1, int y1, int x2,
+		int y2);
+void	pgrid_advise(PGRID g, int x1, int y1, int x2, int y2, int advice);
+void	pgrid_free(PGRID g);
+
+#define GRID_H
+#endif
+
+/* end of grid.h */
@@ -0,0 +1,197 @@
+/*--------------------------------------------------------------*/
+/* hash.c -- string-keyed hash tables				*/
+/*								*/
+/* Chained hash tables mapping a name to a pointer, used to	*/
+/* look up instances, macro pins, and nets by name without	*/
+/* walking their linked lists.  Tables may be case-sensitive	*/
+/* (matching strcmp()) or case-insensitive (matching		*/
+/* strcasecmp()).  The bin array doubles when the table fills.	*/
+/* Also keeps the table of interned names.			*/
+/*--------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "qrouter.h"
+#include "hash.h"
+#include "mem.h"
+
+// Interned names, keyed by their stored copy, and the block the
+// next names are stored in
+
+static struct hashtable_ NameTable;
+static char *NameNext = NULL;
+static char *NameEnd = NULL;
+
+/*--------------------------------------------------------------*/
+/* hash_string --- FNV-1a hash of a string, optionally folding	*/
+/*	case so that case-insensitive keys hash equally.	*/
+/*--------------------------------------------------------------*/
+
+u_int hash_string(char *key, u_char nocase)
+{
+   u_int h = 2166136261U;
+   u_char c;
+
+   while ((c = (u_char)*key++) != '\0') {
+      if (nocase) c = (u_char)tolower(c);
+      h ^= c;
+      h *= 16777619U;
+   }
+   return h;
+}
+
+/*--------------------------------------------------------------*/
+/* hash_init --- initialize an empty table with at least	*/
+/*	"size" bins.						*/
+/*--------------------------------------------------------------*/
+
+void hash_init(HASHTABLE ht, int size, u_char nocase)
+{
+   int n;
+
+   for (n = 16; n < size; n <<= 1);
+   ht->bins = (HASHENT *)calloc(n, sizeof(HASHENT));
+   if (ht->bins == NULL) {
+      fprintf(stderr, "Out of memory in hash_init().\n");
+      exit(10);
+   }
+   ht->size = n;
+   ht->count = 0;
+   ht->nocase = nocase;
+}
+
+/*--------------------------------------------------------------*/
+/* hash_lookup --- return the value stored under "key", or	*/
+/*	NULL if there is none.  If the key was inserted more	*/
+/*	than once, the most recent value is returned.		*/
+/*--------------------------------------------------------------*/
+
+void *hash_lookup(HASHTABLE ht, char *key)
+{
+   HASHENT he;
+
+   if (ht->bins == NULL) return NULL;
+
+   he = ht->bins[hash_string(key, ht->nocase) & (ht->size - 1)];
+   for (; he; he = he->next) {
+      if (he->key == key) return he->value;
+      if (ht->nocase) {
+	 if (!strcasecmp(he->key, key)) return he->value;
+      }
+      else {
+	 if (!strcmp(he->key, key)) return he->value;
+      }
+   }
+   return NULL;
+}
+
+/*--------------------------------------------------------------*/
+/* hash_insert --- add "value" to the table under "key".	*/
+/*--------------------------------------------------------------*/
+
+void hash_insert(HASHTABLE ht, char *key, void *value)
+{
+   HASHENT he, next, *newbins;
+   int i, newsize;
+   u_int h;
+
+   if (ht->bins == NULL) hash_init(ht, 0, ht->nocase);
+
+   // Double the number of bins when the average chain length
+   // reaches 2.
+
+   if (ht->count >= (ht->size << 1)) {
+      newsize = ht->size << 1;
+      newbins = (HASHENT *)calloc(newsize, sizeof(HASHENT));
+      if (newbins == NULL) {
+	 fprintf(stderr, "Out of memory in hash_insert().\n");
+	 exit(10);
+      }
+      // Rehash in order, so that entries of equal key keep their order
+      for (i = 0; i < ht->size; i++) {
+	 for (he = ht->bins[i]; he; he = next) {
+	    HASHENT *tail;
+	    next = he->next;
+	    h = hash_string(he->key, ht->nocase) & (newsize - 1);
+	    for (tail = &newbins[h]; *tail; tail = &(*tail)->next);
+	    he->next = NULL;
+	    *tail = he;
+	 }
+      }
+      free(ht->bins);
+      ht->bins = newbins;
+      ht->size = newsize;
+   }
+
+   he = (HASHENT)malloc(sizeof(struct hashent_));
+   if (he == NULL) {
+      fprintf(stderr, "Out of memory in hash_insert().\n");
+      exit(10);
+   }
+   h = hash_string(key, ht->nocase) & (ht->size - 1);
+   he->key = key;
+   he->value = value;
+   he->next = ht->bins[h];
+   ht->bins[h] = he;
+   ht->count++;
+}
+
+/*--------------------------------------------------------------*/
+/* hash_clear --- remove all entries and free the bin array.	*/
+/*--------------------------------------------------------------*/
+
+void hash_clear(HASHTABLE ht)
+{
+   HASHENT he, next;
+   int i;
+
+   if (ht->bins == NULL) return;
+   for (i = 0; i < ht->size; i++) {
+      for (he = ht->bins[i]; he; he = next) {
+	 next = he->next;
+	 free(he);
+      }
+   }
+   free(ht->bins);
+   ht->bins = NULL;
+   ht->size = ht->count = 0;
+}
+
+/*--------------------------------------------------------------*/
+/* name_intern --- return the stored copy of "name", storing	*/
+/*	it first if it is new.  Short names are packed into	*/
+/*	blocks of NAME_BLOCK bytes.				*/
+/*--------------------------------------------------------------*/
+
+char *name_intern(char *name)
+{
+   char *stored;
+   size_t len;
+
+   stored = (char *)hash_lookup(&NameTable, name);
+   if (stored != NULL) return stored;
+
+   len = strlen(name) + 1;
+   if (len > (NAME_BLOCK >> 4))
+      stored = (char *)mem_malloc(MEM_NETLIST, len);
+   else {
+      if ((size_t)(NameEnd - NameNext) < len) {
+	 NameNext = (char *)mem_malloc(MEM_NETLIST, NAME_BLOCK);
+	 NameEnd = NameNext + NAME_BLOCK;
+      }
+      stored = NameNext;
+      NameNext += len;
+   }
+   if (stored == NULL) {
+      fprintf(stderr, "Out of memory in name_intern().\n");
+      exit(10);
+   }
+   memcpy(stored, name, len);
+   hash_insert(&NameTable, stored, stored);
+   return stored;
+}
+
+/* end of hash.c */
@@ -0,0 +1,46 @@
+/*--------------------------------------------------------------*/
+/* hash.h -- string-keyed hash tables				*/
+/*--------------------------------------------------------------*/
+
+#ifndef HASH_H
+
+// A hash table entry.  The key string is not copied, so it must
+// remain valid for as long as the entry is in the table.
+
+typedef struct hashent_ *HASHENT;
+
+struct hashent_ {
+   HASHENT next;
+   char    *key;
+   void    *value;
+};
+
+typedef struct hashtable_ *HASHTABLE;
+
+struct hashtable_ {
+   HASHENT *bins;
+   int     size;		// number of bins (a power of 2)
+   int     count;		// number of entries
+   u_char  nocase;		// TRUE if keys are compared case-insensitively
+};
+
+void	hash_init(HASHTABLE ht, int size, u_char nocase);
+void	*hash_lookup(HASHTABLE ht, char *key);
+void	hash_insert(HASHTABLE ht, char *key, void *value);
+void	hash_clear(HASHTABLE ht);
+
+// Names of nets, instances, macros and pins are interned:  each
+// distinct name is stored once, and never freed, so that two
+// interned names are equal exactly when their pointers are.  A
+// lookup whose key is the very string stored in the table is
+// matched without comparing characters.  Interning is done while
+// reading the input files, from the main thread only.
+
+#define NAME_BLOCK	16384	// bytes of names stored per block
+
+char	*name_intern(char *name);
+
+#define HASH_H
+#endif
+
+/* end of hash.h */
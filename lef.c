@@ -33,6 +33,8 @@
 #include "config.h"
 #include "maze.h"
 #include "lef.h"
+#include "mem.h"
+#include "hash.h"
 
 /* ---------------------------------------------------------------------*/
 
@@ -436,6 +438,112 @@ lefFindCell(char *name)
     return (GATE)NULL;
 }
 
+/*
+ *------------------------------------------------------------
+ *
+ * gate_pin_space --
+ *
+ *	Number of pins the arrays of a gate with "nodes" pins
+ *	have room for:  "nodes" rounded up to a power of two,
+ *	so that adding pins one at a time moves the arrays
+ *	only a few times.
+ *
+ * Results:
+ *	Number of pins.
+ *
+ * Side Effects:
+ *	None.
+ *
+ *------------------------------------------------------------
+ */
+
+int
+gate_pin_space(int nodes)
+{
+    int space;
+
+    for (space = 1; space < nodes; space <<= 1);
+    return (nodes > 0) ? space : 0;
+}
+
+/*
+ *------------------------------------------------------------
+ *
+ * gate_add_pins --
+ *
+ *	Grow the pin name and tap arrays of the GateInfo
+ *	entry "gate" to hold "nodes" pins.
+ *
+ * Results:
+ *	None.
+ *
+ * Side Effects:
+ *	The new pins have no name and no taps until they
+ *	are read.  gate->nodes is set to "nodes".  The arrays
+ *	have room for gate_pin_space(gate->nodes) pins.
+ *
+ *------------------------------------------------------------
+ */
+
+void
+gate_add_pins(GATE gate, int nodes)
+{
+    int i, oldspace, space;
+
+    if (nodes <= gate->nodes) return;
+    oldspace = gate_pin_space(gate->nodes);
+    space = gate_pin_space(nodes);
+    if (space > oldspace) {
+	gate->node = (char **)mem_realloc(MEM_NETLIST, gate->node,
+		oldspace * sizeof(char *), space * sizeof(char *));
+	gate->taps = (DSEG *)mem_realloc(MEM_NETLIST, gate->taps,
+		oldspace * sizeof(DSEG), space * sizeof(DSEG));
+	if ((gate->node == NULL) || (gate->taps == NULL)) {
+	    fprintf(stderr, "Out of memory in gate_add_pins().\n");
+	    exit(5);
+	}
+    }
+    for (i = gate->nodes; i < nodes; i++) {
+	gate->node[i] = NULL;
+	gate->taps[i] = (DSEG)NULL;
+    }
+    gate->nodes = nodes;
+}
+
+/*
+ *------------------------------------------------------------
+ *
+ * gate_alloc_pins --
+ *
+ *	Give the instance "gate" the pins of its GateInfo
+ *	entry "gateinfo".
+ *
+ * Results:
+ *	None.
+ *
+ * Side Effects:
+ *	The pin names are those of "gateinfo";  the nets,
+ *	node records and taps of the pins belong to the
+ *	instance, and start out empty.
+ *
+ *------------------------------------------------------------
+ */
+
+void
+gate_alloc_pins(GATE gate, GATE gateinfo)
+{
+    gate->nodes = gateinfo->nodes;
+    gate->node = gateinfo->node;
+    gate->netnum = (int *)mem_calloc(MEM_NETLIST, gate->nodes, sizeof(int));
+    gate->noderec = (NODE *)mem_calloc(MEM_NETLIST, gate->nodes, sizeof(NODE));
+    gate->taps = (DSEG *)mem_calloc(MEM_NETLIST, gate->nodes, sizeof(DSEG));
+    if ((gate->nodes > 0) && ((gate->netnum == NULL) ||
+		(gate->noderec == NULL) || (gate->taps == NULL))) {
+	fprintf(stderr, "Out of memory in gate_alloc_pins().\n");
+	exit(5);
+    }
+}
+
 /*
  *------------------------------------------------------------
  *
@@ -507,7 +615,7 @@ LefRedefined(LefList lefl, char *redefname)
 
         while (lefl->info.via.lr) {
 	   drect = lefl->info.via.lr->next;
-	   free(lefl->info.via.lr);
+	   mem_free(MEM_GEOMETRY, lefl->info.via.lr, sizeof(struct dseg_));
 	   lefl->info.via.lr = drect;
 	}
 	newlefl = lefl;
@@ -1178,7 +1286,7 @@ LefPolygonToRects(DSEG *rectListPtr, DPOINT pointlist)
 
    if ((ptail->x != pointlist->x) || (ptail->y != pointlist->y))
    {
-	p = (DPOINT)malloc(sizeof(struct dpoint_));
+	p = (DPOINT)mem_malloc(MEM_GEOMETRY, sizeof(struct dpoint_));
 	p->x = pointlist->x;
 	p->y = pointlist->y;
 	p->layer = pointlist->layer;
@@ -1255,7 +1363,7 @@ LefPolygonToRects(DSEG *rectListPtr, DPOINT pointlist)
 	    {
 		xtop = edges[n]->x;
 		if (xbot == xtop) continue;
-		new = (DSEG)malloc(sizeof(struct dseg_));
+		new = (DSEG)mem_malloc(MEM_GEOMETRY, sizeof(struct dseg_));
 		new->x1 = xbot;
 		new->x2 = xtop;
 		new->y1 = ybot;
@@ -1321,7 +1429,7 @@ LefReadPolygon(FILE *f, int curlayer, float oscale)
 	    break;
 	}
 
-	newPoint = (DPOINT)malloc(sizeof(struct dpoint_));
+	newPoint = (DPOINT)mem_malloc(MEM_GEOMETRY, sizeof(struct dpoint_));
 	newPoint->x = px / (double)oscale;
 	newPoint->y = py / (double)oscale;
 	newPoint->layer = curlayer;
@@ -1401,7 +1509,8 @@ LefReadGeometry(GATE lefMacro, FILE *f, float oscale)
 		if (paintrect)
 		{
 		    /* Remember the area and layer */
-		    newRect = (DSEG)malloc(sizeof(struct dseg_));
+		    newRect = (DSEG)mem_malloc(MEM_GEOMETRY,
+				    sizeof(struct dseg_));
 		    *newRect = *paintrect;
 		    newRect->next = rectList;
 		    rectList = newRect;
@@ -1458,17 +1567,15 @@ LefReadPort(lefMacro, f, pinName, pinNum, pinDir, pinUse, oscale)
 
     rectList = LefReadGeometry(lefMacro, f, oscale);
 
-    if (pinName != NULL) lefMacro->node[pinNum] = strdup(pinName);
-
     if (pinNum >= 0) {
+	gate_add_pins(lefMacro, pinNum + 1);
+	if (pinName != NULL) lefMacro->node[pinNum] = name_intern(pinName);
 	lefMacro->taps[pinNum] = rectList;
-	if (lefMacro->nodes <= pinNum)
-	    lefMacro->nodes = (pinNum + 1);
     }
     else {
        while (rectList) {
 	  rlist = rectList->next;
-	  free(rectList);
+	  mem_free(MEM_GEOMETRY, rectList, sizeof(struct dseg_));
 	  rectList = rlist;
        }
     }
@@ -1696,16 +1803,21 @@ LefReadMacro(f, mname, oscale)
 	LefError("Cell \"%s\" was already defined in this file.  "
 		"Renaming original cell \"%s\"\n", mname, newname);
 
-	lefMacro->gatetype = strdup(newname);
+	lefMacro->gatetype = name_intern(newname);
 	lefMacro = lefFindCell(mname);
     }
 
     // Create the new cell
-    lefMacro = (GATE)malloc(sizeof(struct gate_));
-    lefMacro->gatetype = strdup(mname);
+    lefMacro = (GATE)mem_malloc(MEM_NETLIST, sizeof(struct gate_));
+    lefMacro->gatetype = name_intern(mname);
     lefMacro->gatename = NULL;
     lefMacro->obs = (DSEG)NULL;
+    lefMacro->nodetable = NULL;
     lefMacro->nodes = 0;
+    lefMacro->node = NULL;
+    lefMacro->netnum = NULL;
+    lefMacro->noderec = NULL;
+    lefMacro->taps = NULL;
     lefMacro->width = 0.0;
     lefMacro->height = 0.0;
     lefMacro->placedX = 0.0;
@@ -1891,7 +2003,7 @@ LefAddViaGeometry(FILE *f, LefList lefl, int curlayer, float oscale)
     }
     else 
     {
-	viarect = (DSEG)malloc(sizeof(struct dseg_));
+	viarect = (DSEG)mem_malloc(MEM_GEOMETRY, sizeof(struct dseg_));
 	*viarect = *currect;
 	viarect->next = lefl->info.via.lr;
 	lefl->info.via.lr = viarect;
@@ -2364,23 +2476,28 @@ LefRead(inName)
 
     if (!gateginfo) {
 	/* Add a new GateInfo entry for pseudo-gate "pin" */
-	gateginfo = (GATE)malloc(sizeof(struct gate_));
-	gateginfo->gatetype = (char *)malloc(4);
-	strcpy(gateginfo->gatetype, "pin");
-	gateginfo->node[0] = strdup("pin");
+	gateginfo = (GATE)mem_malloc(MEM_NETLIST, sizeof(struct gate_));
+	gateginfo->gatetype = name_intern("pin");
+	gateginfo->nodes = 0;
+	gateginfo->node = NULL;
+	gateginfo->netnum = NULL;
+	gateginfo->noderec = NULL;
+	gateginfo->taps = NULL;
+	gate_add_pins(gateginfo, 1);
+	gateginfo->node[0] = name_intern("pin");
 	gateginfo->gatename = NULL;
 	gateginfo->width = 0.0;
 	gateginfo->height = 0.0;
 	gateginfo->placedX = 0.0;
 	gateginfo->placedY = 0.0;
-	gateginfo->nodes = 1;
 
-	grect = (DSEG)malloc(sizeof(struct dseg_));
+	grect = (DSEG)mem_malloc(MEM_GEOMETRY, sizeof(struct dseg_));
 	grect->x1 = grect->x2 = 0.0;
 	grect->y1 = grect->y2 = 0.0;
 	grect->next = (DSEG)NULL;
 	gateginfo->taps[0] = grect;
 	gateginfo->obs = (DSEG)NULL;
+	gateginfo->nodetable = NULL;
 	gateginfo->next = GateInfo;
 	GateInfo = gateginfo;
     }
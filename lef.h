@@ -114,6 +114,8 @@ u_char LefParseEndStatement(FILE *f, char *match);
 void  LefSkipSection(FILE *f, char *match);
 void  LefEndStatement(FILE *f);
 GATE  lefFindCell(char *name);
+void  gate_add_pins(GATE gate, int nodes);
+void  gate_alloc_pins(GATE gate, GATE gateinfo);
 char *LefNextToken(FILE *f, u_char ignore_eol);
 char *LefLower(char *token);
 DSEG  LefReadGeometry(GATE lefMacro, FILE *f, float oscale);
@@ -136,6 +138,11 @@ int    LefGetRouteOrientation(int layer);
 
 void   LefRead(char *inName);
 float  DefRead(char *inName);
+NET    DefFindNet(char *netname);
+NET    DefFindNetNum(int netnum);
+
+extern double GCellStepX;	/* GCELLGRID spacing in microns, or 0	*/
+extern double GCellStepY;
 
 void LefError(char *fmt, ...);	/* Variable argument procedure requires */
 				/* parameter list.			*/
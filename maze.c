@@ -20,20 +20,228 @@
 #include "node.h"
 #include "maze.h"
 #include "lef.h"
+#include "queue.h"
+#include "negotiate.h"
+#include "grid.h"
+#include "mem.h"
 
 extern int TotalRoutes;
 
+/*--------------------------------------------------------------*/
+/* new_route_context() ---					*/
+/*								*/
+/* Allocate a search context, with its own obs2[][] working	*/
+/* grid, search mask and priority queue.  Called once Obs[][]	*/
+/* has been set up, since the grids are sized to match it.	*/
+/*								*/
+/* Return value:  the new context				*/
+/*--------------------------------------------------------------*/
+
+ROUTECTX new_route_context()
+{
+    ROUTECTX ctx;
+    int i;
+
+    ctx = (ROUTECTX)mem_calloc(MEM_SEARCH, 1, sizeof(struct routectx_));
+    if (ctx) ctx->queue = (struct pqueue_ *)mem_malloc(MEM_SEARCH,
+		sizeof(struct pqueue_));
+    if (!ctx || !ctx->queue) {
+       fprintf(stderr, "Out of memory in new_route_context().\n");
+       exit(9);
+    }
+
+    for (i = 0; i < Num_layers; i++) {
+       ctx->obs2[i] = (PROUTE *)mem_map(MEM_OBS2,
+			OBS2_SIZE(i) * sizeof(PROUTE));
+       if (!ctx->obs2[i]) {
+          fprintf(stderr, "Out of memory 9.\n");
+          exit(9);
+       }
+       if (SearchCorridor || GlobalRoute) {
+          ctx->mask[i] = (u_char *)mem_calloc(MEM_MASK, MASK_BYTES(i),
+			sizeof(u_char));
+          if (!ctx->mask[i]) {
+	     fprintf(stderr, "Out of memory 3.\n");
+	     exit(3);
+          }
+       }
+    }
+
+    pq_init(ctx->queue, (SearchMode == SEARCH_DIAL) ? PQ_BUCKET : PQ_HEAP,
+		max_step_cost());
+
+    // By default, messages go to stdout and the search may use the
+    // whole grid.
+
+    ctx->log = stdout;
+    ctx->bounds.x1 = ctx->bounds.y1 = 0;
+    ctx->bounds.x2 = NumChannelsX[0] - 1;
+    ctx->bounds.y2 = NumChannelsY[0] - 1;
+    ctx->bounded = FALSE;
+    ctx->window.x2 = -1;
+    reset_touched(ctx);
+    return ctx;
+}
+
+/*--------------------------------------------------------------*/
+/* free_route_context() ---					*/
+/*								*/
+/* Free a search context made by new_route_context(), with	*/
+/* its grids, queue and POINT blocks.				*/
+/*--------------------------------------------------------------*/
+
+void free_route_context(ROUTECTX ctx)
+{
+    int i;
+
+    for (i = 0; i < Num_layers; i++) {
+       mem_unmap(MEM_OBS2, ctx->obs2[i], OBS2_SIZE(i) * sizeof(PROUTE));
+       mem_free(MEM_MASK, ctx->mask[i], MASK_BYTES(i));
+    }
+    pq_free(ctx->queue);
+    point_pool_free(ctx);
+    mem_free(MEM_SEARCH, ctx->queue, sizeof(struct pqueue_));
+    mem_free(MEM_SEARCH, ctx, sizeof(struct routectx_));
+}
+
+/*--------------------------------------------------------------*/
+/* new_obs2_epoch() ---						*/
+/*								*/
+/* Invalidate all of ctx->obs2[][] at the start of a search	*/
+/* for net "netnum".  Each position is rebuilt from Obs[][] by	*/
+/* init_obs2() when it is first accessed through OBS2().	*/
+/* When the 16-bit epoch wraps around, all stamps are cleared	*/
+/* so that no position can appear current by accident.		*/
+/*--------------------------------------------------------------*/
+
+void new_obs2_epoch(ROUTECTX ctx, int netnum)
+{
+    int i, x, y;
+
+    ctx->netnum = netnum;
+    if (++ctx->epoch == 0) {
+       for (i = 0; i < Num_layers; i++)
+	  for (x = 0; x < NumChannelsX[i]; x++)
+	     for (y = 0; y < NumChannelsY[i]; y++)
+		ctx->obs2[i][O2GRID(x, y, i)].epoch = 0;
+       ctx->epoch = 1;
+    }
+}
+
+/*--------------------------------------------------------------*/
+/* reset_touched() ---						*/
+/*								*/
+/* Empty the extent of positions read by the searches of a	*/
+/* context.  Every position the search reads is first copied	*/
+/* from Obs[][] by init_obs2(), which grows the extent.		*/
+/*--------------------------------------------------------------*/
+
+void reset_touched(ROUTECTX ctx)
+{
+    ctx->touched.x1 = NumChannelsX[0];
+    ctx->touched.y1 = NumChannelsY[0];
+    ctx->touched.x2 = ctx->touched.y2 = -1;
+}
+
+/*--------------------------------------------------------------*/
+/* advise_window() ---						*/
+/*								*/
+/* Pass "advice" (see mem_advise()) on the parts of the grids	*/
+/* a search of "ctx" reads over the area "window".		*/
+/*--------------------------------------------------------------*/
+
+static void advise_window(ROUTECTX ctx, SEG window, int advice)
+{
+    int i, ty, tx1, tx2;
+
+    for (i = 0; i < Num_layers; i++) {
+       tx1 = window->x1 >> OBS2_SHIFT;
+       tx2 = window->x2 >> OBS2_SHIFT;
+       for (ty = window->y1 >> OBS2_SHIFT; ty <= (window->y2 >> OBS2_SHIFT);
+		ty++)
+	  mem_advise(ctx->obs2[i] + ((ty * OBS2_TILESX(i) + tx1) <<
+		(2 * OBS2_SHIFT)), ((tx2 - tx1 + 1) << (2 * OBS2_SHIFT)) *
+		sizeof(PROUTE), advice);
+       pgrid_advise(Obs[i], window->x1, window->y1, window->x2, window->y2,
+		advice);
+       pgrid_advise(Nodeidx[i], window->x1, window->y1, window->x2,
+		window->y2, advice);
+       fgrid_advise(Stub[i], window->x1, window->y1, window->x2, window->y2,
+		advice);
+    }
+}
+
+/*--------------------------------------------------------------*/
+/* advise_search_window() ---					*/
+/*								*/
+/* With the grids kept in a scratch directory, tell the kernel	*/
+/* that the grids over "window" are about to be searched by	*/
+/* "ctx", and that those over the window of its last search	*/
+/* are done with, so that pages are read in ahead of the	*/
+/* search and the ones behind it are written out first.		*/
+/*--------------------------------------------------------------*/
+
+void advise_search_window(ROUTECTX ctx, SEG window)
+{
+    if (ScratchDir == NULL) return;
+
+    if (ctx->window.x2 >= 0)
+       advise_window(ctx, &ctx->window, MEM_DONE);
+    ctx->window = *window;
+    advise_window(ctx, window, MEM_NEED);
+}
+
+/*--------------------------------------------------------------*/
+/* init_obs2() ---						*/
+/*								*/
+/* Set up one position of ctx->obs2[][] as a copy of Obs[][]	*/
+/* for the current epoch, converting pin obstructions to	*/
+/* terminal positions for the net being routed.			*/
+/*								*/
+/* Return value:  pointer to the ctx->obs2[][] entry		*/
+/*--------------------------------------------------------------*/
+
+PROUTE *init_obs2(ROUTECTX ctx, int x, int y, int lay)
+{
+    u_int netnum, dir;
+    PROUTE *Pr;
+
+    Pr = &ctx->obs2[lay][O2GRID(x, y, lay)];
+    Pr->epoch = ctx->epoch;
+
+    if (x < ctx->touched.x1) ctx->touched.x1 = x;
+    if (x > ctx->touched.x2) ctx->touched.x2 = x;
+    if (y < ctx->touched.y1) ctx->touched.y1 = y;
+    if (y > ctx->touched.y2) ctx->touched.y2 = y;
+
+    netnum = OBSVAL(x, y, lay) & (~BLOCKED_MASK);
+    if (netnum != 0) {
+       Pr->flags = 0;		// Clear all flags
+       Pr->prdata.net = netnum & NETNUM_MASK;
+       dir = netnum & PINOBSTRUCTMASK;
+       if ((dir != 0) && ((dir & STUBROUTE_X) == STUBROUTE_X)) {
+	  if ((netnum & NETNUM_MASK) == ctx->netnum)
+	     Pr->prdata.net = 0;	// STUBROUTE_X not routable
+       }
+    } else {
+       Pr->flags = PR_COST;		// This location is routable
+       Pr->prdata.cost = MAXRT;
+    }
+    return Pr;
+}
+
 /*--------------------------------------------------------------*/
 /* set_powerbus_to_net()					*/
 /* If we have a power or ground net, go through the entire Obs	*/
-/* array and mark all points matching the net as TARGET in Obs2	*/
+/* array and mark all points matching the net as TARGET in	*/
+/* ctx->obs2							*/
 /*								*/
 /* We do this after the call to PR_SOURCE, before the calls	*/
 /* to set PR_TARGET.						*/
 /*--------------------------------------------------------------*/
 
 void
-set_powerbus_to_net(int netnum)
+set_powerbus_to_net(ROUTECTX ctx, int netnum)
 {
     int x, y, lay;
     PROUTE *Pr;
@@ -42,8 +250,8 @@ set_powerbus_to_net(int netnum)
        for (lay = 0; lay < Num_layers; lay++)
           for (x = 0; x < NumChannelsX[lay]; x++)
 	     for (y = 0; y < NumChannelsY[lay]; y++)
-		if ((Obs[lay][OGRID(x, y, lay)] & NETNUM_MASK) == netnum) {
-		   Pr = &Obs2[lay][OGRID(x, y, lay)];
+		if ((OBSVAL(x, y, lay) & NETNUM_MASK) == netnum) {
+		   Pr = OBS2(ctx, x, y, lay);
 		   // Skip locations that have been purposefully disabled
 		   if (!(Pr->flags & PR_COST) && (Pr->prdata.net == Numnets))
 		      continue;
@@ -58,10 +266,11 @@ set_powerbus_to_net(int netnum)
 /*--------------------------------------------------------------*/
 /* set_node_to_net() ---					*/
 /*								*/
-/* Change the Obs2[][] flag values to "newflags" for all tap	*/
-/* positions of route terminal "node".  Then follow all routes	*/
-/* connected to "node", updating their positions.  Where those	*/
-/* routes connect to other nodes, repeat recursively.		*/
+/* Change the ctx->obs2[][] flag values to "newflags" for all	*/
+/* tap positions of route terminal "node".  Then follow all	*/
+/* routes connected to "node", updating their positions.	*/
+/* Where those routes connect to other nodes, repeat		*/
+/* recursively.							*/
 /*								*/
 /* Return value is 1 if at least one terminal of the node	*/
 /* is already marked as PR_SOURCE, indicating that the node	*/
@@ -90,7 +299,7 @@ set_powerbus_to_net(int netnum)
 /* will be no way to route the net.				*/
 /*--------------------------------------------------------------*/
 
-int set_node_to_net(NODE node, int newflags, POINT *pushlist, SEG bbox, u_char stage)
+int set_node_to_net(ROUTECTX ctx, NODE node, int newflags, POINT *pushlist, SEG bbox, u_char stage)
 {
     int x, y, lay, k, obsnet = 0;
     int result = 0;
@@ -113,7 +322,7 @@ int set_node_to_net(NODE node, int newflags, POINT *pushlist, SEG bbox, u_char s
        lay = ntap->layer;
        x = ntap->gridx;
        y = ntap->gridy;
-       Pr = &Obs2[lay][OGRID(x, y, lay)];
+       Pr = OBS2(ctx, x, y, lay);
        if ((Pr->flags & (newflags | PR_COST)) == PR_COST) {
 	  fprintf(stderr, "Error:  Tap position %d, %d layer %d not "
 			"marked as source!\n", x, y, lay);
@@ -146,7 +355,7 @@ int set_node_to_net(NODE node, int newflags, POINT *pushlist, SEG bbox, u_char s
 	  // push this point on the stack to process
 
 	  if (pushlist != NULL) {
-	     gpoint = (POINT)malloc(sizeof(struct point_));
+	     gpoint = point_alloc(ctx);
 	     gpoint->x1 = x;
 	     gpoint->y1 = y;
 	     gpoint->layer = lay;
@@ -176,16 +385,16 @@ int set_node_to_net(NODE node, int newflags, POINT *pushlist, SEG bbox, u_char s
 
        // Don't process extended areas if they coincide with other nodes.
 
-       // if (Nodeloc[lay][OGRID(x, y, lay)] != (NODE)NULL &&
-       //	Nodeloc[lay][OGRID(x, y, lay)] != node)
+       // if (NODELOC(x, y, lay) != (NODE)NULL &&
+       //	NODELOC(x, y, lay) != node)
        // continue;
 
-       if (Nodeloc[lay][OGRID(x, y, lay)] == (NODE)NULL ||
-       	   Nodeloc[lay][OGRID(x, y, lay)] != node)
+       if (NODELOC(x, y, lay) == (NODE)NULL ||
+       	   NODELOC(x, y, lay) != node)
        continue;
 	
 
-       Pr = &Obs2[lay][OGRID(x, y, lay)];
+       Pr = OBS2(ctx, x, y, lay);
        if (Pr->flags & PR_SOURCE) {
 	  result = 1;				// Node is already connected!
        }
@@ -201,7 +410,7 @@ int set_node_to_net(NODE node, int newflags, POINT *pushlist, SEG bbox, u_char s
 	  // push this point on the stack to process
 
 	  if (pushlist != NULL) {
-	     gpoint = (POINT)malloc(sizeof(struct point_));
+	     gpoint = point_alloc(ctx);
 	     gpoint->x1 = x;
 	     gpoint->y1 = y;
 	     gpoint->layer = lay;
@@ -233,11 +442,11 @@ int set_node_to_net(NODE node, int newflags, POINT *pushlist, SEG bbox, u_char s
 
     if ((result == 0) && (found_one == (u_char)0)) {
        if (stage == (u_char)1)
-          return set_node_to_net(node, newflags, pushlist, bbox, (u_char)2);
+          return set_node_to_net(ctx, node, newflags, pushlist, bbox, (u_char)2);
        else if (stage == (u_char)2)
-          return set_node_to_net(node, newflags, pushlist, bbox, (u_char)3);
+          return set_node_to_net(ctx, node, newflags, pushlist, bbox, (u_char)3);
        else if ((stage == (u_char)0) && (obsnet == 0))
-          return set_node_to_net(node, newflags, pushlist, bbox, (u_char)3);
+          return set_node_to_net(ctx, node, newflags, pushlist, bbox, (u_char)3);
        else
 	  return -2;
     }
@@ -250,7 +459,7 @@ int set_node_to_net(NODE node, int newflags, POINT *pushlist, SEG bbox, u_char s
 /* be routed to. 						*/
 /*--------------------------------------------------------------*/
 
-int disable_node_nets(NODE node)
+int disable_node_nets(ROUTECTX ctx, NODE node)
 {
     int x, y, lay;
     int result = 0;
@@ -263,7 +472,7 @@ int disable_node_nets(NODE node)
        lay = ntap->layer;
        x = ntap->gridx;
        y = ntap->gridy;
-       Pr = &Obs2[lay][OGRID(x, y, lay)];
+       Pr = OBS2(ctx, x, y, lay);
        if (Pr->flags & PR_SOURCE || Pr->flags & PR_TARGET || Pr->flags & PR_COST) {
 	  result = 1;
        }
@@ -279,7 +488,7 @@ int disable_node_nets(NODE node)
        lay = ntap->layer;
        x = ntap->gridx;
        y = ntap->gridy;
-       Pr = &Obs2[lay][OGRID(x, y, lay)];
+       Pr = OBS2(ctx, x, y, lay);
        if (Pr->flags & PR_SOURCE || Pr->flags & PR_TARGET || Pr->flags & PR_COST) {
 	  result = 1;
        }
@@ -295,7 +504,7 @@ int disable_node_nets(NODE node)
 /* source nodes) is routable by definition. . .			*/
 /*--------------------------------------------------------------*/
 
-int set_routes_to_net(NET net, int newflags, POINT *pushlist, SEG bbox, u_char stage)
+int set_routes_to_net(ROUTECTX ctx, NET net, int newflags, POINT *pushlist, SEG bbox, u_char stage)
 {
     int x, y, lay, k;
     int result = 0;
@@ -312,7 +521,7 @@ int set_routes_to_net(NET net, int newflags, POINT *pushlist, SEG bbox, u_char s
 	     x = seg->x1;
 	     y = seg->y1;
 	     while (1) {
-		Pr = &Obs2[lay][OGRID(x, y, lay)];
+		Pr = OBS2(ctx, x, y, lay);
 		Pr->flags |= (newflags == PR_SOURCE) ? newflags : (newflags | PR_COST);
 		// Conflicts should not happen (check for this?)
 		// if (Pr->prdata.net != node->netnum) Pr->flags |= PR_CONFLICT;
@@ -321,7 +530,7 @@ int set_routes_to_net(NET net, int newflags, POINT *pushlist, SEG bbox, u_char s
 		// push this point on the stack to process
 
 		if (pushlist != NULL) {
-	  	   gpoint = (POINT)malloc(sizeof(struct point_));
+	  	   gpoint = point_alloc(ctx);
 	  	   gpoint->x1 = x;
 	  	   gpoint->y1 = y;
 	  	   gpoint->layer = lay;
@@ -340,9 +549,9 @@ int set_routes_to_net(NET net, int newflags, POINT *pushlist, SEG bbox, u_char s
 		// If we found another node connected to the route,
 		// then process it, too.
 
-		n2 = Nodeloc[lay][OGRID(x, y, lay)];
+		n2 = NODELOC(x, y, lay);
 		if ((n2 != (NODE)NULL) && (n2 != net->netnodes)) {
-		   result = set_node_to_net(n2, newflags, pushlist, bbox, stage);
+		   result = set_node_to_net(ctx, n2, newflags, pushlist, bbox, stage);
 		   // On error, continue processing
 		}
 
@@ -366,6 +575,228 @@ int set_routes_to_net(NET net, int newflags, POINT *pushlist, SEG bbox, u_char s
     return result;
 }
 
+/*--------------------------------------------------------------*/
+/* node_is_target() ---						*/
+/*								*/
+/* Return TRUE if any tap position of "node" is marked as	*/
+/* PR_TARGET in the current search, meaning that the node has	*/
+/* not yet been connected.					*/
+/*--------------------------------------------------------------*/
+
+int node_is_target(ROUTECTX ctx, NODE node)
+{
+    DPOINT ntap;
+    PROUTE *Pr;
+
+    for (ntap = node->taps; ntap; ntap = ntap->next) {
+       Pr = &ctx->obs2[ntap->layer][O2GRID(ntap->gridx, ntap->gridy, ntap->layer)];
+       if ((Pr->epoch == ctx->epoch) && (Pr->flags & PR_TARGET))
+	  return TRUE;
+    }
+    for (ntap = node->extend; ntap; ntap = ntap->next) {
+       Pr = &ctx->obs2[ntap->layer][O2GRID(ntap->gridx, ntap->gridy, ntap->layer)];
+       if ((Pr->epoch == ctx->epoch) && (Pr->flags & PR_TARGET))
+	  return TRUE;
+    }
+    return FALSE;
+}
+
+/*--------------------------------------------------------------*/
+/* set_point_to_source() ---					*/
+/*								*/
+/* Make a position of the current search a zero-cost source,	*/
+/* and push it on the list to be (re)expanded.  Positions that	*/
+/* are already sources are left alone.				*/
+/*--------------------------------------------------------------*/
+
+void set_point_to_source(ROUTECTX ctx, int x, int y, int lay, POINT *pushlist)
+{
+    POINT gpoint;
+    PROUTE *Pr;
+
+    Pr = OBS2(ctx, x, y, lay);
+    if (Pr->flags & PR_SOURCE) return;
+
+    Pr->flags &= ~(PR_PRED_DMASK | PR_PROCESSED | PR_TARGET | PR_CONFLICT);
+    Pr->flags |= PR_SOURCE;
+    Pr->prdata.cost = 0;
+
+    gpoint = point_alloc(ctx);
+    gpoint->x1 = x;
+    gpoint->y1 = y;
+    gpoint->layer = lay;
+    gpoint->next = *pushlist;
+    *pushlist = gpoint;
+}
+
+/*--------------------------------------------------------------*/
+/* reset_search_subtree() ---					*/
+/*								*/
+/* A position already reached by the current search has been	*/
+/* blocked by a committed route.  Rebuild it from Obs[][], and	*/
+/* reset every position whose chain of predecessors passes	*/
+/* through it to unreached (cost MAXRT).  Reached positions	*/
+/* bordering the reset area are pushed on "pushlist" to be	*/
+/* expanded again, so that the search can cover the area anew.	*/
+/* Positions on "pushlist" that are themselves reset later	*/
+/* have cost MAXRT and should be skipped by the caller.		*/
+/*--------------------------------------------------------------*/
+
+void reset_search_subtree(ROUTECTX ctx, int x, int y, int lay, POINT *pushlist)
+{
+    static int dx[6] = {1, -1, 0, 0, 0, 0};
+    static int dy[6] = {0, 0, 1, -1, 0, 0};
+    static int dl[6] = {0, 0, 0, 0, 1, -1};
+    static u_char childpred[6] = {PR_PRED_W, PR_PRED_E, PR_PRED_S,
+		PR_PRED_N, PR_PRED_D, PR_PRED_U};
+    int i, nx, ny, nl;
+    POINT stack, gpoint, newpt;
+    PROUTE *Pr;
+
+    init_obs2(ctx, x, y, lay);
+
+    stack = point_alloc(ctx);
+    stack->x1 = x;
+    stack->y1 = y;
+    stack->layer = lay;
+    stack->next = NULL;
+
+    while (stack) {
+       gpoint = stack;
+       stack = stack->next;
+
+       for (i = 0; i < 6; i++) {
+	  nx = gpoint->x1 + dx[i];
+	  ny = gpoint->y1 + dy[i];
+	  nl = gpoint->layer + dl[i];
+	  if ((nl < 0) || (nl >= Num_layers)) continue;
+	  if ((nx < 0) || (nx >= NumChannelsX[nl])) continue;
+	  if ((ny < 0) || (ny >= NumChannelsY[nl])) continue;
+
+	  // Positions not yet touched by this search need no repair
+	  Pr = &ctx->obs2[nl][O2GRID(nx, ny, nl)];
+	  if (Pr->epoch != ctx->epoch) continue;
+
+	  if (!(Pr->flags & PR_SOURCE)) {
+	     if (!(Pr->flags & PR_COST) || (Pr->prdata.cost >= MAXRT))
+		continue;
+
+	     if ((Pr->flags & PR_PRED_DMASK) == childpred[i]) {
+		// Reached through the reset position:  reset it, too
+		Pr->flags &= ~(PR_PRED_DMASK | PR_PROCESSED);
+		Pr->prdata.cost = MAXRT;
+		newpt = point_alloc(ctx);
+		newpt->x1 = nx;
+		newpt->y1 = ny;
+		newpt->layer = nl;
+		newpt->next = stack;
+		stack = newpt;
+		continue;
+	     }
+	  }
+
+	  // Reached some other way:  expand it again
+	  Pr->flags &= ~PR_PROCESSED;
+	  newpt = point_alloc(ctx);
+	  newpt->x1 = nx;
+	  newpt->y1 = ny;
+	  newpt->layer = nl;
+	  newpt->next = *pushlist;
+	  *pushlist = newpt;
+       }
+       point_free(ctx, gpoint);
+    }
+}
+
+/*--------------------------------------------------------------*/
+/* set_route_to_source() ---					*/
+/*								*/
+/* After route "rt" of net "net" has been committed, turn the	*/
+/* current search into one from the enlarged source, so that	*/
+/* the search can be continued toward the remaining targets	*/
+/* instead of being started over.  Every position of the route,	*/
+/* and every tap of a node of the net that the route reaches,	*/
+/* becomes a zero-cost source and is pushed on "pushlist".	*/
+/* On stage 0 the route has also been written to Obs[][], which	*/
+/* may have blocked positions next to it that the search had	*/
+/* already reached.  Those are reset with reset_search_subtree(),	*/
+/* which adds the positions to be expanded again to "pushlist".	*/
+/*--------------------------------------------------------------*/
+
+void set_route_to_source(ROUTECTX ctx, NET net, ROUTE rt, POINT *pushlist, u_char stage)
+{
+    static int dx[4] = {1, -1, 0, 0};
+    static int dy[4] = {0, 0, 1, -1};
+    int x, y, lay, i, nx, ny, pass;
+    SEG seg;
+    NODE n2;
+    DPOINT ntap;
+    PROUTE *Pr;
+    u_int obsnet;
+
+    for (pass = 0; pass < 2; pass++) {
+       if ((pass == 1) && (stage != (u_char)0)) break;
+
+       for (seg = rt->segments; seg; seg = seg->next) {
+	  lay = seg->layer;
+	  x = seg->x1;
+	  y = seg->y1;
+	  while (1) {
+	     if (pass == 0) {
+		set_point_to_source(ctx, x, y, lay, pushlist);
+
+		// A node of this net reached by the route is connected
+		n2 = NODELOC(x, y, lay);
+		if ((n2 != (NODE)NULL) && (n2->netnum == net->netnum)) {
+		   for (ntap = n2->taps; ntap; ntap = ntap->next) {
+		      Pr = OBS2(ctx, ntap->gridx, ntap->gridy, ntap->layer);
+		      if (Pr->flags & PR_TARGET)
+			 set_point_to_source(ctx, ntap->gridx, ntap->gridy,
+				ntap->layer, pushlist);
+		   }
+		   for (ntap = n2->extend; ntap; ntap = ntap->next) {
+		      Pr = OBS2(ctx, ntap->gridx, ntap->gridy, ntap->layer);
+		      if (Pr->flags & PR_TARGET)
+			 set_point_to_source(ctx, ntap->gridx, ntap->gridy,
+				ntap->layer, pushlist);
+		   }
+		}
+	     }
+	     else {
+		// Look for reached positions newly blocked by the route
+		for (i = 0; i < 4; i++) {
+		   nx = x + dx[i];
+		   ny = y + dy[i];
+		   if ((nx < 0) || (nx >= NumChannelsX[lay])) continue;
+		   if ((ny < 0) || (ny >= NumChannelsY[lay])) continue;
+		   Pr = &ctx->obs2[lay][O2GRID(nx, ny, lay)];
+		   if (Pr->epoch != ctx->epoch) continue;
+		   if ((Pr->flags & (PR_COST | PR_SOURCE | PR_TARGET)) != PR_COST)
+		      continue;
+		   obsnet = OBSVAL(nx, ny, lay) & ~BLOCKED_MASK;
+		   if ((obsnet != 0) && ((obsnet & NETNUM_MASK) != net->netnum))
+		      reset_search_subtree(ctx, nx, ny, lay, pushlist);
+		}
+	     }
+
+	     // Process top part of via
+	     if (seg->segtype & ST_VIA) {
+		if (lay != seg->layer) break;
+		lay++;
+		continue;
+	     }
+
+	     // Move to next grid position in segment
+	     if (x == seg->x2 && y == seg->y2) break;
+	     if (seg->x2 > seg->x1) x++;
+	     else if (seg->x2 < seg->x1) x--;
+	     if (seg->y2 > seg->y1) y++;
+	     else if (seg->y2 < seg->y1) y--;
+	  }
+       }
+    }
+}
+
 /*--------------------------------------------------------------*/
 /* Find nets that are colliding with the given net "net", and	*/
 /* create and return a list of them.				*/
@@ -393,7 +824,7 @@ NETLIST find_colliding(NET net)
 	    // are terminals of the net.
 
 	    while (1) {
-	       orignet = Obs[lay][OGRID(x, y, lay)] & ~ROUTED_NET;
+	       orignet = OBSVAL(x, y, lay) & ~ROUTED_NET;
 
 	       if (orignet != net->netnum) {
 
@@ -405,14 +836,12 @@ NETLIST find_colliding(NET net)
 		        break;
 	          }
 	          if (cnl == NULL) {
-		     for (fnet = Nlnets; fnet; fnet = fnet->next) {
-		        if (fnet->netnum == orignet) {
-			   cnl = (NETLIST)malloc(sizeof(struct netlist_));
-		           cnl->net = fnet;
-		           cnl->next = nl;
-		           nl = cnl;
-			   break;
-			}
+		     fnet = DefFindNetNum(orignet);
+		     if (fnet != NULL) {
+			cnl = (NETLIST)malloc(sizeof(struct netlist_));
+			cnl->net = fnet;
+			cnl->next = nl;
+			nl = cnl;
 		     }
 		  }
 	       }
@@ -479,7 +908,7 @@ u_char ripup_net(NET net, u_char restore)
 	    x = seg->x1;
 	    y = seg->y1;
 	    while (1) {
-	       oldnet = Obs[lay][OGRID(x, y, lay)] & NETNUM_MASK;
+	       oldnet = OBSVAL(x, y, lay) & NETNUM_MASK;
 	       if ((oldnet > 0) && (oldnet < Numnets)) {
 	          if (oldnet != thisnet) {
 		     fprintf(stderr, "Error: position %d %d layer %d has net "
@@ -492,12 +921,12 @@ u_char ripup_net(NET net, u_char restore)
 		  // were routed over obstructions to reach off-grid
 		  // taps are returned to obstructions.
 
-	          if (Nodesav[lay][OGRID(x, y, lay)] == (NODE)NULL) {
-		     dir = Obs[lay][OGRID(x, y, lay)] & PINOBSTRUCTMASK;
+	          if (NODESAV(x, y, lay) == (NODE)NULL) {
+		     dir = OBSVAL(x, y, lay) & PINOBSTRUCTMASK;
 		     if (dir == 0)
-		        Obs[lay][OGRID(x, y, lay)] = 0;
+		        *OBSPTR(x, y, lay) = 0;
 		     else
-		        Obs[lay][OGRID(x, y, lay)] = NO_NET | dir;
+		        *OBSPTR(x, y, lay) = NO_NET | dir;
 		  }
 
 		  // Routes which had blockages added on the sides due
@@ -505,22 +934,22 @@ u_char ripup_net(NET net, u_char restore)
 		  // set;  these flags should be removed.
 
 		  if (needcheckX[lay]) {
-		     if ((x > 0) && ((Obs[lay][OGRID(x - 1, y, lay)] &
+		     if ((x > 0) && ((OBSVAL(x - 1, y, lay) &
 				(NO_NET | ROUTED_NET)) == (NO_NET | ROUTED_NET)))
-			Obs[lay][OGRID(x - 1, y, lay)] &= ~(NO_NET | ROUTED_NET);
+			*OBSPTR(x - 1, y, lay) &= ~(NO_NET | ROUTED_NET);
 		     else if ((x < NumChannelsX[lay] - 1) &&
-				((Obs[lay][OGRID(x + 1, y, lay)] &
+				((OBSVAL(x + 1, y, lay) &
 				(NO_NET | ROUTED_NET)) == (NO_NET | ROUTED_NET)))
-			Obs[lay][OGRID(x + 1, y, lay)] &= ~(NO_NET | ROUTED_NET);
+			*OBSPTR(x + 1, y, lay) &= ~(NO_NET | ROUTED_NET);
 		  }
 		  if (needcheckY[lay]) {
-		     if ((y > 0) && ((Obs[lay][OGRID(x, y - 1, lay)] &
+		     if ((y > 0) && ((OBSVAL(x, y - 1, lay) &
 				(NO_NET | ROUTED_NET)) == (NO_NET | ROUTED_NET)))
-			Obs[lay][OGRID(x, y - 1, lay)] &= ~(NO_NET | ROUTED_NET);
+			*OBSPTR(x, y - 1, lay) &= ~(NO_NET | ROUTED_NET);
 		     else if ((y < NumChannelsY[lay] - 1) &&
-				((Obs[lay][OGRID(x, y + 1, lay)] &
+				((OBSVAL(x, y + 1, lay) &
 				(NO_NET | ROUTED_NET)) == (NO_NET | ROUTED_NET)))
-			Obs[lay][OGRID(x, y + 1, lay)] &= ~(NO_NET | ROUTED_NET);
+			*OBSPTR(x, y + 1, lay) &= ~(NO_NET | ROUTED_NET);
 		  }
 	       }
 
@@ -548,23 +977,15 @@ u_char ripup_net(NET net, u_char restore)
 	    lay = ntap->layer;
 	    x = ntap->gridx;
 	    y = ntap->gridy;
-	    Nodeloc[lay][OGRID(x, y, lay)] = Nodesav[lay][OGRID(x, y, lay)];
+	    RESTORE_NODELOC(x, y, lay);
 	 }
       }
    }
 
    /* Remove all routing information from this net */
 
-   while (net->routes) {
-      rt = net->routes;
-      net->routes = rt->next;
-      while (rt->segments) {
-	 seg = rt->segments->next;
-	 free(rt->segments);
-	 rt->segments = seg;
-      }
-      free(rt);
-   }
+   net->routes = (ROUTE)NULL;
+   if (net->arena) arena_release(net->arena, NULL);
 
    return TRUE;
 }
@@ -590,7 +1011,7 @@ u_char ripup_net(NET net, u_char restore)
 /*  SIDE EFFECTS: none (get this right or else)			*/
 /*--------------------------------------------------------------*/
 
-int eval_pt(GRIDP *ept, u_char flags, u_char stage)
+int eval_pt(ROUTECTX ctx, GRIDP *ept, u_char flags, u_char stage)
 {
     int thiscost = 0;
     NODE node;
@@ -621,17 +1042,17 @@ int eval_pt(GRIDP *ept, u_char flags, u_char stage)
 	  break;
     }
 
-    Pr = &Obs2[newpt.lay][OGRID(newpt.x, newpt.y, newpt.lay)];
+    Pr = OBS2(ctx, newpt.x, newpt.y, newpt.lay);
 
     if (!(Pr->flags & (PR_COST | PR_SOURCE))) {
        // 2nd stage allows routes to cross existing routes
        if (stage && (Pr->prdata.net < Numnets)) {
-	  if (Nodesav[newpt.lay][OGRID(newpt.x, newpt.y, newpt.lay)] != NULL)
+	  if (NODESAV(newpt.x, newpt.y, newpt.lay) != NULL)
 	     return 0;			// But cannot route over terminals!
 
 	  // Is net k in the "noripup" list?  If so, don't route it */
 
-	  for (nl = CurNet->noripup; nl; nl = nl->next) {
+	  for (nl = ctx->curnet->noripup; nl; nl = nl->next) {
 	     if (nl->net->netnum == Pr->prdata.net)
 		return 0;
 	  }
@@ -654,9 +1075,8 @@ int eval_pt(GRIDP *ept, u_char flags, u_char stage)
     // so that routing over it could block it entirely.
 
     if (newpt.lay > 0) {
-	if ((node = Nodeloc[newpt.lay - 1][OGRID(newpt.x, newpt.y, newpt.lay - 1)])
-			!= (NODE)NULL) {
-	    Pt = &Obs2[newpt.lay - 1][OGRID(newpt.x, newpt.y, newpt.lay - 1)];
+	if ((node = NODELOC(newpt.x, newpt.y, newpt.lay - 1)) != (NODE)NULL) {
+	    Pt = OBS2(ctx, newpt.x, newpt.y, newpt.lay - 1);
 	    if (!(Pt->flags & PR_TARGET) && !(Pt->flags & PR_SOURCE)) {
 		if (node->taps && (node->taps->next == NULL))
 		   thiscost += BlockCost;	// Cost to block out a tap
@@ -666,9 +1086,8 @@ int eval_pt(GRIDP *ept, u_char flags, u_char stage)
 	}
     }
     if (newpt.lay < Num_layers - 1) {
-	if ((node = Nodeloc[newpt.lay + 1][OGRID(newpt.x, newpt.y, newpt.lay + 1)])
-			!= (NODE)NULL) {
-	    Pt = &Obs2[newpt.lay + 1][OGRID(newpt.x, newpt.y, newpt.lay + 1)];
+	if ((node = NODELOC(newpt.x, newpt.y, newpt.lay + 1)) != (NODE)NULL) {
+	    Pt = OBS2(ctx, newpt.x, newpt.y, newpt.lay + 1);
 	    if (!(Pt->flags & PR_TARGET) && !(Pt->flags & PR_SOURCE)) {
 		if (node->taps && (node->taps->next == NULL))
 		   thiscost += BlockCost;	// Cost to block out a tap
@@ -691,14 +1110,21 @@ int eval_pt(GRIDP *ept, u_char flags, u_char stage)
     if (Pr->flags & PR_CONFLICT)
        thiscost += ConflictCost;	// For 2nd stage routes
 
+    if (CongestionCost > 0)		// Estimated before routing
+       thiscost += CONGESTION_COST(newpt.x, newpt.y, newpt.lay);
+
+    if (Occupancy[0] != NULL)		// While negotiating
+       thiscost += NEGOTIATED_COST(newpt.x, newpt.y, newpt.lay);
+
     if (thiscost < Pr->prdata.cost) {
        Pr->flags &= ~PR_PRED_DMASK;
        Pr->flags |= flags;
        Pr->prdata.cost = thiscost;
+       if (Pr->flags & PR_PROCESSED) ctx->reexpansions++;
        Pr->flags &= ~PR_PROCESSED;	// Need to reprocess this node
 
        if (Verbose > 0) {
-	  fprintf(stdout, "New cost %d at (%d %d %d)\n", thiscost,
+	  fprintf(ctx->log, "New cost %d at (%d %d %d)\n", thiscost,
 		newpt.x, newpt.y, newpt.lay);
        }
        return 1;
@@ -719,61 +1145,61 @@ void writeback_segment(SEG seg, int netnum)
    int  i;
 
    if (seg->segtype == ST_VIA) {
-      Obs[seg->layer + 1][OGRID(seg->x1, seg->y1, seg->layer + 1)] = netnum;
+      *OBSPTR(seg->x1, seg->y1, seg->layer + 1) = netnum;
       if (needblockX[seg->layer + 1]) {
 	 if ((seg->x1 < (NumChannelsX[seg->layer + 1] - 1)) &&
-		(Obs[seg->layer + 1][OGRID(seg->x1 + 1, seg->y1, seg->layer + 1)]
+		(OBSVAL(seg->x1 + 1, seg->y1, seg->layer + 1)
 		& NETNUM_MASK) == 0)
- 	    Obs[seg->layer + 1][OGRID(seg->x1 + 1, seg->y1, seg->layer + 1)] =
+ 	    *OBSPTR(seg->x1 + 1, seg->y1, seg->layer + 1) =
 			(NO_NET | ROUTED_NET);
 	 if ((seg->x1 > 0) &&
-		(Obs[seg->layer + 1][OGRID(seg->x1 - 1, seg->y1, seg->layer + 1)]
+		(OBSVAL(seg->x1 - 1, seg->y1, seg->layer + 1)
 		& NETNUM_MASK) == 0)
-	    Obs[seg->layer + 1][OGRID(seg->x1 - 1, seg->y1, seg->layer + 1)] =
+	    *OBSPTR(seg->x1 - 1, seg->y1, seg->layer + 1) =
 			(NO_NET | ROUTED_NET);
       }
       if (needblockY[seg->layer + 1]) {
 	 if ((seg->y1 < (NumChannelsY[seg->layer + 1] - 1)) &&
-		(Obs[seg->layer + 1][OGRID(seg->x1, seg->y1 + 1, seg->layer + 1)]
+		(OBSVAL(seg->x1, seg->y1 + 1, seg->layer + 1)
 		& NETNUM_MASK) == 0)
-	    Obs[seg->layer + 1][OGRID(seg->x1, seg->y1 + 1, seg->layer + 1)] =
+	    *OBSPTR(seg->x1, seg->y1 + 1, seg->layer + 1) =
 			(NO_NET | ROUTED_NET);
 	 if ((seg->y1 > 0) &&
-		(Obs[seg->layer + 1][OGRID(seg->x1, seg->y1 - 1, seg->layer + 1)]
+		(OBSVAL(seg->x1, seg->y1 - 1, seg->layer + 1)
 		& NETNUM_MASK) == 0)
-	    Obs[seg->layer + 1][OGRID(seg->x1, seg->y1 - 1, seg->layer + 1)] =
+	    *OBSPTR(seg->x1, seg->y1 - 1, seg->layer + 1) =
 			(NO_NET | ROUTED_NET);
       }
    }
 
    for (i = seg->x1; ; i += (seg->x2 > seg->x1) ? 1 : -1) {
-      Obs[seg->layer][OGRID(i, seg->y1, seg->layer)] = netnum;
+      *OBSPTR(i, seg->y1, seg->layer) = netnum;
       if (needblockY[seg->layer]) {
          if ((seg->y1 < (NumChannelsY[seg->layer] - 1)) &&
-		(Obs[seg->layer][OGRID(i, seg->y1 + 1, seg->layer)]
+		(OBSVAL(i, seg->y1 + 1, seg->layer)
 		& NETNUM_MASK) == 0)
-	    Obs[seg->layer][OGRID(i, seg->y1 + 1, seg->layer)] =
+	    *OBSPTR(i, seg->y1 + 1, seg->layer) =
 			(NO_NET | ROUTED_NET);
 	 if ((seg->y1 > 0) &&
-		(Obs[seg->layer][OGRID(i, seg->y1 - 1, seg->layer)]
+		(OBSVAL(i, seg->y1 - 1, seg->layer)
 		& NETNUM_MASK) == 0)
-	    Obs[seg->layer][OGRID(i, seg->y1 - 1, seg->layer)] =
+	    *OBSPTR(i, seg->y1 - 1, seg->layer) =
 			(NO_NET | ROUTED_NET);
       }
       if (i == seg->x2) break;
    }
    for (i = seg->y1; ; i += (seg->y2 > seg->y1) ? 1 : -1) {
-      Obs[seg->layer][OGRID(seg->x1, i, seg->layer)] = netnum;
+      *OBSPTR(seg->x1, i, seg->layer) = netnum;
       if (needblockX[seg->layer]) {
 	 if ((seg->x1 < (NumChannelsX[seg->layer] - 1)) &&
-		(Obs[seg->layer][OGRID(seg->x1 + 1, i, seg->layer)]
+		(OBSVAL(seg->x1 + 1, i, seg->layer)
 		& NETNUM_MASK) == 0)
-	    Obs[seg->layer][OGRID(seg->x1 + 1, i, seg->layer)] =
+	    *OBSPTR(seg->x1 + 1, i, seg->layer) =
 			(NO_NET | ROUTED_NET);
 	 if ((seg->x1 > 0) &&
-		(Obs[seg->layer][OGRID(seg->x1 - 1, i, seg->layer)]
+		(OBSVAL(seg->x1 - 1, i, seg->layer)
 		& NETNUM_MASK) == 0)
-	    Obs[seg->layer][OGRID(seg->x1 - 1, i, seg->layer)] =
+	    *OBSPTR(seg->x1 - 1, i, seg->layer) =
 			(NO_NET | ROUTED_NET);
       }
       if (i == seg->y2) break;
@@ -795,7 +1221,7 @@ void writeback_segment(SEG seg, int netnum)
 /*  SIDE EFFECTS: Obs update, RT llseg added			*/
 /*--------------------------------------------------------------*/
 
-int commit_proute(ROUTE rt, GRIDP *ept, u_char stage)
+int commit_proute(ROUTECTX ctx, NET net, ROUTE rt, GRIDP *ept, u_char stage)
 {
    SEG  seg, lseg;
    int  i, j, k, lay, lay2, rval;
@@ -809,12 +1235,12 @@ int commit_proute(ROUTE rt, GRIDP *ept, u_char stage)
    POINT newlr, newlr2, lrtop, lrend, lrnext, lrcur, lrprev;
    double sreq;
 
-   fflush(stdout);
+   fflush(ctx->log);
    fprintf(stderr, "\nCommit: TotalRoutes = %d\n", TotalRoutes);
 
    netnum = rt->netnum;
 
-   Pr = &Obs2[ept->lay][OGRID(ept->x, ept->y, ept->lay)];
+   Pr = OBS2(ctx, ept->x, ept->y, ept->lay);
    if (!(Pr->flags & PR_COST)) {
       fprintf(stderr, "commit_proute(): impossible - terminal is not routable!\n");
       return -1;
@@ -823,7 +1249,7 @@ int commit_proute(ROUTE rt, GRIDP *ept, u_char stage)
    // Generate an indexed route, recording the series of predecessors and their
    // positions.
 
-   lrtop = (POINT)malloc(sizeof(struct point_));
+   lrtop = point_alloc(ctx);
    lrtop->x1 = ept->x;
    lrtop->y1 = ept->y;
    lrtop->layer = ept->lay;
@@ -832,11 +1258,11 @@ int commit_proute(ROUTE rt, GRIDP *ept, u_char stage)
 
    while (1) {
 
-      Pr = &Obs2[lrend->layer][OGRID(lrend->x1, lrend->y1, lrend->layer)];
+      Pr = OBS2(ctx, lrend->x1, lrend->y1, lrend->layer);
       dmask = Pr->flags & PR_PRED_DMASK;
       if (dmask == PR_PRED_NONE) break;
 
-      newlr = (POINT)malloc(sizeof(struct point_));
+      newlr = point_alloc(ctx);
       newlr->x1 = lrend->x1;
       newlr->y1 = lrend->y1;
       newlr->layer = lrend->layer;
@@ -911,7 +1337,7 @@ int commit_proute(ROUTE rt, GRIDP *ept, u_char stage)
 	       // lowest cost, and make sure the position below that
 	       // is available.
 	       dx = cx + 1;	// Check to the right
-	       pri = &Obs2[cl][OGRID(dx, cy, cl)];
+	       pri = OBS2(ctx, dx, cy, cl);
 	       pflags = pri->flags;
 	       cost = pri->prdata.cost;
 	       if (collide && !(pflags & (PR_COST | PR_SOURCE)) &&
@@ -922,7 +1348,7 @@ int commit_proute(ROUTE rt, GRIDP *ept, u_char stage)
 	       if (pflags & PR_COST) {
 		  pflags &= ~PR_COST;
 		  if ((pflags & PR_PRED_DMASK) != PR_PRED_NONE && cost < mincost) {
-	             pri2 = &Obs2[dl][OGRID(dx, cy, dl)];
+	             pri2 = OBS2(ctx, dx, cy, dl);
 		     p2flags = pri2->flags;
 		     if (p2flags & PR_COST) {
 			p2flags &= ~PR_COST;
@@ -943,7 +1369,7 @@ int commit_proute(ROUTE rt, GRIDP *ept, u_char stage)
 		  }
 	       }
 	       dx = cx - 1;	// Check to the left
-	       pri = &Obs2[cl][OGRID(dx, cy, cl)];
+	       pri = OBS2(ctx, dx, cy, cl);
 	       pflags = pri->flags;
 	       cost = pri->prdata.cost;
 	       if (collide && !(pflags & (PR_COST | PR_SOURCE)) &&
@@ -954,7 +1380,7 @@ int commit_proute(ROUTE rt, GRIDP *ept, u_char stage)
 	       if (pflags & PR_COST) {
 		  pflags &= ~PR_COST;
 		  if ((pflags & PR_PRED_DMASK) != PR_PRED_NONE && cost < mincost) {
-	             pri2 = &Obs2[dl][OGRID(dx, cy, dl)];
+	             pri2 = OBS2(ctx, dx, cy, dl);
 		     p2flags = pri2->flags;
 		     if (p2flags & PR_COST) {
 			p2flags &= ~PR_COST;
@@ -976,7 +1402,7 @@ int commit_proute(ROUTE rt, GRIDP *ept, u_char stage)
 	       }
 
 	       dy = cy + 1;	// Check north
-	       pri = &Obs2[cl][OGRID(cx, dy, cl)];
+	       pri = OBS2(ctx, cx, dy, cl);
 	       pflags = pri->flags;
 	       cost = pri->prdata.cost;
 	       if (collide && !(pflags & (PR_COST | PR_SOURCE)) &&
@@ -987,7 +1413,7 @@ int commit_proute(ROUTE rt, GRIDP *ept, u_char stage)
 	       if (pflags & PR_COST) {
 		  pflags &= ~PR_COST;
 		  if ((pflags & PR_PRED_DMASK) != PR_PRED_NONE && cost < mincost) {
-	             pri2 = &Obs2[dl][OGRID(cx, dy, dl)];
+	             pri2 = OBS2(ctx, cx, dy, dl);
 		     p2flags = pri2->flags;
 		     if (p2flags & PR_COST) {
 			p2flags &= ~PR_COST;
@@ -1009,7 +1435,7 @@ int commit_proute(ROUTE rt, GRIDP *ept, u_char stage)
 	       }
 
 	       dy = cy - 1;	// Check south
-	       pri = &Obs2[cl][OGRID(cx, dy, cl)];
+	       pri = OBS2(ctx, cx, dy, cl);
 	       pflags = pri->flags;
 	       cost = pri->prdata.cost;
 	       if (collide && !(pflags & (PR_COST | PR_SOURCE)) &&
@@ -1020,7 +1446,7 @@ int commit_proute(ROUTE rt, GRIDP *ept, u_char stage)
 	       if (pflags & PR_COST) {
 		  pflags &= ~PR_COST;
 		  if (pflags & PR_PRED_DMASK != PR_PRED_NONE && cost < mincost) {
-	             pri2 = &Obs2[dl][OGRID(cx, dy, dl)];
+	             pri2 = OBS2(ctx, cx, dy, dl);
 		     p2flags = pri2->flags;
 		     if (p2flags & PR_COST) {
 		        p2flags &= ~PR_COST;
@@ -1046,16 +1472,16 @@ int commit_proute(ROUTE rt, GRIDP *ept, u_char stage)
 	       // then try to move the first contact instead.
 
 	       if (mincost < MAXRT) {
-	          pri = &Obs2[cl][OGRID(minx, miny, cl)];
+	          pri = OBS2(ctx, minx, miny, cl);
 
-		  newlr = (POINT)malloc(sizeof(struct point_));
+		  newlr = point_alloc(ctx);
 		  newlr->x1 = minx;
 		  newlr->y1 = miny;
 		  newlr->layer = cl;
 
-	          pri2 = &Obs2[dl][OGRID(minx, miny, dl)];
+	          pri2 = OBS2(ctx, minx, miny, dl);
 
-		  newlr2 = (POINT)malloc(sizeof(struct point_));
+		  newlr2 = point_alloc(ctx);
 		  newlr2->x1 = minx;
 		  newlr2->y1 = miny;
 		  newlr2->layer = dl;
@@ -1070,8 +1496,8 @@ int commit_proute(ROUTE rt, GRIDP *ept, u_char stage)
 		     if (lrnext->x1 == minx && lrnext->y1 == miny &&
 				lrnext->layer == dl) {
 			newlr->next = lrnext;
-			free(lrppre);
-			free(newlr2);
+			point_free(ctx, lrppre);
+			point_free(ctx, newlr2);
 			lrppre = lrnext;	// ?
 		     }
 		     else
@@ -1094,13 +1520,13 @@ int commit_proute(ROUTE rt, GRIDP *ept, u_char stage)
 	          dl = lrprev->layer;
 
 	          dx = cx + 1;	// Check to the right
-	          pri = &Obs2[cl][OGRID(dx, cy, cl)];
+	          pri = OBS2(ctx, dx, cy, cl);
 	          pflags = pri->flags;
 		  if (pflags & PR_COST) {
 		     pflags &= ~PR_COST;
 		     if ((pflags & PR_PRED_DMASK) != PR_PRED_NONE &&
 				pri->prdata.cost < mincost) {
-	                pri2 = &Obs2[dl][OGRID(dx, cy, dl)];
+	                pri2 = OBS2(ctx, dx, cy, dl);
 		        p2flags = pri2->flags;
 			if (p2flags & PR_COST) {
 			   p2flags &= ~PR_COST;
@@ -1115,13 +1541,13 @@ int commit_proute(ROUTE rt, GRIDP *ept, u_char stage)
 	          }
 
 	          dx = cx - 1;	// Check to the left
-	          pri = &Obs2[cl][OGRID(dx, cy, cl)];
+	          pri = OBS2(ctx, dx, cy, cl);
 	          pflags = pri->flags;
 		  if (pflags & PR_COST) {
 		     pflags &= ~PR_COST;
 		     if ((pflags & PR_PRED_DMASK) != PR_PRED_NONE &&
 				pri->prdata.cost < mincost) {
-	                pri2 = &Obs2[dl][OGRID(dx, cy, dl)];
+	                pri2 = OBS2(ctx, dx, cy, dl);
 		        p2flags = pri2->flags;
 			if (p2flags & PR_COST) {
 			   p2flags &= ~PR_COST;
@@ -1136,13 +1562,13 @@ int commit_proute(ROUTE rt, GRIDP *ept, u_char stage)
 	          }
 
 	          dy = cy + 1;	// Check north
-	          pri = &Obs2[cl][OGRID(cx, dy, cl)];
+	          pri = OBS2(ctx, cx, dy, cl);
 	          pflags = pri->flags;
 		  if (pflags & PR_COST) {
 		     pflags &= ~PR_COST;
 		     if ((pflags & PR_PRED_DMASK) != PR_PRED_NONE &&
 				pri->prdata.cost < mincost) {
-	                pri2 = &Obs2[dl][OGRID(cx, dy, dl)];
+	                pri2 = OBS2(ctx, cx, dy, dl);
 		        p2flags = pri2->flags;
 			if (p2flags & PR_COST) {
 			   p2flags &= ~PR_COST;
@@ -1157,13 +1583,13 @@ int commit_proute(ROUTE rt, GRIDP *ept, u_char stage)
 	          }
 
 	          dy = cy - 1;	// Check south
-	          pri = &Obs2[cl][OGRID(cx, dy, cl)];
+	          pri = OBS2(ctx, cx, dy, cl);
 	          pflags = pri->flags;
 		  if (pflags & PR_COST) {
 		     pflags &= ~PR_COST;
 		     if ((pflags & PR_PRED_DMASK) != PR_PRED_NONE &&
 				pri->prdata.cost < mincost) {
-	                pri2 = &Obs2[dl][OGRID(cx, dy, dl)];
+	                pri2 = OBS2(ctx, cx, dy, dl);
 		        p2flags = pri2->flags;
 			if (p2flags & PR_COST) {
 			   p2flags &= ~PR_COST;
@@ -1178,12 +1604,12 @@ int commit_proute(ROUTE rt, GRIDP *ept, u_char stage)
 	          }
 
 		  if (mincost < MAXRT) {
-		     newlr = (POINT)malloc(sizeof(struct point_));
+		     newlr = point_alloc(ctx);
 		     newlr->x1 = minx;
 		     newlr->y1 = miny;
 		     newlr->layer = cl;
 
-		     newlr2 = (POINT)malloc(sizeof(struct point_));
+		     newlr2 = point_alloc(ctx);
 		     newlr2->x1 = minx;
 		     newlr2->y1 = miny;
 		     newlr2->layer = dl;
@@ -1193,15 +1619,14 @@ int commit_proute(ROUTE rt, GRIDP *ept, u_char stage)
 		     // endpoint along the source or target, and the
 		     // original endpoint position is not needed.
 
-	             pri = &Obs2[cl][OGRID(minx, miny, cl)];
-	             pri2 = &Obs2[lrcur->layer][OGRID(lrcur->x1,
-					lrcur->y1, lrcur->layer)];
+	             pri = OBS2(ctx, minx, miny, cl);
+	             pri2 = OBS2(ctx, lrcur->x1, lrcur->y1, lrcur->layer);
 		     if (((pri->flags & PR_SOURCE) && (pri2->flags & PR_SOURCE)) ||
 			 	((pri->flags & PR_TARGET) &&
 				(pri2->flags & PR_TARGET)) && (lrcur == lrtop)) {
 			lrtop = newlr;
 			lrend = newlr;
-			free(lrcur);
+			point_free(ctx, lrcur);
 			lrcur = newlr;
 		     }
 		     else
@@ -1215,8 +1640,8 @@ int commit_proute(ROUTE rt, GRIDP *ept, u_char stage)
 		     if (lrppre->x1 == minx && lrppre->y1 == miny &&
 				lrppre->layer == dl) {
 			newlr->next = lrppre;
-			free(lrprev);
-			free(newlr2);
+			point_free(ctx, lrprev);
+			point_free(ctx, newlr2);
 			lrprev = lrcur;
 		     }
 		     else
@@ -1230,7 +1655,7 @@ int commit_proute(ROUTE rt, GRIDP *ept, u_char stage)
 		     // but it works because failing to remove a stacked
 		     // via is a rare occurrance.
 
-		     printf("Failed to remove stacked via at grid point "
+		     fprintf(ctx->log, "Failed to remove stacked via at grid point "
 				"%d %d.\n", lrcur->x1, lrcur->y1);
 		     stacks = 0;
 		     rval = 0;
@@ -1238,7 +1663,7 @@ int commit_proute(ROUTE rt, GRIDP *ept, u_char stage)
 		  }
 		  else {
 		     if (collide == TRUE) {
-		        printf("Failed to remove stacked via at grid point "
+		        fprintf(ctx->log, "Failed to remove stacked via at grid point "
 				"%d %d;  position may not be routable.\n",
 				lrcur->x1, lrcur->y1);
 			stacks = 0;
@@ -1267,7 +1692,7 @@ int commit_proute(ROUTE rt, GRIDP *ept, u_char stage)
    lseg = (SEG)NULL;
 
    while (1) {
-      seg = (SEG)malloc(sizeof(struct seg_));
+      seg = (SEG)arena_alloc(net_arena(net), sizeof(struct seg_));
       seg->next = NULL;
 
       seg->segtype = (lrcur->layer == lrprev->layer) ? ST_WIRE : ST_VIA;
@@ -1311,25 +1736,25 @@ int commit_proute(ROUTE rt, GRIDP *ept, u_char stage)
       }
 
       if (Verbose > 0) {
-         printf( "commit: index = %d, net = %d\n",
+         fprintf(ctx->log, "commit: index = %d, net = %d\n",
 		Pr->prdata.net, netnum);
 
 	 if (seg->segtype == ST_WIRE) {
-            printf( "commit: wire layer %d, (%d,%d) to (%d,%d)\n",
+            fprintf(ctx->log, "commit: wire layer %d, (%d,%d) to (%d,%d)\n",
 		seg->layer, seg->x1, seg->y1, seg->x2, seg->y2);
 	 }
 	 else {
-            printf( "commit: via %d to %d\n", seg->layer, seg->layer + 1);
+            fprintf(ctx->log, "commit: via %d to %d\n", seg->layer, seg->layer + 1);
 	 }
-	 fflush(stdout);
+	 fflush(ctx->log);
       }
 
       // now fill in the Obs structure with this route....
 
       lay2 = (seg->segtype & ST_VIA) ? seg->layer + 1 : seg->layer;
 
-      netobs1 = Obs[seg->layer][OGRID(seg->x1, seg->y1, seg->layer)];
-      netobs2 = Obs[lay2][OGRID(seg->x2, seg->y2, lay2)];
+      netobs1 = OBSVAL(seg->x1, seg->y1, seg->layer);
+      netobs2 = OBSVAL(seg->x2, seg->y2, lay2);
 
       dir1 = netobs1 & PINOBSTRUCTMASK;
       dir2 = netobs2 & PINOBSTRUCTMASK;
@@ -1348,14 +1773,14 @@ int commit_proute(ROUTE rt, GRIDP *ept, u_char stage)
 
          if (first && dir1) {
 	    first = (u_char)0;
-	    Obs[seg->layer][OGRID(seg->x1, seg->y1, seg->layer)] |= dir1;
+	    *OBSPTR(seg->x1, seg->y1, seg->layer) |= dir1;
          }
 	 else if (first && dir2 && (seg->segtype & ST_VIA) && lrprev &&
 			(lrprev->layer != lay2)) {
 	    // This also applies to vias at the beginning of a route
 	    // if the path goes down instead of up (can happen on pins,
 	    // in particular)
-	    Obs[lay2][OGRID(seg->x1, seg->y1, lay2)] |= dir2;
+	    *OBSPTR(seg->x1, seg->y1, lay2) |= dir2;
 	 }
       }
 
@@ -1363,9 +1788,9 @@ int commit_proute(ROUTE rt, GRIDP *ept, u_char stage)
       // over, so that in the rip-up stage, we can return them to obstructions.
 
       if (netobs1 > Numnets)
-	  Obs[seg->layer][OGRID(seg->x1, seg->y1, seg->layer)] |= dir1;
+	  *OBSPTR(seg->x1, seg->y1, seg->layer) |= dir1;
       if (netobs2 > Numnets)
-	  Obs[lay2][OGRID(seg->x2, seg->y2, lay2)] |= dir2;
+	  *OBSPTR(seg->x2, seg->y2, lay2) |= dir2;
 
       // An offset route end on the previous segment, if it is a via, needs
       // to carry over to this one, if it is a wire route.
@@ -1404,11 +1829,11 @@ int commit_proute(ROUTE rt, GRIDP *ept, u_char stage)
       if (lrprev == NULL) {
 
          if (dir2 && (stage == (u_char)0)) {
-	    Obs[lay2][OGRID(seg->x2, seg->y2, lay2)] |= dir2;
+	    *OBSPTR(seg->x2, seg->y2, lay2) |= dir2;
          }
 	 else if (dir1 && (seg->segtype & ST_VIA)) {
 	    // This also applies to vias at the end of a route
-	    Obs[seg->layer][OGRID(seg->x1, seg->y1, seg->layer)] |= dir1;
+	    *OBSPTR(seg->x1, seg->y1, seg->layer) |= dir1;
 	 }
 
 	 // Before returning, set *ept to the endpoint
@@ -1420,7 +1845,7 @@ int commit_proute(ROUTE rt, GRIDP *ept, u_char stage)
 	 // Clean up allocated memory for the route. . .
 	 while (lrtop != NULL) {
 	    lrnext = lrtop->next;
-	    free(lrtop);
+	    point_free(ctx, lrtop);
 	    lrtop = lrnext;
 	 }
 	 return rval;	// Success
@@ -1432,7 +1857,7 @@ cleanup:
 
    while (lrtop != NULL) {
       lrnext = lrtop->next;
-      free(lrtop);
+      point_free(ctx, lrtop);
       lrtop = lrnext;
    }
    return 0;
@@ -1466,18 +1891,18 @@ int writeback_route(ROUTE rt)
 
       lay2 = (seg->segtype & ST_VIA) ? seg->layer + 1 : seg->layer;
 
-      dir1 = Obs[seg->layer][OGRID(seg->x1, seg->y1, seg->layer)] & PINOBSTRUCTMASK;
-      dir2 = Obs[lay2][OGRID(seg->x2, seg->y2, lay2)] & PINOBSTRUCTMASK;
+      dir1 = OBSVAL(seg->x1, seg->y1, seg->layer) & PINOBSTRUCTMASK;
+      dir2 = OBSVAL(seg->x2, seg->y2, lay2) & PINOBSTRUCTMASK;
 
       writeback_segment(seg, netnum);
 
       if (first && dir1) {
 	 first = (u_char)0;
-	 Obs[seg->layer][OGRID(seg->x1, seg->y1, seg->layer)] |= dir1;
+	 *OBSPTR(seg->x1, seg->y1, seg->layer) |= dir1;
       }
 
       if (!seg->next && dir2) {
-	 Obs[lay2][OGRID(seg->x2, seg->y2, lay2)] |= dir2;
+	 *OBSPTR(seg->x2, seg->y2, lay2) |= dir2;
       }
    }
    return TRUE;
@@ -7,13 +7,24 @@
 
 #ifndef MAZE_H
 
-void	set_powerbus_to_net(int netnum);
-int     set_node_to_net(NODE node, int newnet, POINT *pushlist, SEG bbox, u_char stage);
-int	disable_node_nets(NODE node);
-int     set_routes_to_net(NET net, int newnet, POINT *pushlist, SEG bbox, u_char stage);
+ROUTECTX new_route_context();
+void	free_route_context(ROUTECTX ctx);
+void	new_obs2_epoch(ROUTECTX ctx, int netnum);
+void	reset_touched(ROUTECTX ctx);
+void	advise_search_window(ROUTECTX ctx, SEG window);
+PROUTE	*init_obs2(ROUTECTX ctx, int x, int y, int lay);
+void	set_powerbus_to_net(ROUTECTX ctx, int netnum);
+int     set_node_to_net(ROUTECTX ctx, NODE node, int newnet, POINT *pushlist, SEG bbox, u_char stage);
+int	disable_node_nets(ROUTECTX ctx, NODE node);
+int     set_routes_to_net(ROUTECTX ctx, NET net, int newnet, POINT *pushlist, SEG bbox, u_char stage);
+int	node_is_target(ROUTECTX ctx, NODE node);
+void	set_point_to_source(ROUTECTX ctx, int x, int y, int lay, POINT *pushlist);
+void	reset_search_subtree(ROUTECTX ctx, int x, int y, int lay, POINT *pushlist);
+void	set_route_to_source(ROUTECTX ctx, NET net, ROUTE rt, POINT *pushlist, u_char stage);
 u_char  ripup_net(NET net, u_char restore);
-int     eval_pt(GRIDP *ept, u_char flags, u_char stage);
-int     commit_proute(ROUTE rt, GRIDP *ept, u_char stage);
+int     eval_pt(ROUTECTX ctx, GRIDP *ept, u_char flags, u_char stage);
+int     commit_proute(ROUTECTX ctx, NET net, ROUTE rt, GRIDP *ept,
+		u_char stage);
 void	writeback_segment(SEG seg, int netnum);
 int     writeback_route(ROUTE rt);
 int     writeback_all_routes(NET net);
@@ -0,0 +1,436 @@
+/*--------------------------------------------------------------*/
+/* mem.c -- memory accounting by category			*/
+/*								*/
+/* The grid arrays and the records of routes, geometry and	*/
+/* the netlist are allocated through the wrappers below,	*/
+/* which count the bytes held in each category (see mem.h).	*/
+/* The caller passes the size of a block when freeing it.	*/
+/* mem_report() prints the current and peak totals at the end	*/
+/* of each phase of the program.				*/
+/*								*/
+/* Worker threads allocate routes and search memory, so the	*/
+/* counters are updated atomically.				*/
+/*								*/
+/* The grids are allocated through mem_map() (whole arrays)	*/
+/* and mem_page_alloc() (pages and tiles of the paged and	*/
+/* sparse grids).  With "scratch directory" in the		*/
+/* configuration file, both take their memory from files made	*/
+/* in that directory and mapped into memory, so that the	*/
+/* kernel can write grids out to disk rather than the process	*/
+/* run out of memory.  Each file is unlinked as soon as it is	*/
+/* mapped, and goes away with the process.			*/
+/*--------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "qrouter.h"
+#include "config.h"
+#include "mem.h"
+
+long	MemCurrent[MEM_CATEGORIES];
+long	MemPeak[MEM_CATEGORIES];
+long	MemTotal;		// bytes now allocated, all categories
+long	MemTotalPeak;		// most bytes ever allocated
+long	MemPhasePeak;		// most bytes allocated since the last report
+
+static char *MemNames[MEM_CATEGORIES] = {
+   "Obs", "Obs2", "Obsinfo", "Stub", "Nodeloc", "Mask",
+   "Routes", "Geometry", "Netlist", "Search", "Congestion"
+};
+
+// Pages handed out by mem_page_alloc() in scratch files are cut from
+// chunks of MEM_CHUNK bytes, and freed pages are kept on a list for
+// each size, under MemPageLock.
+
+#define MEM_CHUNK	(16 << 20)
+#define MEM_PAGE_SIZES	4
+
+static pthread_mutex_t MemPageLock = PTHREAD_MUTEX_INITIALIZER;
+static char   *MemChunk = NULL;		// rest of the current chunk
+static size_t MemChunkLeft = 0;		// bytes left in it
+static size_t MemPageSize[MEM_PAGE_SIZES];	// sizes of page handed out
+static void   *MemPageFree[MEM_PAGE_SIZES];	// freed pages of each size
+
+/*--------------------------------------------------------------*/
+/* mem_raise --- set *peak to value if value is larger		*/
+/*--------------------------------------------------------------*/
+
+static void mem_raise(long *peak, long value)
+{
+   long old;
+
+   while ((old = *peak) < value)
+      if (__sync_bool_compare_and_swap(peak, old, value)) break;
+}
+
+/*--------------------------------------------------------------*/
+/* mem_count --- add "bytes" (which may be negative) to the	*/
+/*	count of category "category".				*/
+/*--------------------------------------------------------------*/
+
+static void mem_count(int category, long bytes)
+{
+   long cur, total;
+
+   cur = __sync_add_and_fetch(&MemCurrent[category], bytes);
+   total = __sync_add_and_fetch(&MemTotal, bytes);
+   if (bytes <= 0) return;
+   mem_raise(&MemPeak[category], cur);
+   mem_raise(&MemTotalPeak, total);
+   mem_raise(&MemPhasePeak, total);
+}
+
+/*--------------------------------------------------------------*/
+/* mem_malloc, mem_calloc, mem_realloc --- as malloc(),		*/
+/*	calloc() and realloc(), counting the block in		*/
+/*	"category".  mem_realloc() takes the old size of the	*/
+/*	block.  Failures return NULL and are left to the	*/
+/*	caller.							*/
+/*--------------------------------------------------------------*/
+
+void *mem_malloc(int category, size_t size)
+{
+   void *ptr;
+
+   ptr = malloc(size);
+   if (ptr != NULL) mem_count(category, (long)size);
+   return ptr;
+}
+
+void *mem_calloc(int category, size_t n, size_t size)
+{
+   void *ptr;
+
+   ptr = calloc(n, size);
+   if (ptr != NULL) mem_count(category, (long)(n * size));
+   return ptr;
+}
+
+void *mem_realloc(int category, void *ptr, size_t oldsize, size_t size)
+{
+   void *newptr;
+
+   newptr = realloc(ptr, size);
+   if (newptr != NULL) {
+      if (ptr == NULL) oldsize = 0;
+      mem_count(category, (long)size - (long)oldsize);
+   }
+   return newptr;
+}
+
+/*--------------------------------------------------------------*/
+/* mem_free --- free a block of "size" bytes counted in		*/
+/*	"category".						*/
+/*--------------------------------------------------------------*/
+
+void mem_free(int category, void *ptr, size_t size)
+{
+   if (ptr == NULL) return;
+   free(ptr);
+   mem_count(category, -(long)size);
+}
+
+/*--------------------------------------------------------------*/
+/* mem_scratch --- map a new file of "size" bytes, all zero,	*/
+/*	made in ScratchDir.  A file that cannot be made or	*/
+/*	mapped ends the program with the reason, rather than	*/
+/*	leave the caller to report it as a lack of memory.	*/
+/*								*/
+/* Return value:  the mapped memory				*/
+/*--------------------------------------------------------------*/
+
+static void *mem_scratch(size_t size)
+{
+   char *path;
+   void *ptr;
+   int fd;
+
+   path = (char *)malloc(strlen(ScratchDir) + 16);
+   if (path == NULL) {
+      fprintf(stderr, "Out of memory in mem_scratch().\n");
+      exit(5);
+   }
+   sprintf(path, "%s/qrouterXXXXXX", ScratchDir);
+   fd = mkstemp(path);
+   if (fd < 0) {
+      fprintf(stderr, "Cannot make a scratch file in %s:  %s\n",
+		ScratchDir, strerror(errno));
+      exit(5);
+   }
+   unlink(path);
+   free(path);
+
+   ptr = MAP_FAILED;
+   if (ftruncate(fd, (off_t)size) == 0)
+      ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   if (ptr == MAP_FAILED) {
+      fprintf(stderr, "Cannot map a scratch file of %ld bytes in %s:  %s\n",
+		(long)size, ScratchDir, strerror(errno));
+      exit(5);
+   }
+   close(fd);
+   return ptr;
+}
+
+/*--------------------------------------------------------------*/
+/* mem_map --- allocate a grid array of "size" bytes, all	*/
+/*	zero, counted in "category".  The array is kept in a	*/
+/*	scratch file if ScratchDir is set.  Otherwise, failures	*/
+/*	return NULL and are left to the caller.			*/
+/*--------------------------------------------------------------*/
+
+void *mem_map(int category, size_t size)
+{
+   void *ptr;
+
+   if (ScratchDir == NULL) return mem_calloc(category, 1, size);
+
+   ptr = mem_scratch(size);
+   mem_count(category, (long)size);
+   return ptr;
+}
+
+/*--------------------------------------------------------------*/
+/* mem_unmap --- free an array of "size" bytes allocated by	*/
+/*	mem_map() in "category".				*/
+/*--------------------------------------------------------------*/
+
+void mem_unmap(int category, void *ptr, size_t size)
+{
+   if (ptr == NULL) return;
+   if (ScratchDir == NULL) {
+      mem_free(category, ptr, size);
+      return;
+   }
+   munmap(ptr, size);
+   mem_count(category, -(long)size);
+}
+
+/*--------------------------------------------------------------*/
+/* mem_page_alloc --- allocate a page of "size" bytes for a	*/
+/*	paged or sparse grid, counted in "category".  The page	*/
+/*	is not cleared.  With ScratchDir set, only a few	*/
+/*	different sizes may be used.  Failures return NULL and	*/
+/*	are left to the caller.					*/
+/*--------------------------------------------------------------*/
+
+void *mem_page_alloc(int category, size_t size)
+{
+   void *ptr;
+   int i;
+
+   if (ScratchDir == NULL) return mem_malloc(category, size);
+
+   pthread_mutex_lock(&MemPageLock);
+   for (i = 0; i < MEM_PAGE_SIZES; i++)
+      if ((MemPageSize[i] == size) || (MemPageSize[i] == 0)) break;
+   if (i == MEM_PAGE_SIZES) {
+      fprintf(stderr, "Too many page sizes in mem_page_alloc().\n");
+      exit(5);
+   }
+   MemPageSize[i] = size;
+
+   if ((ptr = MemPageFree[i]) != NULL)
+      MemPageFree[i] = *(void **)ptr;
+   else {
+      size = (size + 63) & ~(size_t)63;		// keep pages aligned
+      if (MemChunkLeft < size) {
+	 MemChunk = (char *)mem_scratch(MEM_CHUNK);
+	 MemChunkLeft = MEM_CHUNK;
+      }
+      if (MemChunkLeft >= size) {
+	 ptr = MemChunk;
+	 MemChunk += size;
+	 MemChunkLeft -= size;
+      }
+   }
+   pthread_mutex_unlock(&MemPageLock);
+
+   if (ptr != NULL) mem_count(category, (long)MemPageSize[i]);
+   return ptr;
+}
+
+/*--------------------------------------------------------------*/
+/* mem_page_free --- free a page of "size" bytes allocated by	*/
+/*	mem_page_alloc() in "category".  Pages in scratch files	*/
+/*	are kept to be handed out again.			*/
+/*--------------------------------------------------------------*/
+
+void mem_page_free(int category, void *ptr, size_t size)
+{
+   int i;
+
+   if (ptr == NULL) return;
+   if (ScratchDir == NULL) {
+      mem_free(category, ptr, size);
+      return;
+   }
+
+   pthread_mutex_lock(&MemPageLock);
+   for (i = 0; i < MEM_PAGE_SIZES; i++)
+      if (MemPageSize[i] == size) break;
+   *(void **)ptr = MemPageFree[i];
+   MemPageFree[i] = ptr;
+   pthread_mutex_unlock(&MemPageLock);
+   mem_count(category, -(long)size);
+}
+
+/*--------------------------------------------------------------*/
+/* mem_advise --- tell the kernel that the "size" bytes at	*/
+/*	"ptr" will be needed soon (MEM_NEED) or are done with	*/
+/*	for now (MEM_DONE).  Only grids in scratch files are	*/
+/*	advised, as memory not backed by a file would be sent	*/
+/*	to swap.						*/
+/*--------------------------------------------------------------*/
+
+void mem_advise(void *ptr, size_t size, int advice)
+{
+   static long pagesize = 0;
+   unsigned long start, end;
+
+   if ((ScratchDir == NULL) || (ptr == NULL) || (size == 0)) return;
+   if (pagesize == 0) pagesize = sysconf(_SC_PAGESIZE);
+
+   start = (unsigned long)ptr & ~(pagesize - 1);
+   end = ((unsigned long)ptr + size + pagesize - 1) & ~(pagesize - 1);
+
+   if (advice == MEM_NEED)
+      madvise((void *)start, end - start, MADV_WILLNEED);
+#ifdef MADV_COLD
+   else
+      madvise((void *)start, end - start, MADV_COLD);
+#endif
+}
+
+#define ARENA_DATA(b) ((char *)&(b)->align)
+
+/*--------------------------------------------------------------*/
+/* arena_new --- make an empty arena for the route records of	*/
+/*	a net.  Blocks are only allocated when records are	*/
+/*	taken.							*/
+/*								*/
+/* Return value:  the new arena					*/
+/*--------------------------------------------------------------*/
+
+ARENA arena_new()
+{
+   ARENA a;
+
+   a = (ARENA)mem_malloc(MEM_ROUTE, sizeof(struct arena_));
+   if (a == NULL) {
+      fprintf(stderr, "Out of memory in arena_new().\n");
+      exit(5);
+   }
+   a->block = NULL;
+   a->next = a->end = NULL;
+   return a;
+}
+
+/*--------------------------------------------------------------*/
+/* arena_alloc --- take a record of "size" bytes from arena	*/
+/*	"a", starting a new block, twice the size of the last,	*/
+/*	if the current one is full.				*/
+/*								*/
+/* Return value:  the record, not cleared			*/
+/*--------------------------------------------------------------*/
+
+void *arena_alloc(ARENA a, size_t size)
+{
+   struct arenablock_ *b;
+   size_t bsize;
+   void *ptr;
+
+   size = (size + sizeof(double) - 1) & ~(sizeof(double) - 1);
+   if ((size_t)(a->end - a->next) < size) {
+      bsize = (a->block == NULL) ? MEM_ARENA_MIN : a->block->size << 1;
+      if (bsize > MEM_ARENA_MAX) bsize = MEM_ARENA_MAX;
+      while (bsize < size + offsetof(struct arenablock_, align))
+	 bsize <<= 1;
+      b = (struct arenablock_ *)mem_malloc(MEM_ROUTE, bsize);
+      if (b == NULL) {
+	 fprintf(stderr, "Out of memory in arena_alloc().\n");
+	 exit(5);
+      }
+      b->prev = a->block;
+      b->size = bsize;
+      a->block = b;
+      a->next = ARENA_DATA(b);
+      a->end = (char *)b + bsize;
+   }
+   ptr = a->next;
+   a->next += size;
+   return ptr;
+}
+
+/*--------------------------------------------------------------*/
+/* arena_release --- free record "from" of arena "a" and every	*/
+/*	record taken after it.  If "from" is NULL, free every	*/
+/*	record, keeping the first block to be used again.	*/
+/*--------------------------------------------------------------*/
+
+void arena_release(ARENA a, void *from)
+{
+   struct arenablock_ *b;
+
+   while ((b = a->block) != NULL) {
+      if ((from == NULL) ? (b->prev == NULL) : (((char *)from >=
+		ARENA_DATA(b)) && ((char *)from < (char *)b + b->size))) {
+	 a->next = (from == NULL) ? ARENA_DATA(b) : (char *)from;
+	 a->end = (char *)b + b->size;
+	 return;
+      }
+      a->block = b->prev;
+      mem_free(MEM_ROUTE, b, b->size);
+   }
+   a->next = a->end = NULL;
+}
+
+/*--------------------------------------------------------------*/
+/* net_arena --- return the arena holding the ROUTE and SEG	*/
+/*	records of net "net", making it on first use.  Nets	*/
+/*	live until the program exits, and so do their arenas.	*/
+/*--------------------------------------------------------------*/
+
+ARENA net_arena(NET net)
+{
+   if (net->arena == (ARENA)NULL)
+      net->arena = arena_new();
+   return net->arena;
+}
+
+/*--------------------------------------------------------------*/
+/* mem_report --- print the memory in use at the end of phase	*/
+/*	"phase", with the most used during the phase and	*/
+/*	during the whole run.  With verbose output, also print	*/
+/*	the current and peak use of each category.  Must not	*/
+/*	be called while worker threads are running.		*/
+/*--------------------------------------------------------------*/
+
+void mem_report(char *phase)
+{
+   int i;
+
+   fprintf(stdout, "Memory after %s:  %.2f MB in use, %.2f MB peak "
+		"(%.2f MB overall)\n", phase, MemTotal / 1048576.0,
+		MemPhasePeak / 1048576.0, MemTotalPeak / 1048576.0);
+
+   if (Verbose > 0) {
+      for (i = 0; i < MEM_CATEGORIES; i++) {
+	 if (MemPeak[i] == 0) continue;
+	 fprintf(stdout, "   %-12s %10.2f MB in use, %10.2f MB peak\n",
+		MemNames[i], MemCurrent[i] / 1048576.0,
+		MemPeak[i] / 1048576.0);
+      }
+   }
+   fflush(stdout);
+
+   MemPhasePeak = MemTotal;
+}
+
+/* end of mem.c */
@@ -0,0 +1,74 @@
+/*--------------------------------------------------------------*/
+/* mem.h -- memory accounting by category			*/
+/*--------------------------------------------------------------*/
+
+#ifndef MEM_H
+
+#include <stddef.h>
+
+// Categories of allocated memory
+
+#define MEM_OBS		0	// Obs[] and worker copies of it
+#define MEM_OBS2	1	// obs2[] of each search context
+#define MEM_OBSINFO	2	// Obsinfo[]
+#define MEM_STUB	3	// Stub[]
+#define MEM_NODELOC	4	// Nodeidx[], NodeTable and the index of
+				// each net's positions
+#define MEM_MASK	5	// search corridor masks
+#define MEM_ROUTE	6	// ROUTE and SEG records
+#define MEM_GEOMETRY	7	// DSEG and DPOINT records
+#define MEM_NETLIST	8	// GATE, NODE and NET records
+#define MEM_SEARCH	9	// search contexts, queues and POINT blocks
+#define MEM_CONGESTION	10	// congestion map, negotiation and global routing
+#define MEM_CATEGORIES	11
+
+// Advice for mem_advise()
+
+#define MEM_NEED	0	// grid area about to be searched
+#define MEM_DONE	1	// grid area searched
+
+extern long MemCurrent[MEM_CATEGORIES];	// bytes now allocated
+extern long MemPeak[MEM_CATEGORIES];	// most bytes ever allocated
+
+void	*mem_malloc(int category, size_t size);
+void	*mem_calloc(int category, size_t n, size_t size);
+void	*mem_realloc(int category, void *ptr, size_t oldsize, size_t size);
+void	mem_free(int category, void *ptr, size_t size);
+void	*mem_map(int category, size_t size);
+void	mem_unmap(int category, void *ptr, size_t size);
+void	*mem_page_alloc(int category, size_t size);
+void	mem_page_free(int category, void *ptr, size_t size);
+void	mem_advise(void *ptr, size_t size, int advice);
+void	mem_report(char *phase);
+
+// An arena holds the ROUTE and SEG records of one net.  Records are
+// taken in turn from a stack of blocks, starting at MEM_ARENA_MIN
+// bytes and doubling up to MEM_ARENA_MAX, so that the segments of a
+// route lie together in memory.  Records are never freed one at a
+// time:  arena_release() frees a record and all those taken after
+// it, or every record of the arena, at once.
+
+#define MEM_ARENA_MIN	128
+#define MEM_ARENA_MAX	4096
+
+struct arenablock_ {
+   struct arenablock_ *prev;	// block used before this one
+   size_t size;			// bytes in the block, with this header
+   double align;		// records start here
+};
+
+struct arena_ {
+   struct arenablock_ *block;	// block records are taken from
+   char   *next;		// next free byte of the block
+   char   *end;			// end of the block
+};
+
+ARENA	arena_new(void);
+void	*arena_alloc(ARENA a, size_t size);
+void	arena_release(ARENA a, void *from);
+ARENA	net_arena(NET net);
+
+#define MEM_H
+#endif
+
+/* end of mem.h */
@@ -0,0 +1,392 @@
+/*--------------------------------------------------------------*/
+/* negotiate.c -- negotiated congestion routing			*/
+/*								*/
+/* With "negotiate N" in the configuration file, nets that	*/
+/* failed the first stage are routed in up to N passes of	*/
+/* negotiated congestion routing before the rip-up and reroute	*/
+/* stage.  The failed nets are ripped up, and in each pass	*/
+/* every net being negotiated is routed again, in order, as in	*/
+/* the rip-up and reroute stage (stage 1), but without writing	*/
+/* its route into Obs[].  Instead, each position counts the	*/
+/* routes using it (Occupancy[]).  A search pays PresentCost	*/
+/* for each other route on a position, and History[] for each	*/
+/* time the position was overused at the end of a pass.  After	*/
+/* each pass PresentCost grows, so that routes that share	*/
+/* positions are pushed apart, the more so where they have	*/
+/* shared before.  A route that crosses a net already in Obs[]	*/
+/* rips it up, and that net joins the negotiation.		*/
+/*								*/
+/* When no position is overused, or after N passes, the routes	*/
+/* are written into Obs[] in order.  A route overlapping one	*/
+/* written before it, or the positions next to it that it	*/
+/* blocks for spacing, is dropped, and its net left, with any	*/
+/* net that could not be routed at all, to dosecondstage().	*/
+/*								*/
+/* Within a pass, nets are routed in batches by the worker	*/
+/* threads (see parallel.c), each batch against Occupancy[] as	*/
+/* it was before the batch.  Nets of a batch have separate	*/
+/* areas, so that they do not all pick the same free		*/
+/* positions.  With one thread, each batch is a single net.	*/
+/*--------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "qrouter.h"
+#include "config.h"
+#include "node.h"
+#include "grid.h"
+#include "maze.h"
+#include "lef.h"
+#include "parallel.h"
+#include "negotiate.h"
+#include "mem.h"
+
+u_char	*Occupancy[MAX_LAYERS];	// routes using each position
+u_short	*History[MAX_LAYERS];	// cost of past overuse of each position
+int	PresentCost;		// cost per route sharing a position
+
+#define MAX_NEGOTIATED_COST 10000	// limit on History[] and PresentCost
+#define NEGOTIATE_STALL	5	// passes without progress before giving up
+
+/*--------------------------------------------------------------*/
+/* compare_positions --- qsort() comparison of two grid		*/
+/*	positions as made by occupy_net().			*/
+/*--------------------------------------------------------------*/
+
+int compare_positions(const void *a, const void *b)
+{
+   u_int pa = *(const u_int *)a;
+   u_int pb = *(const u_int *)b;
+
+   return (pa < pb) ? -1 : (pa > pb) ? 1 : 0;
+}
+
+/*--------------------------------------------------------------*/
+/* occupy_net --- add "delta" (1 or -1) to Occupancy[] at every	*/
+/*	position used by the routes of net "net".  A position	*/
+/*	used by several segments of the net is counted once.	*/
+/*--------------------------------------------------------------*/
+
+void occupy_net(NET net, int delta)
+{
+   ROUTE rt;
+   SEG seg;
+   u_int *pos;
+   int npos, maxpos, area, i, o, x, y, lay;
+
+   area = NumChannelsX[0] * NumChannelsY[0];
+   npos = maxpos = 0;
+   pos = NULL;
+
+   for (rt = net->routes; rt; rt = rt->next) {
+      for (seg = rt->segments; seg; seg = seg->next) {
+	 x = seg->x1;
+	 y = seg->y1;
+	 while (1) {
+	    if (npos + 2 > maxpos) {
+	       maxpos = 2 * maxpos + 64;
+	       pos = (u_int *)realloc(pos, maxpos * sizeof(u_int));
+	       if (pos == NULL) {
+		  fprintf(stderr, "Out of memory in occupy_net().\n");
+		  exit(10);
+	       }
+	    }
+	    lay = seg->layer;
+	    pos[npos++] = lay * area + OGRID(x, y, lay);
+	    if (seg->segtype & ST_VIA)
+	       pos[npos++] = (lay + 1) * area + OGRID(x, y, lay + 1);
+
+	    if ((x == seg->x2) && (y == seg->y2)) break;
+	    if (x < seg->x2) x++;
+	    else if (x > seg->x2) x--;
+	    if (y < seg->y2) y++;
+	    else if (y > seg->y2) y--;
+	 }
+      }
+   }
+   if (npos == 0) return;
+
+   qsort(pos, npos, sizeof(u_int), compare_positions);
+   for (i = 0; i < npos; i++) {
+      if ((i > 0) && (pos[i] == pos[i - 1])) continue;
+      lay = pos[i] / area;
+      o = pos[i] % area;
+      if (delta > 0) {
+	 if (Occupancy[lay][o] < 255) Occupancy[lay][o]++;
+      }
+      else if (Occupancy[lay][o] > 0)
+	 Occupancy[lay][o]--;
+   }
+   free(pos);
+}
+
+/*--------------------------------------------------------------*/
+/* crosses_blocks --- check whether the routes of net "net" use	*/
+/*	a position that a route already in Obs[] has blocked	*/
+/*	for spacing.  writeback_segment() marks those positions	*/
+/*	(NO_NET | ROUTED_NET), so that find_colliding() does	*/
+/*	not see them, as they belong to no net.			*/
+/*								*/
+/* Return value:  TRUE if the net uses a blocked position,	*/
+/*	FALSE otherwise						*/
+/*--------------------------------------------------------------*/
+
+u_char crosses_blocks(NET net)
+{
+   ROUTE rt;
+   SEG seg;
+   int x, y, lay;
+
+   for (rt = net->routes; rt; rt = rt->next) {
+      for (seg = rt->segments; seg; seg = seg->next) {
+	 lay = seg->layer;
+	 x = seg->x1;
+	 y = seg->y1;
+	 while (1) {
+	    if ((OBSVAL(x, y, lay) & (NO_NET | ROUTED_NET)) ==
+			(NO_NET | ROUTED_NET))
+	       return TRUE;
+	    if ((seg->segtype & ST_VIA) && ((OBSVAL(x, y, lay + 1) &
+			(NO_NET | ROUTED_NET)) == (NO_NET | ROUTED_NET)))
+	       return TRUE;
+
+	    if ((x == seg->x2) && (y == seg->y2)) break;
+	    if (x < seg->x2) x++;
+	    else if (x > seg->x2) x--;
+	    if (y < seg->y2) y++;
+	    else if (y > seg->y2) y--;
+	 }
+      }
+   }
+   return FALSE;
+}
+
+/*--------------------------------------------------------------*/
+/* update_history --- at the end of a pass, add HistoryCost to	*/
+/*	History[] for each route beyond the first on every	*/
+/*	position.						*/
+/*								*/
+/* Return value:  number of positions used by more than one	*/
+/*	route							*/
+/*--------------------------------------------------------------*/
+
+int update_history()
+{
+   int lay, i, n, overused;
+   u_int h;
+
+   overused = 0;
+   for (lay = 0; lay < Num_layers; lay++) {
+      n = NumChannelsX[lay] * NumChannelsY[lay];
+      for (i = 0; i < n; i++) {
+	 if (Occupancy[lay][i] > 1) {
+	    overused++;
+	    h = History[lay][i] + HistoryCost * (Occupancy[lay][i] - 1);
+	    History[lay][i] = (u_short)MIN(h, MAX_NEGOTIATED_COST);
+	 }
+      }
+   }
+   return overused;
+}
+
+/*--------------------------------------------------------------*/
+/* donegotiation --- route the nets on FailedNets by negotiated	*/
+/*	congestion, as described at the top of this file.  Nets	*/
+/*	that do not come out of it with a route of their own	*/
+/*	are left on FailedNets.					*/
+/*--------------------------------------------------------------*/
+
+void donegotiation(ROUTECTX ctx)
+{
+   NET net, *nets;
+   NETLIST nl, nl2;
+   u_char *innego, *failed;
+   int *results;
+   SEG regions;
+   int numnets, maxbatch, i, j, k, nb, pass, overused, nfailed, lay;
+   int leastoverused, stalled;
+   u_char changed;
+
+   if ((FailedNets == NULL) || (NegotiatePasses <= 0)) return;
+
+   // Batches are routed on the worker threads, except in speculative
+   // mode, whose routes must be those of a single thread.
+
+   if ((RouteThreads > 1) && (ParallelMode != PARALLEL_SPECULATIVE))
+      start_route_workers(FALSE);
+   maxbatch = (NumWorkers > 0) ? 4 * NumWorkers : 1;
+
+   nets = (NET *)malloc((Numnets + 1) * sizeof(NET));
+   failed = (u_char *)calloc(Numnets + 1, sizeof(u_char));
+   innego = (u_char *)calloc(Numnets + 1, sizeof(u_char));
+   results = (int *)malloc(maxbatch * sizeof(int));
+   regions = (SEG)malloc(maxbatch * sizeof(struct seg_));
+   if (!nets || !failed || !innego || !results || !regions) {
+      fprintf(stderr, "Out of memory in donegotiation().\n");
+      exit(10);
+   }
+
+   for (lay = 0; lay < Num_layers; lay++) {
+      Occupancy[lay] = (u_char *)mem_calloc(MEM_CONGESTION,
+		NumChannelsX[lay] * NumChannelsY[lay], sizeof(u_char));
+      History[lay] = (u_short *)mem_calloc(MEM_CONGESTION,
+		NumChannelsX[lay] * NumChannelsY[lay], sizeof(u_short));
+      if (!Occupancy[lay] || !History[lay]) {
+	 fprintf(stderr, "Out of memory in donegotiation().\n");
+	 exit(10);
+      }
+   }
+
+   // Take the failed nets in the order of the routing queue, and
+   // remove what they have routed so far.
+
+   FailedNets = sortlist(FailedNets);
+   numnets = 0;
+   while (FailedNets) {
+      net = FailedNets->net;
+      nl = FailedNets->next;
+      free(FailedNets);
+      FailedNets = nl;
+      if (innego[net->netnum]) continue;
+      innego[net->netnum] = TRUE;
+      nets[numnets++] = net;
+      ripup_net(net, (u_char)1);
+   }
+
+   fprintf(stdout, "Negotiated routing of %d nets with %d threads\n",
+		numnets, (NumWorkers > 0) ? NumWorkers : 1);
+
+   PresentCost = ShareCost;
+   leastoverused = -1;
+   stalled = 0;
+   for (pass = 1; pass <= NegotiatePasses; pass++) {
+      nfailed = 0;
+      changed = FALSE;
+      for (i = 0; i < numnets; i += nb) {
+
+	 // Gather the next nets whose areas are clear of each other
+
+	 for (nb = 0; (nb < maxbatch) && (i + nb < numnets); nb++) {
+	    net_region(nets[i + nb], &regions[nb], RouteHalo);
+	    for (j = 0; j < nb; j++)
+	       if (regions_conflict(&regions[nb], &regions[j])) break;
+	    if (j < nb) break;
+	 }
+
+	 for (j = 0; j < nb; j++) {
+	    occupy_net(nets[i + j], -1);
+	    discard_routes(nets[i + j], (ROUTE)NULL);
+	 }
+
+	 route_nets(ctx, &nets[i], (SEG)NULL, results, nb, (u_char)1);
+
+	 for (j = 0; j < nb; j++) {
+	    k = i + j;
+	    net = nets[k];
+	    if (failed[k] != ((results[j] != 0) ? TRUE : FALSE))
+	       changed = TRUE;
+	    failed[k] = (results[j] != 0) ? TRUE : FALSE;
+	    if (failed[k]) {
+	       nfailed++;
+	       discard_routes(net, (ROUTE)NULL);
+	       continue;
+	    }
+
+	    // Nets in Obs[] crossed by the route are ripped up, to be
+	    // routed later in this pass.
+
+	    nl = find_colliding(net);
+	    while (nl) {
+	       nl2 = nl->next;
+	       if (!innego[nl->net->netnum] &&
+				(ripup_net(nl->net, (u_char)1) == TRUE)) {
+		  if (Verbose > 0)
+		     fprintf(stdout, "Ripping up blocking net %s\n",
+				nl->net->netname);
+		  innego[nl->net->netnum] = TRUE;
+		  nets[numnets++] = nl->net;
+	       }
+	       free(nl);
+	       nl = nl2;
+	    }
+	    occupy_net(net, 1);
+	 }
+      }
+
+      overused = update_history();
+      fprintf(stdout, "Negotiation pass %d:  %d nets, %d failed, "
+		"%d positions overused\n", pass, numnets, nfailed, overused);
+      fflush(stdout);
+
+      // With no position shared, raising the costs changes nothing,
+      // and the nets that failed cannot be routed even over others.
+      // Stop also once NEGOTIATE_STALL passes in a row have failed
+      // the same nets without sharing fewer positions than ever.
+
+      if (overused == 0) break;
+      if ((leastoverused < 0) || (overused < leastoverused)) {
+	 leastoverused = overused;
+	 stalled = 0;
+      }
+      else if (changed)
+	 stalled = 0;
+      else if (++stalled >= NEGOTIATE_STALL)
+	 break;
+
+      PresentCost = MIN(PresentCost * 3 / 2 + 1, MAX_NEGOTIATED_COST);
+   }
+
+   if (NumWorkers > 0) stop_route_workers(ctx);
+
+   for (lay = 0; lay < Num_layers; lay++) {
+      mem_free(MEM_CONGESTION, Occupancy[lay],
+		NumChannelsX[lay] * NumChannelsY[lay] * sizeof(u_char));
+      mem_free(MEM_CONGESTION, History[lay],
+		NumChannelsX[lay] * NumChannelsY[lay] * sizeof(u_short));
+      Occupancy[lay] = NULL;
+      History[lay] = NULL;
+   }
+
+   // Write the routes into Obs[] in order.  A route that still shares
+   // positions with one written before it, or uses positions that one
+   // blocked for spacing, is dropped.
+
+   nfailed = 0;
+   for (k = 0; k < numnets; k++) {
+      net = nets[k];
+      if (!failed[k]) {
+	 nl = find_colliding(net);
+	 if (nl == NULL) {
+	    if (crosses_blocks(net) == FALSE) {
+	       writeback_all_routes(net);
+	       continue;
+	    }
+	    fprintf(stderr, "Negotiated route of %s is too close to "
+			"another net\n", net->netname);
+	 }
+	 while (nl) {
+	    nl2 = nl->next;
+	    free(nl);
+	    nl = nl2;
+	 }
+      }
+      discard_routes(net, (ROUTE)NULL);
+      nl = (NETLIST)malloc(sizeof(struct netlist_));
+      nl->net = net;
+      nl->next = FailedNets;
+      FailedNets = nl;
+      nfailed++;
+   }
+   fprintf(stdout, "Negotiated routing:  %d nets routed, %d left for "
+		"rip-up and reroute\n", numnets - nfailed, nfailed);
+
+   free(nets);
+   free(failed);
+   free(innego);
+   free(results);
+   free(regions);
+}
+
+/* end of negotiate.c */
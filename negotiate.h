@@ -0,0 +1,26 @@
+/*--------------------------------------------------------------*/
+/* negotiate.h -- negotiated congestion routing			*/
+/*--------------------------------------------------------------*/
+
+#ifndef NEGOTIATE_H
+
+extern u_char  *Occupancy[MAX_LAYERS];	// routes using each position
+extern u_short *History[MAX_LAYERS];	// cost of past overuse of each position
+extern int     PresentCost;		// cost per route sharing a position
+
+// Cost added by eval_pt() for stepping onto a position while
+// negotiating (Occupancy[0] is NULL otherwise).
+
+#define NEGOTIATED_COST(x, y, layer) \
+		(History[layer][OGRID(x, y, layer)] + \
+		PresentCost * Occupancy[layer][OGRID(x, y, layer)])
+
+void	occupy_net(NET net, int delta);
+u_char	crosses_blocks(NET net);
+int	update_history();
+void	donegotiation(ROUTECTX ctx);
+
+#define NEGOTIATE_H
+#endif
+
+/* end of negotiate.h */
@@ -17,56 +17,540 @@
 #include "node.h"
 #include "config.h"
 #include "lef.h"
+#include "mem.h"
+#include "grid.h"
+
+NODE *NodeTable = NULL;		// nodes placed on the grid, by index
+u_int NodeTableSize = 0;	// entries used in NodeTable
+u_int NodeTableAlloc = 0;	// entries allocated in NodeTable
+
+NET *NetOrderTable = NULL;	// routing queue:  routable nets in order
+int NetOrderTableSize = 0;	// number of nets in NetOrderTable
+
+u_int *NodelocTable = NULL;	// Nodeloc positions of each net, in turn
+int *NodelocStart = NULL;	// start of each net's positions in
+				// NodelocTable, by net number
+u_char NodelocMoved = FALSE;	// TRUE if make_routable() has added a
+				// position missing from NodelocTable
+
+float *Congestion[MAX_LAYERS];	// estimated use of the free tracks of
+				// each tile, by layer (see congestion_map())
+int CongTilesX = 0;		// tiles of the congestion map in X
+int CongTilesY = 0;		// and in Y
+
+// Sort record for create_netorder()
+
+typedef struct netkey_ NETKEY;
+
+struct netkey_ {
+   NET    net;
+   double key;		// nets with higher keys are routed first
+   int    index;	// position in Nlnets, to make the sort stable
+};
+
+/*--------------------------------------------------------------*/
+/* compare_netkeys --- qsort() comparison for NETKEY records,	*/
+/*	highest key first, then in order of Nlnets.		*/
+/*--------------------------------------------------------------*/
+
+int compare_netkeys(const void *a, const void *b)
+{
+   NETKEY *ka = (NETKEY *)a;
+   NETKEY *kb = (NETKEY *)b;
+
+   if (ka->key > kb->key) return -1;
+   if (ka->key < kb->key) return 1;
+   return ka->index - kb->index;
+}
+
+/*--------------------------------------------------------------*/
+/* net_bbox --- find the extent, in routing grid units, of the	*/
+/*	taps of all nodes of a net.				*/
+/*								*/
+/*  RETURNS: FALSE if the net has no taps, TRUE otherwise	*/
+/*--------------------------------------------------------------*/
+
+int net_bbox(NET net, int *x1, int *y1, int *x2, int *y2)
+{
+   NODE node;
+   DPOINT dp;
+   int found = FALSE;
+
+   for (node = net->netnodes; node; node = node->next) {
+      for (dp = node->taps; dp; dp = dp->next) {
+	 if (!found) {
+	    *x1 = *x2 = dp->gridx;
+	    *y1 = *y2 = dp->gridy;
+	    found = TRUE;
+	 }
+	 else {
+	    if (dp->gridx < *x1) *x1 = dp->gridx;
+	    if (dp->gridx > *x2) *x2 = dp->gridx;
+	    if (dp->gridy < *y1) *y1 = dp->gridy;
+	    if (dp->gridy > *y2) *y2 = dp->gridy;
+	 }
+      }
+   }
+   return found;
+}
+
+/*--------------------------------------------------------------*/
+/* congestion_map --- estimate, before routing, how much of the	*/
+/*	free track capacity of each tile of ORDER_TILE by	*/
+/*	ORDER_TILE grid positions will be used, on each layer.	*/
+/*	Each net other than power and ground spreads its wire	*/
+/*	evenly over its bounding box of w by h tiles (RUDY):	*/
+/*	1 / h tile lengths of horizontal wire per tile, and	*/
+/*	1 / w of vertical wire.  The capacity of a tile in each	*/
+/*	direction is the number of its positions free in Obs[]	*/
+/*	on layers routed in that direction, divided by		*/
+/*	ORDER_TILE.  The demand of each direction over its	*/
+/*	capacity is recorded for every layer routed in that	*/
+/*	direction, in Congestion[].				*/
+/*								*/
+/*  ARGS: none							*/
+/*  RETURNS: nothing						*/
+/*  SIDE EFFECTS: Congestion[], CongTilesX and CongTilesY are	*/
+/*	set.  Obs[] must hold all obstructions.			*/
+/*--------------------------------------------------------------*/
+
+void congestion_map()
+{
+   int i, t, x, y, lay, w, h, ntx, nty, tx1, ty1, tx2, ty2;
+   double *demand[2], *cap[2], d;
+   u_char dir;
+   NET net;
+
+   CongTilesX = (NumChannelsX[0] + ORDER_TILE - 1) / ORDER_TILE;
+   CongTilesY = (NumChannelsY[0] + ORDER_TILE - 1) / ORDER_TILE;
+
+   // Demand is accumulated at the corners of each box, on a map
+   // with one more row and column, then integrated.
+
+   ntx = CongTilesX + 1;
+   nty = CongTilesY + 1;
+   for (i = 0; i < 2; i++) {
+      demand[i] = (double *)mem_calloc(MEM_CONGESTION, ntx * nty,
+			sizeof(double));
+      cap[i] = (double *)mem_calloc(MEM_CONGESTION, ntx * nty, sizeof(double));
+      if (!demand[i] || !cap[i]) {
+	 fprintf(stderr, "Out of memory in congestion_map().\n");
+	 exit(10);
+      }
+   }
+
+   for (net = Nlnets; net; net = net->next) {
+      if ((net->netnum == VDD_NET) || (net->netnum == GND_NET)) continue;
+      if (!net_bbox(net, &tx1, &ty1, &tx2, &ty2)) continue;
+      tx1 = MAX(tx1, 0) / ORDER_TILE;
+      ty1 = MAX(ty1, 0) / ORDER_TILE;
+      tx2 = MIN(MAX(tx2, 0) / ORDER_TILE, CongTilesX - 1);
+      ty2 = MIN(MAX(ty2, 0) / ORDER_TILE, CongTilesY - 1);
+      w = tx2 - tx1 + 1;
+      h = ty2 - ty1 + 1;
+      for (i = 0; i < 2; i++) {
+	 d = (i == 1) ? 1.0 / (double)h : 1.0 / (double)w;
+	 demand[i][ty1 * ntx + tx1] += d;
+	 demand[i][ty1 * ntx + tx2 + 1] -= d;
+	 demand[i][(ty2 + 1) * ntx + tx1] -= d;
+	 demand[i][(ty2 + 1) * ntx + tx2 + 1] += d;
+      }
+   }
+   for (i = 0; i < 2; i++) {
+      for (y = 0; y < nty; y++)
+	 for (x = 1; x < ntx; x++)
+	    demand[i][y * ntx + x] += demand[i][y * ntx + x - 1];
+      for (y = 1; y < nty; y++)
+	 for (x = 0; x < ntx; x++)
+	    demand[i][y * ntx + x] += demand[i][(y - 1) * ntx + x];
+   }
+
+   // Free tracks.  Index 1 is horizontal, 0 vertical.
+
+   for (lay = 0; lay < Num_layers; lay++) {
+      dir = (LefGetRouteOrientation(lay) == 1) ? 1 : 0;
+      for (y = 0; y < NumChannelsY[lay]; y++)
+	 for (x = 0; x < NumChannelsX[lay]; x++)
+	    if (!(OBSVAL(x, y, lay) & (NO_NET | ROUTED_NET)))
+	       cap[dir][(y / ORDER_TILE) * ntx + x / ORDER_TILE] +=
+			1.0 / ORDER_TILE;
+   }
+
+   for (lay = 0; lay < Num_layers; lay++) {
+      dir = (LefGetRouteOrientation(lay) == 1) ? 1 : 0;
+      Congestion[lay] = (float *)mem_malloc(MEM_CONGESTION,
+			CongTilesX * CongTilesY * sizeof(float));
+      if (Congestion[lay] == NULL) {
+	 fprintf(stderr, "Out of memory in congestion_map().\n");
+	 exit(10);
+      }
+      for (y = 0; y < CongTilesY; y++) {
+	 for (x = 0; x < CongTilesX; x++) {
+	    t = y * ntx + x;
+	    if (demand[dir][t] < 1e-9)		// rounding of the sums
+	       d = 0.0;
+	    else if (cap[dir][t] > 0.0)
+	       d = demand[dir][t] / cap[dir][t];
+	    else
+	       d = (demand[dir][t] > 0.0) ? MAX_CONGESTION : 0.0;
+	    Congestion[lay][y * CongTilesX + x] = (float)MIN(d, MAX_CONGESTION);
+	 }
+      }
+   }
+
+   for (i = 0; i < 2; i++) {
+      mem_free(MEM_CONGESTION, demand[i], ntx * nty * sizeof(double));
+      mem_free(MEM_CONGESTION, cap[i], ntx * nty * sizeof(double));
+   }
+}
+
+/*--------------------------------------------------------------*/
+/* write_congestion_map --- write the map made by		*/
+/*	congestion_map() to one CSV file per layer, named	*/
+/*	"<prefix>_<layer name>.csv".  Each line is a row of	*/
+/*	tiles, the top row first, so that the file reads as an	*/
+/*	image of the layout.					*/
+/*								*/
+/*  ARGS: prefix of the file names				*/
+/*  RETURNS: nothing						*/
+/*--------------------------------------------------------------*/
+
+void write_congestion_map(char *prefix)
+{
+   char filename[512];
+   FILE *f;
+   int lay, x, y;
+
+   for (lay = 0; lay < Num_layers; lay++) {
+      snprintf(filename, sizeof(filename), "%s_%s.csv", prefix,
+		LefGetRouteName(lay));
+      f = fopen(filename, "w");
+      if (f == NULL) {
+	 fprintf(stderr, "Cannot open congestion map file: ");
+	 perror(filename);
+	 continue;
+      }
+      for (y = CongTilesY - 1; y >= 0; y--) {
+	 for (x = 0; x < CongTilesX; x++)
+	    fprintf(f, (x == 0) ? "%.3f" : ",%.3f",
+			Congestion[lay][y * CongTilesX + x]);
+	 fprintf(f, "\n");
+      }
+      fclose(f);
+      fprintf(stdout, "Congestion map of layer %s written to %s\n",
+		LefGetRouteName(lay), filename);
+   }
+}
+
+/*--------------------------------------------------------------*/
+/* estimate_congestion --- set the key of each net to the	*/
+/*	average over its bounding box of the congestion made by	*/
+/*	congestion_map(), in the most congested direction of	*/
+/*	each tile.  The averages are computed with a summed-	*/
+/*	area table, so the cost is linear in the number of nets	*/
+/*	plus the number of tiles.				*/
+/*--------------------------------------------------------------*/
+
+void estimate_congestion(NETKEY *keys, int numkeys)
+{
+   int i, x, y, lay, ntx, tx1, ty1, tx2, ty2;
+   double *map, d;
+
+   // Tiles are numbered from 1, so that row and column 0 of the
+   // table remain zero.
+
+   ntx = CongTilesX + 1;
+   map = (double *)mem_calloc(MEM_CONGESTION, ntx * (CongTilesY + 1),
+		sizeof(double));
+   if (map == NULL) {
+      fprintf(stderr, "Out of memory in estimate_congestion().\n");
+      exit(10);
+   }
+   for (y = 1; y <= CongTilesY; y++) {
+      for (x = 1; x <= CongTilesX; x++) {
+	 d = 0.0;
+	 for (lay = 0; lay < Num_layers; lay++)
+	    d = MAX(d, Congestion[lay][(y - 1) * CongTilesX + x - 1]);
+	 map[y * ntx + x] = d + map[(y - 1) * ntx + x] + map[y * ntx + x - 1]
+			- map[(y - 1) * ntx + x - 1];
+      }
+   }
+
+   for (i = 0; i < numkeys; i++) {
+      keys[i].key = 0.0;
+      if (!net_bbox(keys[i].net, &tx1, &ty1, &tx2, &ty2)) continue;
+      tx1 = MAX(tx1, 0) / ORDER_TILE + 1;
+      ty1 = MAX(ty1, 0) / ORDER_TILE + 1;
+      tx2 = MIN(MAX(tx2, 0) / ORDER_TILE + 1, CongTilesX);
+      ty2 = MIN(MAX(ty2, 0) / ORDER_TILE + 1, CongTilesY);
+      d = map[ty2 * ntx + tx2] - map[(ty1 - 1) * ntx + tx2]
+		- map[ty2 * ntx + tx1 - 1]
+		+ map[(ty1 - 1) * ntx + tx1 - 1];
+      keys[i].key = d / (double)((tx2 - tx1 + 1) * (ty2 - ty1 + 1));
+   }
+   mem_free(MEM_CONGESTION, map, ntx * (CongTilesY + 1) * sizeof(double));
+}
+
+/*--------------------------------------------------------------*/
+/* net_routable --- TRUE if the net has enough nodes to route	*/
+/*--------------------------------------------------------------*/
+
+int net_routable(NET net)
+{
+   if (net->numnodes >= 2) return TRUE;
+
+   // Qrouter will route power and ground nets even if the
+   // standard cell power and ground pins are not listed in
+   // the nets section.  Because of this, it is okay to have
+   // only one node.
+   if (net->numnodes == 1 && (net->netnum == VDD_NET ||
+		net->netnum == GND_NET))
+      return TRUE;
+   return FALSE;
+}
 
 /*--------------------------------------------------------------*/
 /* create_netorder --- assign indexes to net->netorder    	*/
 /*								*/
-/* 	Nets are ordered simply from those with the most nodes	*/
-/*	to those with the fewest.  However, any nets marked	*/
-/* 	critical in the configuration or critical net files	*/
-/*	will be given precedence.				*/
+/* 	Any nets marked critical in the configuration or	*/
+/*	critical net files are given precedence, in the order	*/
+/*	listed.  The remaining nets are sorted by the key set	*/
+/*	with "net order" in the configuration file:		*/
+/*	ORDER_PINS:  from those with the most nodes to those	*/
+/*		with the fewest (the default).			*/
+/*	ORDER_LENGTH:  from the smallest bounding box half-	*/
+/*		perimeter to the largest.			*/
+/*	ORDER_CONGESTION:  from the highest estimated		*/
+/*		congestion to the lowest.  congestion_map()	*/
+/*		must have been called.				*/
+/*	Nets with equal keys are kept in order of Nlnets.	*/
 /*								*/
 /*  ARGS: none							*/
 /*  RETURNS: nothing						*/
-/*  SIDE EFFECTS: Nlnets -> netorder is assigned		*/
+/*  SIDE EFFECTS: Nlnets -> netorder is assigned, and the	*/
+/*	routable nets are placed in NetOrderTable in order	*/
 /*--------------------------------------------------------------*/
 
 void create_netorder()
 {
-  int i, max;
+  int i, j, n, x1, y1, x2, y2;
   NET  net;
   STRING cn;
+  NETKEY *keys;
+
+  n = 0;
+  for (net = Nlnets; net; net = net->next) {
+     net->netorder = 0;
+     n++;
+  }
+
+  if (NetOrderTable != NULL) free(NetOrderTable);
+  NetOrderTable = (NET *)malloc((n + 1) * sizeof(NET));
+  NetOrderTableSize = 0;
 
   i = 1;
   for (cn = CriticalNet; cn; cn = cn->next) {
      fprintf(stdout, "critical net %s\n", cn->name);
-     for (net = Nlnets; net; net = net->next) {
-	if (!strcmp(net->netname, (char *)cn->name)) {
-           net->netorder = i++;
-	}
+     net = DefFindNet((char *)cn->name);
+     if ((net != NULL) && (net->netorder == 0)) {
+	net->netorder = i++;
+	if (net_routable(net))
+	   NetOrderTable[NetOrderTableSize++] = net;
      }
   }
 
-  for (; i <= Numnets; i++) {
-     max = 0;
-
-     for (net = Nlnets; net; net = net->next) {
-	if (!net->netorder) {
-	   if (net->numnodes > max) max = net->numnodes;
-	}
+  keys = (NETKEY *)malloc((n + 1) * sizeof(NETKEY));
+  j = 0;
+  n = 0;
+  for (net = Nlnets; net; net = net->next, n++) {
+     if (net->netorder) continue;
+     keys[j].net = net;
+     keys[j].index = n;
+     switch (NetOrderMode) {
+	case ORDER_LENGTH:
+	   if (net_bbox(net, &x1, &y1, &x2, &y2))
+	      keys[j].key = -(double)((x2 - x1) + (y2 - y1));
+	   else
+	      keys[j].key = 0.0;
+	   break;
+	default:
+	   keys[j].key = (double)net->numnodes;
+	   break;
      }
+     j++;
+  }
+  if (NetOrderMode == ORDER_CONGESTION)
+     estimate_congestion(keys, j);
 
-     for (net = Nlnets; net; net = net->next) {
-	if (!net->netorder) {
-	   if (net->numnodes == max) {
-	      net->netorder = i;
-	      break;
-	   }
-        }
-     }
+  qsort(keys, j, sizeof(NETKEY), compare_netkeys);
+
+  for (n = 0; n < j; n++) {
+     net = keys[n].net;
+     net->netorder = i++;
+     if (net_routable(net))
+	NetOrderTable[NetOrderTableSize++] = net;
   }
+  free(keys);
+
 } /* create_netorder() */
 
+/*--------------------------------------------------------------*/
+/* node_index --- return the NodeTable index of "node", adding	*/
+/*	it to the table if it has none.  NULL has index 0.	*/
+/*--------------------------------------------------------------*/
+
+u_int node_index(NODE node)
+{
+   u_int oldalloc;
+
+   if (node == (NODE)NULL) return 0;
+   if (node->nodeidx != 0) return node->nodeidx;
+
+   if (NodeTableSize == NodeTableAlloc) {
+      oldalloc = NodeTableAlloc;
+      NodeTableAlloc = (oldalloc == 0) ? 1024 : (oldalloc << 1);
+      if (NodeTableAlloc > NODE_REMOVED) {
+	 fprintf(stderr, "Too many nodes for the node table.\n");
+	 exit(7);
+      }
+      NodeTable = (NODE *)mem_realloc(MEM_NODELOC, NodeTable,
+		oldalloc * sizeof(NODE), NodeTableAlloc * sizeof(NODE));
+      if (NodeTable == NULL) {
+	 fprintf(stderr, "Out of memory in node_index().\n");
+	 exit(7);
+      }
+      if (NodeTableSize == 0) NodeTable[NodeTableSize++] = (NODE)NULL;
+   }
+   node->nodeidx = NodeTableSize;
+   NodeTable[NodeTableSize++] = node;
+   return node->nodeidx;
+}
+
+/*--------------------------------------------------------------*/
+/* create_node_table --- give every node of the netlist its	*/
+/*	index in NodeTable.  Called before any node is placed	*/
+/*	on the grid, so that the table is complete, and never	*/
+/*	moves, by the time route searches read it from other	*/
+/*	threads.						*/
+/*--------------------------------------------------------------*/
+
+void create_node_table()
+{
+   GATE g;
+   NET net;
+   NODE node;
+   int i;
+
+   for (net = Nlnets; net; net = net->next)
+      for (node = net->netnodes; node; node = node->next)
+	 node_index(node);
+
+   for (g = Nlgates; g; g = g->next)
+      for (i = 0; i < g->nodes; i++)
+	 node_index(g->noderec[i]);
+}
+
+/*--------------------------------------------------------------*/
+/* index_nodelocs --- record, for each net, the grid positions	*/
+/*	at which Nodeloc holds a node of the net.  A		*/
+/*	position is stored as OGRID() plus the layer times the	*/
+/*	number of positions in a layer.  Once the obstructions	*/
+/*	have been made, Nodeloc entries are only removed, or	*/
+/*	restored from Nodesav, so the positions of the nodes	*/
+/*	of a net are always among those recorded here (except	*/
+/*	after make_routable(), see NodelocMoved).		*/
+/*								*/
+/*  ARGS: none							*/
+/*  RETURNS: nothing						*/
+/*  SIDE EFFECTS: NodelocTable and NodelocStart are filled in	*/
+/*--------------------------------------------------------------*/
+
+void index_nodelocs()
+{
+   int lay, i, n, npos, total;
+   int *next;
+   NODE node;
+
+   npos = NumChannelsX[0] * NumChannelsY[0];
+
+   // Count the positions of each net, then make the counts into
+   // starting offsets.
+
+   NodelocStart = (int *)mem_calloc(MEM_NODELOC, Numnets + 2, sizeof(int));
+   next = (int *)malloc((Numnets + 1) * sizeof(int));
+   if (!NodelocStart || !next) {
+      fprintf(stderr, "Out of memory in index_nodelocs().\n");
+      exit(7);
+   }
+   for (lay = 0; lay < Num_layers; lay++)
+      for (i = 0; i < npos; i++)
+	 if (((node = NODELOC(i % NumChannelsX[0], i / NumChannelsX[0],
+		lay)) != (NODE)NULL) && (node->netnum >= 0) &&
+		(node->netnum <= Numnets))
+	    NodelocStart[node->netnum + 1]++;
+
+   total = 0;
+   for (n = 0; n <= Numnets; n++) {
+      next[n] = total;
+      total += NodelocStart[n + 1];
+      NodelocStart[n + 1] = total;
+   }
+
+   NodelocTable = (u_int *)mem_malloc(MEM_NODELOC,
+		(total + 1) * sizeof(u_int));
+   if (!NodelocTable) {
+      fprintf(stderr, "Out of memory in index_nodelocs().\n");
+      exit(7);
+   }
+   for (lay = 0; lay < Num_layers; lay++)
+      for (i = 0; i < npos; i++)
+	 if (((node = NODELOC(i % NumChannelsX[0], i / NumChannelsX[0],
+		lay)) != (NODE)NULL) && (node->netnum >= 0) &&
+		(node->netnum <= Numnets))
+	    NodelocTable[next[node->netnum]++] = (u_int)(lay * npos + i);
+
+   free(next);
+}
+
+/*--------------------------------------------------------------*/
+/* clear_net_nodelocs --- remove the nodes of net "netnum"	*/
+/*	from Nodeloc, so that they are no longer used for	*/
+/*	crossover costing of routes.  Only the positions	*/
+/*	recorded by index_nodelocs() are visited.		*/
+/*--------------------------------------------------------------*/
+
+void clear_net_nodelocs(int netnum)
+{
+   int i, x, y, k, npos;
+   u_int pos;
+   NODE node;
+
+   if ((NodelocStart == NULL) || NodelocMoved ||
+		(netnum < 0) || (netnum > Numnets)) {
+      for (i = 0; i < Num_layers; i++) {
+	 for (x = 0; x < NumChannelsX[i]; x++) {
+	    for (y = 0; y < NumChannelsY[i]; y++) {
+	       node = NODELOC(x, y, i);
+	       if ((node != (NODE)NULL) && (node->netnum == netnum))
+		  REMOVE_NODELOC(x, y, i);
+	    }
+	 }
+      }
+      return;
+   }
+
+   npos = NumChannelsX[0] * NumChannelsY[0];
+   for (k = NodelocStart[netnum]; k < NodelocStart[netnum + 1]; k++) {
+      pos = NodelocTable[k];
+      i = pos / npos;
+      x = (pos % npos) % NumChannelsX[0];
+      y = (pos % npos) / NumChannelsX[0];
+      node = NODELOC(x, y, i);
+      if ((node != (NODE)NULL) && (node->netnum == netnum))
+	 REMOVE_NODELOC(x, y, i);
+   }
+}
+
 /*--------------------------------------------------------------*/
 /* print_nodes - show the nodes list				*/
 /*         ARGS: filename to print to
@@ -198,7 +682,7 @@ void create_obstructions_from_variable_pitch()
 	    if (x % hnum == 0) continue;
 	    for (y = 0; y < NumChannelsY[l]; y++) {
 	       if (y % vnum == 0) continue;
-	       Obs[l][OGRID(x, y, l)] = NO_NET;
+	       *OBSPTR(x, y, l) = NO_NET;
 	    }
 	 }
       }
@@ -215,12 +699,9 @@ void create_obstructions_from_variable_pitch()
 void
 disable_gridpos(int x, int y, int lay)
 {
-   int apos = OGRID(x, y, lay);
-
-   Obs[lay][apos] = (u_int)(NO_NET | OBSTRUCT_MASK);
-   Nodeloc[lay][apos] = NULL;
-   Nodesav[lay][apos] = NULL;
-   Stub[lay][apos] = 0.0;
+   *OBSPTR(x, y, lay) = (u_int)(NO_NET | OBSTRUCT_MASK);
+   SET_NODE(x, y, lay, (NODE)NULL);
+   SET_STUB(x, y, lay, 0.0);
 }
 
 /*--------------------------------------------------------------*/
@@ -239,8 +720,8 @@ check_obstruct(int gridx, int gridy, DSEG ds, double dx, double dy)
     int *obsptr;
     float dist;
 
-    obsptr = &(Obs[ds->layer][OGRID(gridx, gridy, ds->layer)]);
-    dist = Obsinfo[ds->layer][OGRID(gridx, gridy, ds->layer)];
+    obsptr = OBSPTR(gridx, gridy, ds->layer);
+    dist = OBSINFO(gridx, gridy, ds->layer);
 
     // Grid point is inside obstruction + halo.
     *obsptr |= NO_NET;
@@ -256,7 +737,7 @@ check_obstruct(int gridx, int gridy, DSEG ds, double dx, double dy)
        if (dy < ds->y1) {
 	  if ((*obsptr & (OBSTRUCT_MASK & ~OBSTRUCT_N)) == 0) {
 	     if ((dist == 0) || ((ds->y1 - dy) < dist))
-		Obsinfo[ds->layer][OGRID(gridx, gridy, ds->layer)] = ds->y1 - dy;
+		SET_OBSINFO(gridx, gridy, ds->layer, ds->y1 - dy);
 	     *obsptr |= OBSTRUCT_N;
 	  }
 	  else *obsptr |= OBSTRUCT_MASK;
@@ -264,7 +745,7 @@ check_obstruct(int gridx, int gridy, DSEG ds, double dx, double dy)
        else if (dy > ds->y2) {
 	  if ((*obsptr & (OBSTRUCT_MASK & ~OBSTRUCT_S)) == 0) {
 	     if ((dist == 0) || ((dy - ds->y2) < dist))
-		Obsinfo[ds->layer][OGRID(gridx, gridy, ds->layer)] = dy - ds->y2;
+		SET_OBSINFO(gridx, gridy, ds->layer, dy - ds->y2);
 	     *obsptr |= OBSTRUCT_S;
 	  }
 	  else *obsptr |= OBSTRUCT_MASK;
@@ -272,7 +753,7 @@ check_obstruct(int gridx, int gridy, DSEG ds, double dx, double dy)
        if (dx < ds->x1) {
 	  if ((*obsptr & (OBSTRUCT_MASK & ~OBSTRUCT_E)) == 0) {
 	     if ((dist == 0) || ((ds->x1 - dx) < dist))
-		Obsinfo[ds->layer][OGRID(gridx, gridy, ds->layer)] = ds->x1 - dx;
+		SET_OBSINFO(gridx, gridy, ds->layer, ds->x1 - dx);
              *obsptr |= OBSTRUCT_E;
 	  }
 	  else *obsptr |= OBSTRUCT_MASK;
@@ -280,7 +761,7 @@ check_obstruct(int gridx, int gridy, DSEG ds, double dx, double dy)
        else if (dx > ds->x2) {
 	  if ((*obsptr & (OBSTRUCT_MASK & ~OBSTRUCT_W)) == 0) {
 	     if ((dist == 0) || ((dx - ds->x2) < dist))
-		Obsinfo[ds->layer][OGRID(gridx, gridy, ds->layer)] = dx - ds->x2;
+		SET_OBSINFO(gridx, gridy, ds->layer, dx - ds->x2);
 	     *obsptr |= OBSTRUCT_W;
 	  }
 	  else *obsptr |= OBSTRUCT_MASK;
@@ -528,7 +1009,7 @@ void create_obstructions_from_gates()
 /*  (net terminal), which may have multiple unconnected		*/
 /*  positions.							*/
 /*								*/
-/*  Also fills in the Nodeloc[] grid with the node number,	*/
+/*  Also fills in the Nodeidx[] grid with the node number,	*/
 /*  which causes the router to put a premium on			*/
 /*  routing other nets over or under this position, to		*/
 /*  discourage boxing in a pin position and making it 		*/
@@ -604,8 +1085,8 @@ void create_obstructions_from_nodes()
 			 // Area inside defined pin geometry
 
 			 if (dy > ds->y1 && gridy >= 0) {
-			     int orignet = Obs[ds->layer][OGRID(gridx,
-					gridy, ds->layer)];
+			     int orignet = OBSVAL(gridx,
+					gridy, ds->layer);
 
 			     if ((orignet & ~PINOBSTRUCTMASK) == (u_int)node->netnum) {
 
@@ -702,14 +1183,10 @@ void create_obstructions_from_nodes()
 				   }
 				}
 
-			        Obs[ds->layer][OGRID(gridx, gridy, ds->layer)]
+			        *OBSPTR(gridx, gridy, ds->layer)
 					= (u_int)node->netnum | dir;
-			        Nodeloc[ds->layer][OGRID(gridx, gridy, ds->layer)]
-					= node;
-			        Nodesav[ds->layer][OGRID(gridx, gridy, ds->layer)]
-					= node;
-			        Stub[ds->layer][OGRID(gridx, gridy, ds->layer)]
-					= dist;
+			        SET_NODE(gridx, gridy, ds->layer, node);
+			        SET_STUB(gridx, gridy, ds->layer, dist);
 
 			     }
 			     else if ((orignet & NO_NET) && ((orignet & OBSTRUCT_MASK)
@@ -737,53 +1214,46 @@ void create_obstructions_from_nodes()
 				// obstruction to resolve the DRC error.
 
 				// Make sure we have marked this as a node.
-			        Nodeloc[ds->layer][OGRID(gridx, gridy, ds->layer)]
-					= node;
-			        Nodesav[ds->layer][OGRID(gridx, gridy, ds->layer)]
-					= node;
-			        Obs[ds->layer][OGRID(gridx, gridy, ds->layer)]
+			        SET_NODE(gridx, gridy, ds->layer, node);
+			        *OBSPTR(gridx, gridy, ds->layer)
 					= (u_int)node->netnum;
 
 				if (orignet & OBSTRUCT_N) {
-			           offd = -(sdisty - Obsinfo[ds->layer]
-					[OGRID(gridx, gridy, ds->layer)]);
+			           offd = -(sdisty -
+						   OBSINFO(gridx, gridy, ds->layer));
 				   if (offd >= -offmaxy[ds->layer]) {
-			              Stub[ds->layer][OGRID(gridx, gridy, ds->layer)]
-						= offd;
-			              Obs[ds->layer][OGRID(gridx, gridy, ds->layer)]
+			              SET_STUB(gridx, gridy, ds->layer, offd);
+			              *OBSPTR(gridx, gridy, ds->layer)
 						|= (STUBROUTE_NS | OFFSET_TAP);
 				   }
 				   else maxerr = 1;
 				}
 				else if (orignet & OBSTRUCT_S) {
-				   offd = sdisty - Obsinfo[ds->layer]
-					[OGRID(gridx, gridy, ds->layer)];
+				   offd = sdisty -
+						   OBSINFO(gridx, gridy, ds->layer);
 				   if (offd <= offmaxy[ds->layer]) {
-			              Stub[ds->layer][OGRID(gridx, gridy, ds->layer)]
-						= offd;
-			              Obs[ds->layer][OGRID(gridx, gridy, ds->layer)]
+			              SET_STUB(gridx, gridy, ds->layer, offd);
+			              *OBSPTR(gridx, gridy, ds->layer)
 						|= (STUBROUTE_NS | OFFSET_TAP);
 				   }
 				   else maxerr = 1;
 				}
 				else if (orignet & OBSTRUCT_E) {
-				   offd = -(sdistx - Obsinfo[ds->layer]
-					[OGRID(gridx, gridy, ds->layer)]);
+				   offd = -(sdistx -
+						   OBSINFO(gridx, gridy, ds->layer));
 				   if (offd >= -offmaxx[ds->layer]) {
-			              Stub[ds->layer][OGRID(gridx, gridy, ds->layer)]
-						= offd;
-			              Obs[ds->layer][OGRID(gridx, gridy, ds->layer)]
+			              SET_STUB(gridx, gridy, ds->layer, offd);
+			              *OBSPTR(gridx, gridy, ds->layer)
 						|= (STUBROUTE_EW | OFFSET_TAP);
 				   }
 				   else maxerr = 1;
 				}
 				else if (orignet & OBSTRUCT_W) {
-				   offd = sdistx - Obsinfo[ds->layer]
-					[OGRID(gridx, gridy, ds->layer)];
+				   offd = sdistx -
+						   OBSINFO(gridx, gridy, ds->layer);
 				   if (offd <= offmaxx[ds->layer]) {
-			              Stub[ds->layer][OGRID(gridx, gridy, ds->layer)]
-						= offd;
-			              Obs[ds->layer][OGRID(gridx, gridy, ds->layer)]
+			              SET_STUB(gridx, gridy, ds->layer, offd);
+			              *OBSPTR(gridx, gridy, ds->layer)
 						|= (STUBROUTE_EW | OFFSET_TAP);
 				   }
 				   else maxerr = 1;
@@ -802,18 +1272,15 @@ void create_obstructions_from_nodes()
 			     // Check that we have not created a PINOBSTRUCT
 			     // route directly over this point.
 			     if (ds->layer < Num_layers - 1) {
-			        k = Obs[ds->layer + 1][OGRID(gridx, gridy,
-					ds->layer + 1)];
+			        k = OBSVAL(gridx, gridy,
+					ds->layer + 1);
 			        if (k & PINOBSTRUCTMASK) {
 			           if ((k & ~PINOBSTRUCTMASK) != (u_int)node->netnum) {
-				       Obs[ds->layer + 1][OGRID(gridx, gridy,
-						ds->layer + 1)] = NO_NET;
-				       Nodeloc[ds->layer + 1][OGRID(gridx, gridy,
-						ds->layer + 1)] = (NODE)NULL;
-				       Nodesav[ds->layer + 1][OGRID(gridx, gridy,
-						ds->layer + 1)] = (NODE)NULL;
-				       Stub[ds->layer + 1][OGRID(gridx, gridy,
-						ds->layer + 1)] = (float)0.0;
+				       *OBSPTR(gridx, gridy,
+						ds->layer + 1) = NO_NET;
+				       SET_NODE(gridx, gridy, ds->layer + 1, (NODE)NULL);
+				       SET_STUB(gridx, gridy, ds->layer + 1,
+						       (float)0.0);
 				   }
 				}
 			     }
@@ -866,15 +1333,14 @@ void create_obstructions_from_nodes()
 
 			    n2 = NULL;
 			    if (ds->layer > 0)
-			       n2 = Nodeloc[ds->layer - 1][OGRID(gridx, gridy,
-					ds->layer - 1)];
+			       n2 = NODELOC(gridx, gridy, ds->layer - 1);
 			    if (n2 == NULL)
-			       n2 = Nodeloc[ds->layer][OGRID(gridx, gridy, ds->layer)];
+			       n2 = NODELOC(gridx, gridy, ds->layer);
 
 			    // Ignore my own node.
 			    if (n2 == node) n2 = NULL;
 
-			    k = Obs[ds->layer][OGRID(gridx, gridy, ds->layer)];
+			    k = OBSVAL(gridx, gridy, ds->layer);
 
 			    // In case of a port that is inaccessible from a grid
 			    // point, or not completely overlapping it, the
@@ -888,8 +1354,8 @@ void create_obstructions_from_nodes()
 					(n2 == NULL)) {
 
 				if ((k & OBSTRUCT_MASK) != 0) {
-				   float sdist = Obsinfo[ds->layer][OGRID(gridx,
-						gridy, ds->layer)];
+				   float sdist =
+						   OBSINFO(gridx, gridy, ds->layer);
 
 				   // If the point is marked as close to an
 				   // obstruction, we can declare this an
@@ -1048,21 +1514,17 @@ void create_obstructions_from_nodes()
 				   }
 
 				if ((k < Numnets) && (dir != STUBROUTE_X)) {
-				   Obs[ds->layer][OGRID(gridx, gridy, ds->layer)]
+				   *OBSPTR(gridx, gridy, ds->layer)
 					= (u_int)g->netnum[i] | dir; 
-				   Nodeloc[ds->layer][OGRID(gridx, gridy, ds->layer)]
-					= node;
-				   Nodesav[ds->layer][OGRID(gridx, gridy, ds->layer)]
-					= node;
+				   SET_NODE(gridx, gridy, ds->layer, node);
 				}
 				else {
 				   // Keep showing an obstruction, but add the
 				   // direction info and log the stub distance.
-				   Obs[ds->layer][OGRID(gridx, gridy, ds->layer)]
+				   *OBSPTR(gridx, gridy, ds->layer)
 					|= dir;
 				}
-				Stub[ds->layer][OGRID(gridx, gridy, ds->layer)]
-					= dist;
+				SET_STUB(gridx, gridy, ds->layer, dist);
 			    }
 			    else {
 			       int othernet = (k & ~PINOBSTRUCTMASK);
@@ -1090,21 +1552,19 @@ void create_obstructions_from_nodes()
 				  xdist = 0.5 * LefGetViaWidth(ds->layer, ds->layer, 0);
 				  if ((dy + xdist + LefGetRouteSpacing(ds->layer) >
 					ds->y1) && (dy + xdist < ds->y1)) {
-				     if (Stub[ds->layer][OGRID(gridx, gridy,
-						ds->layer)] == 0.0) {
-					Stub[ds->layer][OGRID(gridx, gridy,
-						ds->layer)] = ds->y1 - dy;
-					Obs[ds->layer][OGRID(gridx, gridy, ds->layer)]
+				     if (STUB(gridx, gridy, ds->layer) == 0.0) {
+					SET_STUB(gridx, gridy, ds->layer,
+							ds->y1 - dy);
+					*OBSPTR(gridx, gridy, ds->layer)
 						|= STUBROUTE_NS;
 				     }
 				  }
 				  if ((dy - xdist - LefGetRouteSpacing(ds->layer) <
 					ds->y2) && (dy - xdist > ds->y2)) {
-				     if (Stub[ds->layer][OGRID(gridx, gridy,
-						ds->layer)] == 0.0) {
-					Stub[ds->layer][OGRID(gridx, gridy,
-						ds->layer)] = ds->y2 - dy;
-					Obs[ds->layer][OGRID(gridx, gridy, ds->layer)]
+				     if (STUB(gridx, gridy, ds->layer) == 0.0) {
+					SET_STUB(gridx, gridy, ds->layer,
+							ds->y2 - dy);
+					*OBSPTR(gridx, gridy, ds->layer)
 						|= STUBROUTE_NS;
 				     }
 				  }
@@ -1112,21 +1572,19 @@ void create_obstructions_from_nodes()
 				  xdist = 0.5 * LefGetViaWidth(ds->layer, ds->layer, 1);
 				  if ((dx + xdist + LefGetRouteSpacing(ds->layer) >
 					ds->x1) && (dx + xdist < ds->x1)) {
-				     if (Stub[ds->layer][OGRID(gridx, gridy,
-						ds->layer)] == 0.0) {
-					Stub[ds->layer][OGRID(gridx, gridy,
-						ds->layer)] = ds->x1 - dx;
-					Obs[ds->layer][OGRID(gridx, gridy, ds->layer)]
+				     if (STUB(gridx, gridy, ds->layer) == 0.0) {
+					SET_STUB(gridx, gridy, ds->layer,
+							ds->x1 - dx);
+					*OBSPTR(gridx, gridy, ds->layer)
 						|= STUBROUTE_EW;
 				     }
 				  }
 				  if ((dx - xdist - LefGetRouteSpacing(ds->layer) <
 					ds->x2) && (dx - xdist > ds->x2)) {
-				     if (Stub[ds->layer][OGRID(gridx, gridy,
-						ds->layer)] == 0.0) {
-					Stub[ds->layer][OGRID(gridx, gridy,
-						ds->layer)] = ds->x2 - dx;
-					Obs[ds->layer][OGRID(gridx, gridy, ds->layer)]
+				     if (STUB(gridx, gridy, ds->layer) == 0.0) {
+					SET_STUB(gridx, gridy, ds->layer,
+							ds->x2 - dx);
+					*OBSPTR(gridx, gridy, ds->layer)
 						|= STUBROUTE_EW;
 				     }
 				  }
@@ -1149,32 +1607,24 @@ void create_obstructions_from_nodes()
 					ds->y1) && (dy + xdist < ds->y1)) {
 				     if ((dx - xdist < ds->x2) &&
 						(dx + xdist > ds->x1) &&
-						(Stub[ds->layer][OGRID(gridx, gridy,
-						ds->layer)] == 0.0)) {
-					Stub[ds->layer][OGRID(gridx, gridy,
-						ds->layer)] = ds->y1 - dy;
-					Obs[ds->layer][OGRID(gridx, gridy, ds->layer)]
+						(STUB(gridx, gridy, ds->layer) == 0.0)) {
+					SET_STUB(gridx, gridy, ds->layer,
+							ds->y1 - dy);
+					*OBSPTR(gridx, gridy, ds->layer)
 						= node->netnum | STUBROUTE_NS;
-					Nodeloc[ds->layer][OGRID(gridx, gridy,
-						ds->layer)] = node;
-					Nodesav[ds->layer][OGRID(gridx, gridy,
-						ds->layer)] = node;
+					SET_NODE(gridx, gridy, ds->layer, node);
 				     }
 				  }
 				  if ((dy - xdist - LefGetRouteSpacing(ds->layer) <
 					ds->y2) && (dy - xdist > ds->y2)) {
 				     if ((dx - xdist < ds->x2) &&
 						(dx + xdist > ds->x1) &&
-						(Stub[ds->layer][OGRID(gridx, gridy,
-						ds->layer)] == 0.0)) {
-					Stub[ds->layer][OGRID(gridx, gridy,
-						ds->layer)] = ds->y2 - dy;
-					Obs[ds->layer][OGRID(gridx, gridy, ds->layer)]
+						(STUB(gridx, gridy, ds->layer) == 0.0)) {
+					SET_STUB(gridx, gridy, ds->layer,
+							ds->y2 - dy);
+					*OBSPTR(gridx, gridy, ds->layer)
 						= node->netnum | STUBROUTE_NS;
-					Nodeloc[ds->layer][OGRID(gridx, gridy,
-						ds->layer)] = node;
-					Nodesav[ds->layer][OGRID(gridx, gridy,
-						ds->layer)] = node;
+					SET_NODE(gridx, gridy, ds->layer, node);
 				     }
 				  }
 
@@ -1183,32 +1633,24 @@ void create_obstructions_from_nodes()
 					ds->x1) && (dx + xdist < ds->x1)) {
 				     if ((dy - xdist < ds->y2) &&
 						(dy + xdist > ds->y1) &&
-						(Stub[ds->layer][OGRID(gridx, gridy,
-						ds->layer)] == 0.0)) {
-					Stub[ds->layer][OGRID(gridx, gridy,
-						ds->layer)] = ds->x1 - dx;
-					Obs[ds->layer][OGRID(gridx, gridy, ds->layer)]
+						(STUB(gridx, gridy, ds->layer) == 0.0)) {
+					SET_STUB(gridx, gridy, ds->layer,
+							ds->x1 - dx);
+					*OBSPTR(gridx, gridy, ds->layer)
 						= node->netnum | STUBROUTE_EW;
-					Nodeloc[ds->layer][OGRID(gridx, gridy,
-						ds->layer)] = node;
-					Nodesav[ds->layer][OGRID(gridx, gridy,
-						ds->layer)] = node;
+					SET_NODE(gridx, gridy, ds->layer, node);
 				     }
 				  }
 				  if ((dx - xdist - LefGetRouteSpacing(ds->layer) <
 					ds->x2) && (dx - xdist > ds->x2)) {
 				     if ((dy - xdist < ds->y2) &&
 						(dy + xdist > ds->y1) &&
-						(Stub[ds->layer][OGRID(gridx, gridy,
-						ds->layer)] == 0.0)) {
-					Stub[ds->layer][OGRID(gridx, gridy,
-						ds->layer)] = ds->x2 - dx;
-					Obs[ds->layer][OGRID(gridx, gridy, ds->layer)]
+						(STUB(gridx, gridy, ds->layer) == 0.0)) {
+					SET_STUB(gridx, gridy, ds->layer,
+							ds->x2 - dx);
+					*OBSPTR(gridx, gridy, ds->layer)
 						= node->netnum | STUBROUTE_EW;
-					Nodeloc[ds->layer][OGRID(gridx, gridy,
-						ds->layer)] = node;
-					Nodesav[ds->layer][OGRID(gridx, gridy,
-						ds->layer)] = node;
+					SET_NODE(gridx, gridy, ds->layer, node);
 				     }
 				  }
 			       }
@@ -1286,7 +1728,7 @@ void tap_to_tap_interactions()
 		      /* Is there an offset tap at this position, and	*/
 		      /* does it belong to a net that is != net?	*/
 
-		      orignet = Obs[ds->layer][OGRID(gridx, gridy, ds->layer)];
+		      orignet = OBSVAL(gridx, gridy, ds->layer);
 		      if (orignet & OFFSET_TAP) {
 			 offset = orignet & PINOBSTRUCTMASK;
 			 orignet &= ~PINOBSTRUCTMASK;
@@ -1295,7 +1737,7 @@ void tap_to_tap_interactions()
 		            dx = (gridx * PitchX[ds->layer]) + Xlowerbound;
 		            dy = (gridy * PitchY[ds->layer]) + Ylowerbound;
 
-			    dist = Stub[ds->layer][OGRID(gridx, gridy, ds->layer)];
+			    dist = STUB(gridx, gridy, ds->layer);
 
 			    /* "de" is the bounding box of a via placed	  */
 			    /* at (gridx, gridy) and offset as specified. */
@@ -1373,16 +1815,14 @@ make_routable(NODE node)
 			 // Area inside defined pin geometry
 
 			 if (dy > ds->y1 && gridy >= 0) {
-			    int orignet = Obs[ds->layer][OGRID(gridx,
-					gridy, ds->layer)];
+			    int orignet = OBSVAL(gridx,
+					gridy, ds->layer);
 
 			    if (orignet & NO_NET) {
-				Obs[ds->layer][OGRID(gridx, gridy, ds->layer)] =
+				*OBSPTR(gridx, gridy, ds->layer) =
 					g->netnum[i];
-				Nodeloc[ds->layer][OGRID(gridx, gridy, ds->layer)] =
-					node;
-				Nodesav[ds->layer][OGRID(gridx, gridy, ds->layer)] =
-					node;
+				SET_NODE(gridx, gridy, ds->layer, node);
+				if (NodelocStart != NULL) NodelocMoved = TRUE;
 				return;
 			    }
 			 }
@@ -1464,7 +1904,7 @@ void adjust_stub_lengths()
 				gridy >= NumChannelsY[ds->layer]) break;
 		         if (dy >= (ds->y1 - PitchY[ds->layer]) && gridy >= 0) {
 
-			     orignet = Obs[ds->layer][OGRID(gridx, gridy, ds->layer)];
+			     orignet = OBSVAL(gridx, gridy, ds->layer);
 
 			     // Ignore this location if it is assigned to another
 			     // net, or is assigned to NO_NET.
@@ -1488,7 +1928,7 @@ void adjust_stub_lengths()
 			     dt.y1 = dy - w;
 			     dt.y2 = dy + w;
 
-			     dist = Stub[ds->layer][OGRID(gridx, gridy, ds->layer)];
+			     dist = STUB(gridx, gridy, ds->layer);
 
 			     // adjust the route box according to the stub
 			     // or offset geometry
@@ -1619,108 +2059,108 @@ void adjust_stub_lengths()
 
 				if (de.x2 > dt.x2) {
 				   if ((orignet & PINOBSTRUCTMASK) == 0) {
-			              Obs[ds->layer][OGRID(gridx, gridy, ds->layer)]
+			              *OBSPTR(gridx, gridy, ds->layer)
 						|= STUBROUTE_EW;
-			              Stub[ds->layer][OGRID(gridx, gridy, ds->layer)]
-						= de.x2 - dx;
+			              SET_STUB(gridx, gridy, ds->layer,
+						      de.x2 - dx);
 				      errbox = FALSE;
 				   }
 				   else if ((orignet & PINOBSTRUCTMASK) == STUBROUTE_EW
 						&& (dist > 0)) {
-			              Stub[ds->layer][OGRID(gridx, gridy, ds->layer)]
-						= de.x2 - dx;
+			              SET_STUB(gridx, gridy, ds->layer,
+						      de.x2 - dx);
 				      errbox = FALSE;
 				   }
 				   else if ((orignet & PINOBSTRUCTMASK) ==
 						STUBROUTE_NS) {
-			              Obs[ds->layer][OGRID(gridx, gridy, ds->layer)]
+			              *OBSPTR(gridx, gridy, ds->layer)
 						&= ~STUBROUTE_NS;
-			              Obs[ds->layer][OGRID(gridx, gridy, ds->layer)]
+			              *OBSPTR(gridx, gridy, ds->layer)
 						|= STUBROUTE_EW;
-			              Stub[ds->layer][OGRID(gridx, gridy, ds->layer)]
-						= de.x2 - dx;
+			              SET_STUB(gridx, gridy, ds->layer,
+						      de.x2 - dx);
 				      errbox = FALSE;
 				   }
 				}
 				else if (de.x1 < dt.x1) {
 				   if ((orignet & PINOBSTRUCTMASK) == 0) {
-			              Obs[ds->layer][OGRID(gridx, gridy, ds->layer)]
+			              *OBSPTR(gridx, gridy, ds->layer)
 						|= STUBROUTE_EW;
-			              Stub[ds->layer][OGRID(gridx, gridy, ds->layer)]
-						= de.x1 - dx;
+			              SET_STUB(gridx, gridy, ds->layer,
+						      de.x1 - dx);
 				      errbox = FALSE;
 				   }
 				   else if ((orignet & PINOBSTRUCTMASK) == STUBROUTE_EW
 						&& (dist < 0)) {
-			              Stub[ds->layer][OGRID(gridx, gridy, ds->layer)]
-						= de.x1 - dx;
+			              SET_STUB(gridx, gridy, ds->layer,
+						      de.x1 - dx);
 				      errbox = FALSE;
 				   }
 				   else if ((orignet & PINOBSTRUCTMASK) ==
 						STUBROUTE_NS) {
-			              Obs[ds->layer][OGRID(gridx, gridy, ds->layer)]
+			              *OBSPTR(gridx, gridy, ds->layer)
 						&= ~STUBROUTE_NS;
-			              Obs[ds->layer][OGRID(gridx, gridy, ds->layer)]
+			              *OBSPTR(gridx, gridy, ds->layer)
 						|= STUBROUTE_EW;
-			              Stub[ds->layer][OGRID(gridx, gridy, ds->layer)]
-						= de.x1 - dx;
+			              SET_STUB(gridx, gridy, ds->layer,
+						      de.x1 - dx);
 				      errbox = FALSE;
 				   }
 				}
 				else if (de.y2 > dt.y2) {
 				   if ((orignet & PINOBSTRUCTMASK) == 0) {
-			              Obs[ds->layer][OGRID(gridx, gridy, ds->layer)]
+			              *OBSPTR(gridx, gridy, ds->layer)
 						|= STUBROUTE_NS;
-			              Stub[ds->layer][OGRID(gridx, gridy, ds->layer)]
-						= de.y2 - dy;
+			              SET_STUB(gridx, gridy, ds->layer,
+						      de.y2 - dy);
 				      errbox = FALSE;
 				   }
 				   else if ((orignet & PINOBSTRUCTMASK) == STUBROUTE_NS
 						&& (dist > 0)) {
-			              Stub[ds->layer][OGRID(gridx, gridy, ds->layer)]
-						= de.y2 - dy;
+			              SET_STUB(gridx, gridy, ds->layer,
+						      de.y2 - dy);
 				      errbox = FALSE;
 				   }
 				   else if ((orignet & PINOBSTRUCTMASK) ==
 						STUBROUTE_EW) {
-			              Obs[ds->layer][OGRID(gridx, gridy, ds->layer)]
+			              *OBSPTR(gridx, gridy, ds->layer)
 						&= ~STUBROUTE_EW;
-			              Obs[ds->layer][OGRID(gridx, gridy, ds->layer)]
+			              *OBSPTR(gridx, gridy, ds->layer)
 						|= STUBROUTE_NS;
-			              Stub[ds->layer][OGRID(gridx, gridy, ds->layer)]
-						= de.y2 - dy;
+			              SET_STUB(gridx, gridy, ds->layer,
+						      de.y2 - dy);
 				      errbox = FALSE;
 				   }
 				}
 				else if (de.y1 < dt.y1) {
 				   if ((orignet & PINOBSTRUCTMASK) == 0) {
-			              Obs[ds->layer][OGRID(gridx, gridy, ds->layer)]
+			              *OBSPTR(gridx, gridy, ds->layer)
 						|= STUBROUTE_NS;
-			              Stub[ds->layer][OGRID(gridx, gridy, ds->layer)]
-						= de.y1 - dy;
+			              SET_STUB(gridx, gridy, ds->layer,
+						      de.y1 - dy);
 				      errbox = FALSE;
 				   }
 				   else if ((orignet & PINOBSTRUCTMASK) == STUBROUTE_NS
 						&& (dist < 0)) {
-			              Stub[ds->layer][OGRID(gridx, gridy, ds->layer)]
-						= de.y1 - dy;
+			              SET_STUB(gridx, gridy, ds->layer,
+						      de.y1 - dy);
 				      errbox = FALSE;
 				   }
 				   else if ((orignet & PINOBSTRUCTMASK) ==
 						STUBROUTE_EW) {
-			              Obs[ds->layer][OGRID(gridx, gridy, ds->layer)]
+			              *OBSPTR(gridx, gridy, ds->layer)
 						&= ~STUBROUTE_EW;
-			              Obs[ds->layer][OGRID(gridx, gridy, ds->layer)]
+			              *OBSPTR(gridx, gridy, ds->layer)
 						|= STUBROUTE_NS;
-			              Stub[ds->layer][OGRID(gridx, gridy, ds->layer)]
-						= de.y1 - dy;
+			              SET_STUB(gridx, gridy, ds->layer,
+						      de.y1 - dy);
 				      errbox = FALSE;
 				   }
 				}
 
 				if (errbox == TRUE) {
 				   // Unroutable position, so mark it unroutable
-			           Obs[ds->layer][OGRID(gridx, gridy, ds->layer)]
+			           *OBSPTR(gridx, gridy, ds->layer)
 					|= STUBROUTE_X;
 				}
 			     }
@@ -1774,26 +2214,26 @@ block_route(int x, int y, int lay, u_char dir)
 	 break;
    }
    
-   ob = Obs[lay][OGRID(bx, by, lay)];
+   ob = OBSVAL(bx, by, lay);
 
    if ((ob & NO_NET) != 0) return;
 
    switch (dir) {
       case NORTH:
-	 Obs[lay][OGRID(bx, by, lay)] |= BLOCKED_S;
-	 Obs[lay][OGRID(x, y, lay)] |= BLOCKED_N;
+	 *OBSPTR(bx, by, lay) |= BLOCKED_S;
+	 *OBSPTR(x, y, lay) |= BLOCKED_N;
 	 break;
       case SOUTH:
-	 Obs[lay][OGRID(bx, by, lay)] |= BLOCKED_N;
-	 Obs[lay][OGRID(x, y, lay)] |= BLOCKED_S;
+	 *OBSPTR(bx, by, lay) |= BLOCKED_N;
+	 *OBSPTR(x, y, lay) |= BLOCKED_S;
 	 break;
       case EAST:
-	 Obs[lay][OGRID(bx, by, lay)] |= BLOCKED_W;
-	 Obs[lay][OGRID(x, y, lay)] |= BLOCKED_E;
+	 *OBSPTR(bx, by, lay) |= BLOCKED_W;
+	 *OBSPTR(x, y, lay) |= BLOCKED_E;
 	 break;
       case WEST:
-	 Obs[lay][OGRID(bx, by, lay)] |= BLOCKED_E;
-	 Obs[lay][OGRID(x, y, lay)] |= BLOCKED_W;
+	 *OBSPTR(bx, by, lay) |= BLOCKED_E;
+	 *OBSPTR(x, y, lay) |= BLOCKED_W;
 	 break;
    }
 }
@@ -1859,7 +2299,7 @@ find_route_blocks()
 		     gridy++;
 		  }
 		  while (dy < ds->y2 + s) {
-		     u = ((Obs[ds->layer][OGRID(gridx, gridy, ds->layer)] &
+		     u = ((OBSVAL(gridx, gridy, ds->layer) &
 				PINOBSTRUCTMASK) == STUBROUTE_EW) ? v : w;
 		     if (dy + EPS < ds->y2 - u)
 			block_route(gridx, gridy, ds->layer, NORTH);
@@ -1892,7 +2332,7 @@ find_route_blocks()
 		     gridy++;
 		  }
 		  while (dy < ds->y2 + s) {
-		     u = ((Obs[ds->layer][OGRID(gridx, gridy, ds->layer)] &
+		     u = ((OBSVAL(gridx, gridy, ds->layer) &
 				PINOBSTRUCTMASK) == STUBROUTE_EW) ? v : w;
 		     if (dy + EPS < ds->y2 - u)
 			block_route(gridx, gridy, ds->layer, NORTH);
@@ -1925,7 +2365,7 @@ find_route_blocks()
 		     gridx++;
 		  }
 		  while (dx < ds->x2 + s) {
-		     u = ((Obs[ds->layer][OGRID(gridx, gridy, ds->layer)] &
+		     u = ((OBSVAL(gridx, gridy, ds->layer) &
 				PINOBSTRUCTMASK) == STUBROUTE_NS) ? v : w;
 		     if (dx + EPS < ds->x2 - u)
 			block_route(gridx, gridy, ds->layer, EAST);
@@ -1958,7 +2398,7 @@ find_route_blocks()
 		     gridx++;
 		  }
 		  while (dx < ds->x2 + s) {
-		     u = ((Obs[ds->layer][OGRID(gridx, gridy, ds->layer)] &
+		     u = ((OBSVAL(gridx, gridy, ds->layer) &
 				PINOBSTRUCTMASK) == STUBROUTE_NS) ? v : w;
 		     if (dx + EPS < ds->x2 - u)
 			block_route(gridx, gridy, ds->layer, EAST);
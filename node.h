@@ -11,7 +11,64 @@
 #define VDD_NET		 2
 #define MIN_NET_NUMBER   3
 
+extern NODE *NodeTable;		// all nodes placed on the grid, by index;
+				// NodeTable[0] is NULL
+extern NET *NetOrderTable;	// routing queue:  routable nets in order
+extern int NetOrderTableSize;	// number of nets in NetOrderTable
+extern u_int *NodelocTable;	// Nodeloc positions of each net, in turn
+extern int *NodelocStart;	// start of each net's positions in
+				// NodelocTable, by net number
+extern float *Congestion[MAX_LAYERS];	// estimated use of the free tracks
+					// of each tile, by layer
+extern int CongTilesX, CongTilesY;	// tiles of the congestion map
+
+#define ORDER_TILE	8	// size, in grid positions, of the tiles
+				// used to estimate congestion
+#define MAX_CONGESTION	10.0	// congestion of a tile with no free tracks
+
+// Cost of stepping onto a grid position, from the congestion map.
+// "Route Congestion Cost" is charged per tile crossed, so each of the
+// ORDER_TILE steps across a tile pays its share.
+
+#define CONGESTION_COST(x, y, layer) ((int)(CongestionCost * \
+		Congestion[layer][((y) / ORDER_TILE) * CongTilesX + \
+		(x) / ORDER_TILE] / ORDER_TILE + 0.5))
+
+// Nodes attached to grid points.  Each position of Nodeidx[] holds
+// the NodeTable index of its node, or 0.  Two views are kept in the
+// one array:  Nodesav, the node placed there, and Nodeloc, the same
+// node unless it has been removed by clear_net_nodelocs() so that
+// routes are no longer charged for crossing it.  A removed position
+// has NODE_REMOVED set, and is restored when its net is ripped up.
+// Four bytes per position, where two pointer arrays took sixteen,
+// and only in the pages of the grid holding nodes (see grid.h).
+
+#define NODE_REMOVED	((u_int)0x80000000)
+
+#define NODESAV(x, y, layer) (NodeTable[PGRID_GET(Nodeidx[layer], x, y) & \
+		~NODE_REMOVED])
+#define NODELOC(x, y, layer) (NodeTable[(PGRID_GET(Nodeidx[layer], x, y) & \
+		NODE_REMOVED) ? 0 : PGRID_GET(Nodeidx[layer], x, y)])
+
+// Attach "node" (which may be NULL) to a position, in both views
+#define SET_NODE(x, y, layer, node) \
+		(*PGRID_PTR(Nodeidx[layer], x, y) = node_index(node))
+
+#define REMOVE_NODELOC(x, y, layer) ((PGRID_GET(Nodeidx[layer], x, y) != 0) \
+		? (*PGRID_PTR(Nodeidx[layer], x, y) |= NODE_REMOVED) : 0)
+#define RESTORE_NODELOC(x, y, layer) \
+		((PGRID_GET(Nodeidx[layer], x, y) & NODE_REMOVED) \
+		? (*PGRID_PTR(Nodeidx[layer], x, y) &= ~NODE_REMOVED) : 0)
+
+u_int node_index( NODE node );
+void create_node_table( void );
 void create_netorder( void );
+void congestion_map( void );
+void write_congestion_map( char *prefix );
+int net_bbox( NET net, int *x1, int *y1, int *x2, int *y2 );
+int net_routable( NET net );
+void index_nodelocs( void );
+void clear_net_nodelocs( int netnum );
 void create_netlist( void );
 void print_nodes( char *filename );
 void print_nlnets( char *filename );
@@ -0,0 +1,867 @@
+/*--------------------------------------------------------------*/
+/* parallel.c -- first routing stage on several threads		*/
+/*								*/
+/* With "threads N" in the configuration file, the first stage	*/
+/* routes nets in batches, each net of a batch routed by one of	*/
+/* N worker threads with its own ROUTECTX.  When all nets of	*/
+/* the batch are done, they are taken in queue order, and the	*/
+/* messages of each search are copied to stdout.  Power and	*/
+/* ground nets are always routed serially.			*/
+/*								*/
+/* "parallel mode regions" (the default):  each net is given a	*/
+/* region, the extent of its taps widened by "route halo" grid	*/
+/* positions.  A net joins the batch if its region is clear of	*/
+/* the regions of all nets already in the batch, and of all	*/
+/* nets passed over for it.  Its search may not leave its	*/
+/* region, so that each region acts as a lock on its part of	*/
+/* Obs[] and Nodeidx[], held by one net until the batch ends.	*/
+/* A net that could not be routed within its region is routed	*/
+/* again without bounds, serially.  Nets whose regions are	*/
+/* close are always routed in queue order, so the routes	*/
+/* depend only on the queue and the number of threads.		*/
+/*								*/
+/* "parallel mode speculative":  the batch is simply the next	*/
+/* nets of the queue.  Each worker has its own copy of Obs[]	*/
+/* (Obs[] is per thread) holding the grid as it was before the	*/
+/* batch, and routes its net there without bounds.  The		*/
+/* positions written are saved, and the copy restored.  The	*/
+/* route of a net is then kept only if no net before it in the	*/
+/* batch wrote within the extent that its search read, so that	*/
+/* the search would have run the same way on the real grid.	*/
+/* Any other net is routed again on the real grid.  The routes	*/
+/* are thus exactly those of a single thread.			*/
+/*								*/
+/* The same workers route the nets of each pass of negotiated	*/
+/* routing (see negotiate.c), and batches of failed nets in the	*/
+/* rip-up and reroute stage (see dosecondstage()), through	*/
+/* route_nets().						*/
+/*--------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "qrouter.h"
+#include "config.h"
+#include "node.h"
+#include "maze.h"
+#include "parallel.h"
+#include "grid.h"
+#include "mem.h"
+
+extern int TotalRoutes;
+
+// One net of a batch
+
+typedef struct routetask_ ROUTETASK;
+
+struct routetask_ {
+   NET    net;
+   int    index;		// position of the net in NetOrderTable
+   u_char stage;		// stage passed to doroute()
+   u_char speculative;		// routed on a copy of Obs, to be committed
+   struct seg_ region;		// area the search may use
+   int    result;		// return value of doroute()
+   int    routes;		// routes made
+   char   *msgs;		// messages from the search
+   size_t msgsize;
+
+   // Speculative mode only
+   ROUTE  last;			// last route of the net before the search
+   struct seg_ read;		// extent of positions read by the search
+   struct seg_ written;		// extent of the routes and taps of the net
+   struct seg_ changed;		// "written" with margin:  all positions
+				// of Obs[] the search may have changed
+   u_int  *patch;		// Obs[] over "changed", after the search
+};
+
+// One worker thread, with the Obs[] it routes on
+
+typedef struct routeworker_ ROUTEWORKER;
+
+struct routeworker_ {
+   ROUTECTX  ctx;
+   PGRID     obs[MAX_LAYERS];
+   pthread_t thread;
+};
+
+// Batch of tasks shared with the worker threads, under PoolLock
+
+pthread_mutex_t PoolLock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t  PoolStart = PTHREAD_COND_INITIALIZER;	// tasks posted
+pthread_cond_t  PoolDone = PTHREAD_COND_INITIALIZER;	// all tasks done
+ROUTETASK *PoolTasks = NULL;
+int	PoolNumTasks = 0;	// tasks in the current batch
+int	PoolNextTask = 0;	// next task to be taken by a worker
+int	PoolFinished = 0;	// tasks completed
+u_char	PoolQuit = FALSE;	// set to make the workers exit
+
+ROUTEWORKER *Workers = NULL;	// running worker threads
+int	NumWorkers = 0;
+PGRID	SharedObs[MAX_LAYERS];	// Obs[] of the main thread
+
+/*--------------------------------------------------------------*/
+/* net_region --- find the extent of the grid covering every	*/
+/*	tap and halo position of the nodes of net "net", every	*/
+/*	Nodeidx[] position of its nodes, and any route it	*/
+/*	already has, widened by "halo" on all sides and clipped	*/
+/*	to the grid.  A net with none of these is given the	*/
+/*	whole grid.						*/
+/*--------------------------------------------------------------*/
+
+void net_region(NET net, SEG region, int halo)
+{
+   NODE node;
+   DPOINT dp;
+   ROUTE rt;
+   SEG seg;
+   int k, i, x, y, pass;
+
+   region->x1 = NumChannelsX[0];
+   region->y1 = NumChannelsY[0];
+   region->x2 = region->y2 = -1;
+
+   for (node = net->netnodes; node; node = node->next) {
+      for (pass = 0; pass < 2; pass++) {
+	 for (dp = (pass == 0) ? node->taps : node->extend; dp; dp = dp->next) {
+	    if (dp->gridx < region->x1) region->x1 = dp->gridx;
+	    if (dp->gridx > region->x2) region->x2 = dp->gridx;
+	    if (dp->gridy < region->y1) region->y1 = dp->gridy;
+	    if (dp->gridy > region->y2) region->y2 = dp->gridy;
+	 }
+      }
+   }
+
+   if ((NodelocStart != NULL) && (net->netnum >= 0) &&
+		(net->netnum <= Numnets)) {
+      for (k = NodelocStart[net->netnum]; k < NodelocStart[net->netnum + 1];
+		k++) {
+	 i = NodelocTable[k] % (NumChannelsX[0] * NumChannelsY[0]);
+	 x = i % NumChannelsX[0];
+	 y = i / NumChannelsX[0];
+	 if (x < region->x1) region->x1 = x;
+	 if (x > region->x2) region->x2 = x;
+	 if (y < region->y1) region->y1 = y;
+	 if (y > region->y2) region->y2 = y;
+      }
+   }
+
+   for (rt = net->routes; rt; rt = rt->next) {
+      for (seg = rt->segments; seg; seg = seg->next) {
+	 if (MIN(seg->x1, seg->x2) < region->x1) region->x1 = MIN(seg->x1, seg->x2);
+	 if (MAX(seg->x1, seg->x2) > region->x2) region->x2 = MAX(seg->x1, seg->x2);
+	 if (MIN(seg->y1, seg->y2) < region->y1) region->y1 = MIN(seg->y1, seg->y2);
+	 if (MAX(seg->y1, seg->y2) > region->y2) region->y2 = MAX(seg->y1, seg->y2);
+      }
+   }
+
+   if (region->x2 < 0) {	// Nothing to route;  use the whole grid
+      region->x1 = region->y1 = 0;
+      region->x2 = NumChannelsX[0] - 1;
+      region->y2 = NumChannelsY[0] - 1;
+      return;
+   }
+
+   region->x1 = MAX(region->x1 - halo, 0);
+   region->y1 = MAX(region->y1 - halo, 0);
+   region->x2 = MIN(region->x2 + halo, NumChannelsX[0] - 1);
+   region->y2 = MIN(region->y2 + halo, NumChannelsY[0] - 1);
+}
+
+/*--------------------------------------------------------------*/
+/* regions_conflict --- TRUE if searches confined to regions	*/
+/*	"a" and "b" might touch the same grid position, allowing	*/
+/*	REGION_MARGIN positions around each.			*/
+/*--------------------------------------------------------------*/
+
+int regions_conflict(SEG a, SEG b)
+{
+   if (a->x1 - b->x2 > 2 * REGION_MARGIN) return FALSE;
+   if (b->x1 - a->x2 > 2 * REGION_MARGIN) return FALSE;
+   if (a->y1 - b->y2 > 2 * REGION_MARGIN) return FALSE;
+   if (b->y1 - a->y2 > 2 * REGION_MARGIN) return FALSE;
+   return TRUE;
+}
+
+/*--------------------------------------------------------------*/
+/* widen_region --- widen "region" by REGION_MARGIN on all	*/
+/*	sides, clipped to the grid, to cover every position a	*/
+/*	route within it may have changed.			*/
+/*--------------------------------------------------------------*/
+
+void widen_region(SEG region)
+{
+   region->x1 = MAX(region->x1 - REGION_MARGIN, 0);
+   region->y1 = MAX(region->y1 - REGION_MARGIN, 0);
+   region->x2 = MIN(region->x2 + REGION_MARGIN, NumChannelsX[0] - 1);
+   region->y2 = MIN(region->y2 + REGION_MARGIN, NumChannelsY[0] - 1);
+}
+
+/*--------------------------------------------------------------*/
+/* copy_obs_region --- copy the positions within "region" on	*/
+/*	all layers from Obs[] array "src" to Obs[] array "dst".	*/
+/*--------------------------------------------------------------*/
+
+void copy_obs_region(PGRID *dst, PGRID *src, SEG region)
+{
+   int lay;
+
+   for (lay = 0; lay < Num_layers; lay++)
+      pgrid_copy_region(dst[lay], src[lay], region->x1, region->y1,
+		region->x2, region->y2);
+}
+
+/*--------------------------------------------------------------*/
+/* save_obs_region --- return a packed copy of the positions of	*/
+/*	Obs[] within "region" on all layers, to be put back by	*/
+/*	restore_obs_region().					*/
+/*--------------------------------------------------------------*/
+
+u_int *save_obs_region(SEG region)
+{
+   int lay, x, y, w;
+   u_int *buf, *b;
+
+   w = region->x2 - region->x1 + 1;
+   buf = (u_int *)mem_malloc(MEM_OBS, w * (region->y2 - region->y1 + 1) *
+		Num_layers * sizeof(u_int));
+   if (buf == NULL) {
+      fprintf(stderr, "Out of memory in save_obs_region().\n");
+      exit(10);
+   }
+   for (lay = 0, b = buf; lay < Num_layers; lay++)
+      for (y = region->y1; y <= region->y2; y++)
+	 for (x = region->x1; x <= region->x2; x++)
+	    *b++ = OBSVAL(x, y, lay);
+   return buf;
+}
+
+/*--------------------------------------------------------------*/
+/* restore_obs_region --- copy positions saved by		*/
+/*	save_obs_region() back into Obs[].			*/
+/*--------------------------------------------------------------*/
+
+void restore_obs_region(u_int *buf, SEG region)
+{
+   int lay, x, y;
+   u_int *b;
+
+   // Positions left as they were are not written, so that their
+   // pages stay shared with the copies of the other workers.
+
+   for (lay = 0, b = buf; lay < Num_layers; lay++)
+      for (y = region->y1; y <= region->y2; y++)
+	 for (x = region->x1; x <= region->x2; x++, b++)
+	    if (OBSVAL(x, y, lay) != *b)
+	       *OBSPTR(x, y, lay) = *b;
+}
+
+/*--------------------------------------------------------------*/
+/* free_obs_region --- free positions saved by			*/
+/*	save_obs_region() for the same "region".		*/
+/*--------------------------------------------------------------*/
+
+void free_obs_region(u_int *buf, SEG region)
+{
+   mem_free(MEM_OBS, buf, (region->x2 - region->x1 + 1) *
+		(region->y2 - region->y1 + 1) * Num_layers * sizeof(u_int));
+}
+
+/*--------------------------------------------------------------*/
+/* discard_routes --- free the routes of net "net" following	*/
+/*	route "last" (all of them if "last" is NULL).		*/
+/*--------------------------------------------------------------*/
+
+void discard_routes(NET net, ROUTE last)
+{
+   ROUTE rt;
+
+   if (last == NULL) {
+      rt = net->routes;
+      net->routes = NULL;
+   }
+   else {
+      rt = last->next;
+      last->next = NULL;
+   }
+
+   // Routes are only ever added at the end of the list, so the records
+   // of "rt" and all routes after it are the last taken from the arena.
+
+   if (rt != NULL)
+      arena_release(net->arena, (last == NULL) ? NULL : rt);
+}
+
+/*--------------------------------------------------------------*/
+/* route_task --- route the net of one task, its search		*/
+/*	confined to the task's region.  Messages are collected	*/
+/*	in memory, to be printed in order by the main thread.	*/
+/*	For a speculative task, the positions the search changed	*/
+/*	in the worker's copy of Obs[] are saved in the task, and	*/
+/*	the copy returned to the grid as it was before the batch.	*/
+/*--------------------------------------------------------------*/
+
+void route_task(ROUTECTX ctx, ROUTETASK *task)
+{
+   NET net = task->net;
+   ROUTE last;
+
+   if (task->speculative) {
+      reset_touched(ctx);
+      for (last = net->routes; last && last->next; last = last->next);
+      task->last = last;
+   }
+
+   ctx->bounds = task->region;
+   ctx->bounded = TRUE;
+   ctx->routes = 0;
+   ctx->log = open_memstream(&task->msgs, &task->msgsize);
+   if (ctx->log == NULL) {
+      fprintf(stderr, "Out of memory in route_task().\n");
+      exit(10);
+   }
+
+   task->result = doroute(ctx, net, task->stage);
+   task->routes = ctx->routes;
+
+   fclose(ctx->log);
+   ctx->log = stdout;
+   ctx->bounded = FALSE;
+
+   if (task->speculative) {
+      net_region(net, &task->written, 0);
+      task->read = task->written;
+      if (ctx->touched.x2 >= 0) {
+	 task->read.x1 = MIN(task->read.x1, ctx->touched.x1);
+	 task->read.y1 = MIN(task->read.y1, ctx->touched.y1);
+	 task->read.x2 = MAX(task->read.x2, ctx->touched.x2);
+	 task->read.y2 = MAX(task->read.y2, ctx->touched.y2);
+      }
+      task->changed = task->written;
+      widen_region(&task->changed);
+      task->patch = save_obs_region(&task->changed);
+      copy_obs_region(Obs, SharedObs, &task->changed);
+   }
+}
+
+/*--------------------------------------------------------------*/
+/* route_worker --- body of a worker thread.  Takes tasks of	*/
+/*	the current batch until there are none left, then waits	*/
+/*	for the next batch.					*/
+/*--------------------------------------------------------------*/
+
+void *route_worker(void *arg)
+{
+   ROUTEWORKER *worker = (ROUTEWORKER *)arg;
+   ROUTETASK *task;
+   int i;
+
+   for (i = 0; i < Num_layers; i++)
+      Obs[i] = worker->obs[i];
+
+   pthread_mutex_lock(&PoolLock);
+   while (1) {
+      while (!PoolQuit && (PoolNextTask >= PoolNumTasks))
+	 pthread_cond_wait(&PoolStart, &PoolLock);
+      if (PoolQuit) break;
+
+      task = &PoolTasks[PoolNextTask++];
+      pthread_mutex_unlock(&PoolLock);
+
+      route_task(worker->ctx, task);
+
+      pthread_mutex_lock(&PoolLock);
+      if (++PoolFinished == PoolNumTasks)
+	 pthread_cond_signal(&PoolDone);
+   }
+   pthread_mutex_unlock(&PoolLock);
+   return NULL;
+}
+
+/*--------------------------------------------------------------*/
+/* start_route_workers --- start RouteThreads worker threads,	*/
+/*	each with its own ROUTECTX.  If "copyobs" is TRUE, each	*/
+/*	routes on its own copy of Obs[], else all share the Obs[]	*/
+/*	of the main thread.					*/
+/*								*/
+/* Return value:  number of threads started			*/
+/*--------------------------------------------------------------*/
+
+int start_route_workers(u_char copyobs)
+{
+   ROUTEWORKER *worker;
+   int i;
+
+   for (i = 0; i < Num_layers; i++)
+      SharedObs[i] = Obs[i];
+
+   PoolQuit = FALSE;
+   PoolNumTasks = PoolNextTask = PoolFinished = 0;
+
+   Workers = (ROUTEWORKER *)calloc(RouteThreads, sizeof(ROUTEWORKER));
+   if (Workers == NULL) {
+      fprintf(stderr, "Out of memory in start_route_workers().\n");
+      exit(10);
+   }
+
+   for (NumWorkers = 0; NumWorkers < RouteThreads; NumWorkers++) {
+      worker = &Workers[NumWorkers];
+      worker->ctx = new_route_context();
+      for (i = 0; i < Num_layers; i++) {
+	 if (copyobs)
+	    worker->obs[i] = pgrid_copy((PGRID)NULL, Obs[i]);
+	 else
+	    worker->obs[i] = Obs[i];
+      }
+      if (pthread_create(&worker->thread, NULL, route_worker,
+		(void *)worker) != 0) {
+	 fprintf(stderr, "Unable to start routing thread %d.\n", NumWorkers + 1);
+	 break;
+      }
+   }
+   return NumWorkers;
+}
+
+/*--------------------------------------------------------------*/
+/* stop_route_workers --- stop the worker threads, adding the	*/
+/*	statistics of their searches to those of "ctx".		*/
+/*--------------------------------------------------------------*/
+
+void stop_route_workers(ROUTECTX ctx)
+{
+   int i, j;
+
+   pthread_mutex_lock(&PoolLock);
+   PoolQuit = TRUE;
+   pthread_cond_broadcast(&PoolStart);
+   pthread_mutex_unlock(&PoolLock);
+
+   for (i = 0; i < NumWorkers; i++) {
+      pthread_join(Workers[i].thread, NULL);
+      ctx->expansions += Workers[i].ctx->expansions;
+      ctx->reexpansions += Workers[i].ctx->reexpansions;
+      ctx->pointallocs += Workers[i].ctx->pointallocs;
+      ctx->pointmallocs += Workers[i].ctx->pointmallocs;
+      free_route_context(Workers[i].ctx);
+      if (Workers[i].obs[0] != SharedObs[0])
+	 for (j = 0; j < Num_layers; j++)
+	    pgrid_free(Workers[i].obs[j]);
+   }
+   free(Workers);
+   Workers = NULL;
+   NumWorkers = 0;
+}
+
+/*--------------------------------------------------------------*/
+/* run_batch --- have the workers route "ntasks" tasks, and	*/
+/*	wait until all are done.				*/
+/*--------------------------------------------------------------*/
+
+void run_batch(ROUTETASK *tasks, int ntasks)
+{
+   pthread_mutex_lock(&PoolLock);
+   PoolTasks = tasks;
+   PoolNumTasks = ntasks;
+   PoolNextTask = PoolFinished = 0;
+   pthread_cond_broadcast(&PoolStart);
+   while (PoolFinished < PoolNumTasks)
+      pthread_cond_wait(&PoolDone, &PoolLock);
+   PoolNumTasks = PoolNextTask = 0;
+   pthread_mutex_unlock(&PoolLock);
+}
+
+/*--------------------------------------------------------------*/
+/* init_task --- set up a task to route net "net" in stage	*/
+/*	"stage", with the whole grid as its region.		*/
+/*--------------------------------------------------------------*/
+
+void init_task(ROUTETASK *task, NET net, int index, u_char stage)
+{
+   task->net = net;
+   task->index = index;
+   task->stage = stage;
+   task->speculative = FALSE;
+   task->region.x1 = task->region.y1 = 0;
+   task->region.x2 = NumChannelsX[0] - 1;
+   task->region.y2 = NumChannelsY[0] - 1;
+   task->msgs = NULL;
+   task->msgsize = 0;
+   task->patch = NULL;
+}
+
+/*--------------------------------------------------------------*/
+/* next_regions_batch --- gather tasks for nets of the queue	*/
+/*	from position "first" whose regions are clear of each	*/
+/*	other and of every net passed over.  Power and ground	*/
+/*	nets end the batch.					*/
+/*								*/
+/* Return value:  number of tasks				*/
+/*--------------------------------------------------------------*/
+
+int next_regions_batch(int first, u_char *done, SEG regions,
+		ROUTETASK *tasks, int maxtasks, SEG held, int window)
+{
+   int i, j, scanned, ntasks, nheld;
+   u_char clear;
+   NET net;
+
+   ntasks = nheld = 0;
+   for (j = first, scanned = 0; (j < NetOrderTableSize) && (scanned < window)
+		&& (ntasks < maxtasks); j++) {
+      if (done[j]) continue;
+      net = NetOrderTable[j];
+      if (net->netnodes == NULL) {
+	 done[j] = TRUE;
+	 continue;
+      }
+      if ((net->netnum == VDD_NET) || (net->netnum == GND_NET)) break;
+      scanned++;
+
+      clear = TRUE;
+      for (i = 0; clear && (i < ntasks); i++)
+	 if (regions_conflict(&regions[j], &tasks[i].region)) clear = FALSE;
+      for (i = 0; clear && (i < nheld); i++)
+	 if (regions_conflict(&regions[j], &held[i])) clear = FALSE;
+
+      if (clear) {
+	 init_task(&tasks[ntasks], net, j, (u_char)0);
+	 tasks[ntasks].region = regions[j];
+	 ntasks++;
+      }
+      else
+	 held[nheld++] = regions[j];
+   }
+   return ntasks;
+}
+
+/*--------------------------------------------------------------*/
+/* finish_regions_batch --- take the nets of a regions batch in	*/
+/*	queue order, routing again without bounds any that did	*/
+/*	not route within its region.				*/
+/*--------------------------------------------------------------*/
+
+void finish_regions_batch(ROUTECTX ctx, ROUTETASK *tasks, int ntasks,
+		u_char *done)
+{
+   int i;
+
+   for (i = 0; i < ntasks; i++) {
+      if (tasks[i].msgs != NULL) {
+	 fwrite(tasks[i].msgs, 1, tasks[i].msgsize, stdout);
+	 free(tasks[i].msgs);
+      }
+      TotalRoutes += tasks[i].routes;
+      if (tasks[i].result < 0) {
+	 fprintf(stdout, "Net %s does not route within its region;  "
+			"routing it without bounds\n", tasks[i].net->netname);
+	 doroute(ctx, tasks[i].net, (u_char)0);
+      }
+      else
+	 clear_net_nodelocs(tasks[i].net->netnum);
+      done[tasks[i].index] = TRUE;
+   }
+}
+
+/*--------------------------------------------------------------*/
+/* next_speculative_batch --- gather tasks for the nets of the	*/
+/*	queue from position "first", up to the next power or	*/
+/*	ground net.						*/
+/*								*/
+/* Return value:  number of tasks				*/
+/*--------------------------------------------------------------*/
+
+int next_speculative_batch(int first, u_char *done, ROUTETASK *tasks,
+		int maxtasks)
+{
+   int j, ntasks;
+   NET net;
+
+   ntasks = 0;
+   for (j = first; (j < NetOrderTableSize) && (ntasks < maxtasks); j++) {
+      if (done[j]) continue;
+      net = NetOrderTable[j];
+      if (net->netnodes == NULL) {
+	 done[j] = TRUE;
+	 continue;
+      }
+      if ((net->netnum == VDD_NET) || (net->netnum == GND_NET)) break;
+
+      init_task(&tasks[ntasks], net, j, (u_char)0);
+      tasks[ntasks].speculative = TRUE;
+      ntasks++;
+   }
+   return ntasks;
+}
+
+/*--------------------------------------------------------------*/
+/* finish_speculative_batch --- take the nets of a speculative	*/
+/*	batch in queue order.  Keep the route of each net whose	*/
+/*	search read nothing written by a net before it in the	*/
+/*	batch, copying the positions it wrote into Obs[], and	*/
+/*	route every other net again.  Then bring the copies of	*/
+/*	Obs[] of all workers up to date.			*/
+/*								*/
+/* Return value:  number of routes kept				*/
+/*--------------------------------------------------------------*/
+
+int finish_speculative_batch(ROUTECTX ctx, ROUTETASK *tasks, int ntasks,
+		u_char *done)
+{
+   int i, j, kept;
+   u_char clear;
+   NET net;
+
+   kept = 0;
+   for (i = 0; i < ntasks; i++) {
+      net = tasks[i].net;
+
+      clear = (tasks[i].result >= 0) ? TRUE : FALSE;
+      for (j = 0; clear && (j < i); j++)
+	 if (regions_conflict(&tasks[i].read, &tasks[j].written))
+	    clear = FALSE;
+
+      if (clear) {
+	 if (tasks[i].msgs != NULL)
+	    fwrite(tasks[i].msgs, 1, tasks[i].msgsize, stdout);
+	 restore_obs_region(tasks[i].patch, &tasks[i].changed);
+	 free_obs_region(tasks[i].patch, &tasks[i].changed);
+	 clear_net_nodelocs(net->netnum);
+	 TotalRoutes += tasks[i].routes;
+	 kept++;
+      }
+      else {
+	 free_obs_region(tasks[i].patch, &tasks[i].changed);
+	 if (Verbose > 0)
+	    fprintf(stdout, "Routing net %s again after a change in "
+			"its search area\n", net->netname);
+	 discard_routes(net, tasks[i].last);
+	 doroute(ctx, net, (u_char)0);
+	 net_region(net, &tasks[i].written, 0);
+	 tasks[i].changed = tasks[i].written;
+	 widen_region(&tasks[i].changed);
+      }
+      free(tasks[i].msgs);
+      tasks[i].patch = NULL;
+      done[tasks[i].index] = TRUE;
+   }
+
+   // The copies differ from Obs[] only within the regions the batch
+   // changed, so share all pages of Obs[] again rather than copying
+   // those regions.  This also frees the pages the workers wrote.
+
+   for (j = 0; j < NumWorkers; j++)
+      for (i = 0; i < Num_layers; i++)
+	 pgrid_copy(Workers[j].obs[i], Obs[i]);
+
+   return kept;
+}
+
+/*--------------------------------------------------------------*/
+/* route_nets --- route the "n" nets of "nets" in stage "stage"	*/
+/*	at once, on the worker threads if they are running, else	*/
+/*	one after another with "ctx".  Every search reads the	*/
+/*	grid as it was before all of them.  If "regions" is	*/
+/*	NULL, the searches are not bounded and must not change	*/
+/*	Obs[] (stage 1);  else each net is routed within its	*/
+/*	region, and the regions must be clear of each other.	*/
+/*	Messages and Nodeidx[] changes are made in the order of	*/
+/*	"nets", and the return value of doroute() for each net	*/
+/*	is left in "results".					*/
+/*--------------------------------------------------------------*/
+
+void route_nets(ROUTECTX ctx, NET *nets, SEG regions, int *results, int n,
+		u_char stage)
+{
+   ROUTETASK *tasks;
+   int i;
+
+   tasks = (ROUTETASK *)calloc(n, sizeof(ROUTETASK));
+   if (tasks == NULL) {
+      fprintf(stderr, "Out of memory in route_nets().\n");
+      exit(10);
+   }
+   for (i = 0; i < n; i++) {
+      init_task(&tasks[i], nets[i], i, stage);
+      if (regions != NULL)
+	 tasks[i].region = regions[i];
+   }
+
+   if (NumWorkers > 0)
+      run_batch(tasks, n);
+   else
+      for (i = 0; i < n; i++)
+	 route_task(ctx, &tasks[i]);
+
+   for (i = 0; i < n; i++) {
+      if (tasks[i].msgs != NULL) {
+	 fwrite(tasks[i].msgs, 1, tasks[i].msgsize, stdout);
+	 free(tasks[i].msgs);
+      }
+      TotalRoutes += tasks[i].routes;
+      if (tasks[i].result >= 0)
+	 clear_net_nodelocs(nets[i]->netnum);
+      results[i] = tasks[i].result;
+   }
+   free(tasks);
+}
+
+/*--------------------------------------------------------------*/
+/* next_failed_batch --- take from FailedNets the nets to be	*/
+/*	rerouted at once by the rip-up and reroute stage:  the	*/
+/*	first net, and the next ones whose regions are clear of	*/
+/*	the regions of all nets taken and of all nets passed	*/
+/*	over, up to "maxnets" nets.  A power or ground net is	*/
+/*	only ever taken alone.  The nets and their regions are	*/
+/*	left in "nets" and "regions".				*/
+/*								*/
+/* Return value:  number of nets taken				*/
+/*--------------------------------------------------------------*/
+
+int next_failed_batch(NET *nets, SEG regions, int maxnets)
+{
+   NETLIST nl, *lp;
+   SEG held;
+   NET net;
+   int n, nheld, window, j;
+   u_char clear;
+
+   nl = FailedNets;
+   nets[0] = nl->net;
+   FailedNets = nl->next;
+   free(nl);
+   if ((nets[0]->netnum == VDD_NET) || (nets[0]->netnum == GND_NET))
+      return 1;
+   net_region(nets[0], &regions[0], RouteHalo);
+
+   window = 4 * maxnets;		// most nets looked at
+   held = (SEG)malloc(window * sizeof(struct seg_));
+   if (held == NULL) {
+      fprintf(stderr, "Out of memory in next_failed_batch().\n");
+      exit(10);
+   }
+
+   n = 1;
+   nheld = 0;
+   lp = &FailedNets;
+   while ((*lp != NULL) && (n < maxnets) && (n + nheld < window)) {
+      net = (*lp)->net;
+      if ((net->netnum == VDD_NET) || (net->netnum == GND_NET)) break;
+
+      net_region(net, &regions[n], RouteHalo);
+      clear = TRUE;
+      for (j = 0; clear && (j < n); j++)
+	 if (regions_conflict(&regions[n], &regions[j])) clear = FALSE;
+      for (j = 0; clear && (j < nheld); j++)
+	 if (regions_conflict(&regions[n], &held[j])) clear = FALSE;
+
+      if (clear) {
+	 nets[n++] = net;
+	 nl = *lp;
+	 *lp = nl->next;
+	 free(nl);
+      }
+      else {
+	 held[nheld++] = regions[n];
+	 lp = &((*lp)->next);
+      }
+   }
+   free(held);
+   return n;
+}
+
+/*--------------------------------------------------------------*/
+/* route_parallel_stage --- route all nets of the routing	*/
+/*	queue, as the first stage does, using RouteThreads	*/
+/*	worker threads.  "ctx" is used for nets routed serially,	*/
+/*	and collects the statistics of all searches.		*/
+/*--------------------------------------------------------------*/
+
+void route_parallel_stage(ROUTECTX ctx)
+{
+   int i, j, n, first, ntasks, maxtasks, window, kept, tried;
+   u_char *done;
+   SEG regions, held;
+   ROUTETASK *tasks;
+
+   n = NetOrderTableSize;
+   maxtasks = 4 * RouteThreads;		// most nets in one batch
+   window = 16 * RouteThreads;		// most nets looked at for a batch
+
+   done = (u_char *)calloc(n + 1, sizeof(u_char));
+   regions = (SEG)malloc((n + 1) * sizeof(struct seg_));
+   held = (SEG)malloc(window * sizeof(struct seg_));
+   tasks = (ROUTETASK *)calloc(maxtasks, sizeof(ROUTETASK));
+   if (!done || !regions || !held || !tasks) {
+      fprintf(stderr, "Out of memory in route_parallel_stage().\n");
+      exit(10);
+   }
+
+   if (ParallelMode == PARALLEL_REGIONS)
+      for (i = 0; i < n; i++)
+	 net_region(NetOrderTable[i], &regions[i], RouteHalo);
+
+   // Workers in speculative mode each route on a copy of Obs[]
+
+   start_route_workers((ParallelMode == PARALLEL_SPECULATIVE) ? TRUE : FALSE);
+   fprintf(stdout, "Routing first stage with %d threads (%s)\n", NumWorkers,
+		(ParallelMode == PARALLEL_SPECULATIVE) ? "speculative" :
+		"regions");
+
+   first = 0;
+   kept = tried = 0;
+   while (NumWorkers > 0) {
+      while ((first < n) && done[first]) first++;
+      if (first >= n) break;
+
+      if (ParallelMode == PARALLEL_SPECULATIVE)
+	 ntasks = next_speculative_batch(first, done, tasks, maxtasks);
+      else
+	 ntasks = next_regions_batch(first, done, regions, tasks, maxtasks,
+			held, window);
+
+      if (ntasks == 0) {
+	 // Power or ground net at the head of the queue.  Its search
+	 // may write anywhere, so copy all of Obs[] to the workers.
+	 for (; (first < n) && done[first]; first++);
+	 if (first < n) {
+	    doroute(ctx, NetOrderTable[first], (u_char)0);
+	    done[first] = TRUE;
+	    if (ParallelMode == PARALLEL_SPECULATIVE)
+	       for (j = 0; j < NumWorkers; j++)
+		  for (i = 0; i < Num_layers; i++)
+		     pgrid_copy(Workers[j].obs[i], Obs[i]);
+	 }
+	 continue;
+      }
+
+      run_batch(tasks, ntasks);
+
+      if (ParallelMode == PARALLEL_SPECULATIVE) {
+	 kept += finish_speculative_batch(ctx, tasks, ntasks, done);
+	 tried += ntasks;
+      }
+      else
+	 finish_regions_batch(ctx, tasks, ntasks, done);
+      fflush(stdout);
+   }
+
+   // If no thread could be started, route serially
+
+   if (NumWorkers == 0)
+      for (j = 0; j < n; j++)
+	 if (!done[j] && (NetOrderTable[j]->netnodes != NULL))
+	    doroute(ctx, NetOrderTable[j], (u_char)0);
+
+   if (ParallelMode == PARALLEL_SPECULATIVE)
+      fprintf(stdout, "Speculative routes kept: %d of %d\n", kept, tried);
+
+   stop_route_workers(ctx);
+
+   free(done);
+   free(regions);
+   free(held);
+   free(tasks);
+}
+
+/* end of parallel.c */
@@ -0,0 +1,28 @@
+/*--------------------------------------------------------------*/
+/* parallel.h -- first routing stage on several threads		*/
+/*--------------------------------------------------------------*/
+
+#ifndef PARALLEL_H
+
+// Grid positions outside of its region that a search may read or
+// write:  a stacked via moved aside by commit_proute(), and the
+// positions blocked next to a route by writeback_segment().
+
+#define REGION_MARGIN	2
+
+extern int NumWorkers;		// running worker threads
+
+void	net_region(NET net, SEG region, int halo);
+int	regions_conflict(SEG a, SEG b);
+void	route_parallel_stage(ROUTECTX ctx);
+int	start_route_workers(u_char copyobs);
+void	stop_route_workers(ROUTECTX ctx);
+void	route_nets(ROUTECTX ctx, NET *nets, SEG regions, int *results, int n,
+		u_char stage);
+int	next_failed_batch(NET *nets, SEG regions, int maxnets);
+void	discard_routes(NET net, ROUTE last);
+
+#define PARALLEL_H
+#endif
+
+/* end of parallel.h */
@@ -11,12 +11,20 @@
 #include <stdlib.h>
 #include <string.h>
 #include <getopt.h>
+#include <time.h>
 
 #include "qrouter.h"
 #include "config.h"
 #include "node.h"
 #include "maze.h"
 #include "lef.h"
+#include "queue.h"
+#include "parallel.h"
+#include "negotiate.h"
+#include "global.h"
+#include "mem.h"
+#include "grid.h"
+#include "hash.h"
 
 int  Pathon = -1;
 int  TotalRoutes = 0;
@@ -25,7 +33,6 @@ FILE *Failfptr = NULL;
 FILE *CNfptr = NULL;
 
 NET     Nlnets;		// list of nets in the design
-NET	CurNet;		// current net to route, used by 2nd stage
 STRING  DontRoute;      // a list of nets not to route (e.g., power)
 STRING  CriticalNet;    // list of critical nets to route first
 GATE    GateInfo;       // standard cell macro information
@@ -33,13 +40,10 @@ GATE    Nlgates;	// gate instance information
 NETLIST FailedNets;	// list of nets that failed to route
 NETLIST Abandoned;	// list of nets that will never route
 
-u_char *Mask[MAX_LAYERS];    // mask out best area to route, expand as needed
-u_int  *Obs[MAX_LAYERS];     // net obstructions in layer
-PROUTE *Obs2[MAX_LAYERS];    // used for pt->pt routes on layer
-float  *Stub[MAX_LAYERS];    // used for stub routing to pins
-float  *Obsinfo[MAX_LAYERS]; // temporary array used for detailed obstruction info
-NODE   *Nodeloc[MAX_LAYERS]; // nodes are here. . .
-NODE   *Nodesav[MAX_LAYERS]; // . . . and here (but not to be altered)
+__thread PGRID Obs[MAX_LAYERS];	// net obstructions in layer (per thread)
+FGRID  Stub[MAX_LAYERS];    // used for stub routing to pins
+FGRID  Obsinfo[MAX_LAYERS]; // temporary array used for detailed obstruction info
+PGRID  Nodeidx[MAX_LAYERS]; // nodes are here (see node.h)
 DSEG   UserObs;		     // user-defined obstruction layers
 
 u_char needblockX[MAX_LAYERS];
@@ -55,7 +59,6 @@ int   Verbose = 0;
 int   keepTrying = 0;
 int   forceRoutable = 0;
 
-int   pwrbus_src;
 
 /*--------------------------------------------------------------*/
 /* Open the "failed" and "cn" (critical nets) files.		*/
@@ -112,7 +115,8 @@ int set_num_channels()
 }
 
 /*--------------------------------------------------------------*/
-/* Allocate the Obs[] array (may be called from DefRead)	*/
+/* Allocate the Obs[] array (may be called from DefRead).	*/
+/* Its pages are only allocated as they are written.		*/
 /*--------------------------------------------------------------*/
 
 int allocate_obs_array()
@@ -121,14 +125,8 @@ int allocate_obs_array()
 
    if (Obs[0] != NULL) return;	/* Already been called */
 
-   for (i = 0; i < Num_layers; i++) {
-      Obs[i] = (u_int *)calloc(NumChannelsX[i] * NumChannelsY[i],
-			sizeof(u_int));
-      if (!Obs[i]) {
-	 fprintf(stderr, "Out of memory 4.\n");
-	 return(4);
-      }
-   }
+   for (i = 0; i < Num_layers; i++)
+      Obs[i] = pgrid_new(NumChannelsX[i], NumChannelsY[i], MEM_OBS);
    return 0;
 }
 
@@ -150,6 +148,51 @@ countlist(NETLIST net)
    return count;
 }
 
+/*--------------------------------------------------------------*/
+/* sortlist ---							*/
+/*   Sort a simple linked list of nets into routing order (by	*/
+/*   netorder), keeping entries of equal order in place.	*/
+/*   Returns the new head of the list.				*/
+/*--------------------------------------------------------------*/
+
+NETLIST
+sortlist(NETLIST net)
+{
+   NETLIST a, b, head, *tail;
+
+   if ((net == NULL) || (net->next == NULL)) return net;
+
+   // Split the list in half and sort each half
+
+   a = net;
+   b = net->next;
+   while (b && b->next) {
+      a = a->next;
+      b = b->next->next;
+   }
+   b = a->next;
+   a->next = NULL;
+   a = sortlist(net);
+   b = sortlist(b);
+
+   // Merge the two halves
+
+   tail = &head;
+   while (a && b) {
+      if (b->net->netorder < a->net->netorder) {
+	 *tail = b;
+	 b = b->next;
+      }
+      else {
+	 *tail = a;
+	 a = a->next;
+      }
+      tail = &((*tail)->next);
+   }
+   *tail = (a) ? a : b;
+   return head;
+}
+
 /*--------------------------------------------------------------*/
 /* main - program entry point, parse command line		*/
 /*								*/
@@ -176,6 +219,7 @@ main(int argc, char *argv[])
    int iscale = 1;
 
    NET net;
+   ROUTECTX ctx;
     
    Filename[0] = 0;
    DEFfilename[0] = 0;
@@ -192,10 +236,10 @@ main(int argc, char *argv[])
 	    infofile = strdup(optarg);
 	    break;
 	 case 'p':
-	    vddnet = strdup(optarg);
+	    vddnet = name_intern(optarg);
 	    break;
 	 case 'g':
-	    gndnet = strdup(optarg);
+	    gndnet = name_intern(optarg);
 	    break;
 	 case 'r':
 	    if (sscanf(optarg, "%d", &iscale) != 1) {
@@ -237,6 +281,7 @@ main(int argc, char *argv[])
       fprintf(stderr, "Could not open %s!\n", configfile );
    }
    if (configfile != configdefault) free(configfile);
+   mem_report("LEF read");
 
    if (infofile != NULL) {
       FILE *infoFILEptr;
@@ -274,64 +319,35 @@ main(int argc, char *argv[])
       exit(1);
    }
 
-   Obs[0] = (u_int *)NULL;
+   Obs[0] = (PGRID)NULL;
    NumChannelsX[0] = 0;	// This is so we can check if NumChannelsX/Y were
 			// set from within DefRead() due to reading in
 			// existing nets.
 
    oscale = (double)((float)iscale * DefRead(DEFfilename));
+   mem_report("DEF read");
 
-   create_netorder();
+   // Ordering by congestion waits for the congestion map, which
+   // needs the obstructions.
+
+   if (NetOrderMode != ORDER_CONGESTION)
+      create_netorder();
 
    set_num_channels();		// If not called from DefRead()
    allocate_obs_array();	// If not called from DefRead()
 
    for (i = 0; i < Num_layers; i++) {
 
-      /*
-      Mask[i] = (u_char *)calloc(NumChannelsX[i] * NumChannelsY[i],
-			sizeof(u_char));
-      if (!Mask[i]) {
-	 fprintf(stderr, "Out of memory 3.\n");
-	 exit(3);
-      }
-      */
+      Obsinfo[i] = fgrid_new(NumChannelsX[i], NumChannelsY[i], MEM_OBSINFO);
+      Stub[i] = fgrid_new(NumChannelsX[i], NumChannelsY[i], MEM_STUB);
 
-      Obsinfo[i] = (float *)calloc(NumChannelsX[i] * NumChannelsY[i],
-			sizeof(float));
-      if (!Obsinfo[i]) {
-	 fprintf(stderr, "Out of memory 5.\n");
-	 exit(5);
-      }
-
-      Stub[i] = (float *)calloc(NumChannelsX[i] * NumChannelsY[i],
-			sizeof(float));
-      if (!Stub[i]) {
-	 fprintf( stderr, "Out of memory 6.\n");
-	 exit(6);
-      }
+      // Nodeidx is the reverse lookup table for nodes
 
-      // Nodeloc is the reverse lookup table for nodes
-
-      Nodeloc[i] = (NODE *)calloc(NumChannelsX[i] * NumChannelsY[i],
-		sizeof(NODE));
-      if (!Nodeloc[i]) {
-         fprintf(stderr, "Out of memory 7.\n");
-         exit(7);
-      }
-
-      Nodesav[i] = (NODE *)calloc(NumChannelsX[i] * NumChannelsY[i],
-		sizeof(NODE));
-      if (!Nodesav[i]) {
-         fprintf(stderr, "Out of memory 8.\n");
-         exit(8);
-      }
+      Nodeidx[i] = pgrid_new(NumChannelsX[i], NumChannelsY[i], MEM_NODELOC);
    }
+   create_node_table();
    fflush(stdout);
 
-   fprintf(stderr, "Diagnostic: memory block is %d bytes\n",
-		sizeof(u_int) * NumChannelsX[0] * NumChannelsY[0]);
-
    /* Be sure to create obstructions from gates first, since we don't	*/
    /* want improperly defined or positioned obstruction layers to over-	*/
    /* write our node list.						*/
@@ -342,21 +358,32 @@ main(int argc, char *argv[])
    create_obstructions_from_variable_pitch();
    adjust_stub_lengths();
    find_route_blocks();
+   index_nodelocs();
 
-   // Remove the Obsinfo array, which is no longer needed, and allocate
-   // the Obs2 array for costing information
+   if ((NetOrderMode == ORDER_CONGESTION) || (CongestionCost > 0) ||
+		(CongestionFile != NULL)) {
+      congestion_map();
+      if (CongestionFile != NULL)
+	 write_congestion_map(CongestionFile);
+   }
+   if (NetOrderMode == ORDER_CONGESTION)
+      create_netorder();
 
-   for (i = 0; i < Num_layers; i++) free(Obsinfo[i]);
+   // Share the pages of Obs[] and Nodeidx[] left empty or blocked
+   // throughout, and remove the Obsinfo array, which is no longer
+   // needed.
 
    for (i = 0; i < Num_layers; i++) {
-      Obs2[i] = (PROUTE *)calloc(NumChannelsX[i] * NumChannelsY[i],
-			sizeof(PROUTE));
-      if (!Obs2[i]) {
-         fprintf( stderr, "Out of memory 9.\n");
-         exit(9);
-      }
+      pgrid_share_uniform(Obs[i]);
+      pgrid_share_uniform(Nodeidx[i]);
+      fgrid_free(Obsinfo[i]);
    }
 
+   // Allocate the search context, which holds the obs2 array for
+   // costing information
+
+   ctx = new_route_context();
+
    // Fill in needblockX and needblockY, which are used by commit_proute
    // when route layers are too large for the grid size, and grid points
    // around a route need to be marked as blocked whenever something is
@@ -367,6 +394,7 @@ main(int argc, char *argv[])
       needblockX[i] = (sreq > PitchX[i]) ? TRUE : FALSE;
       needblockY[i] = (sreq > PitchY[i]) ? TRUE : FALSE;
    }
+   mem_report("obstructions");
 
    // Now we have netlist data, and can use it to get a list of nets.
 
@@ -380,16 +408,26 @@ main(int argc, char *argv[])
    // print_nodes( "nodes.details" );
    // print_nlnets( "netlist.out" );
 
-   for (i = 0; i < Numnets; i++) {
-      net = getnettoroute(i);
-      if ((net != NULL) && (net->netnodes != NULL))
-	 doroute(net, (u_char)0);
+   if (GlobalRoute) global_route();
+
+   if (RouteThreads > 1)
+      route_parallel_stage(ctx);
+   else {
+      for (i = 0; i < NetOrderTableSize; i++) {
+	 net = getnettoroute(i);
+	 if ((net != NULL) && (net->netnodes != NULL))
+	    doroute(ctx, net, (u_char)0);
+      }
    }
 
    fflush(stdout);
    fprintf(stdout, "\n----------------------------------------------\n");
    fprintf(stdout, "Progress: ");
    fprintf(stdout, "Total routing loops completed: %d\n", TotalRoutes);
+   fprintf(stdout, "Grid points expanded: %ld (%ld re-expanded)\n",
+		ctx->expansions, ctx->reexpansions);
+   fprintf(stdout, "Search points allocated: %ld (%ld blocks malloc'd)\n",
+		ctx->pointallocs, ctx->pointmallocs);
    if (FailedNets == (NETLIST)NULL && Abandoned == (NETLIST)NULL)
       fprintf(stdout, "No failed routes!\n");
    else {
@@ -399,12 +437,16 @@ main(int argc, char *argv[])
           fprintf(stdout, "Abandoned net routes: %d\n", countlist(Abandoned));
    }
    fprintf(stdout, "----------------------------------------------\n");
+   mem_report("stage 1");
 
-   dosecondstage();
+   if (NegotiatePasses > 0) donegotiation(ctx);
+   dosecondstage(ctx);
+   mem_report("stage 2");
 
    // Finish up by writing the routes to an annotated DEF file
     
    emit_routes(DEFfilename, oscale, iscale);
+   mem_report("output");
 
    fprintf(stdout, "----------------------------------------------\n");
    fprintf(stdout, "Final: ");
@@ -694,33 +736,22 @@ void print_nlgates( char *filename )
 /*--------------------------------------------------------------*/
 /* getnettoroute - get a net to route				*/
 /*								*/
-/*   ARGS: 							*/
-/*   RETURNS: 							*/
+/*   ARGS: position in the routing queue			*/
+/*   RETURNS: the net, or NULL if past the end of the queue	*/
 /*   SIDE EFFECTS: 						*/
 /*   AUTHOR and DATE: steve beccue      Fri Aug 8		*/
 /*--------------------------------------------------------------*/
 
 NET getnettoroute(int order)
 {
-  NET net;
-  
   fflush(stdout);
   fflush(stderr);
 
-  for (net = Nlnets; net; net = net->next) {
-     if (net->netorder == order) {
-	if (net->numnodes >= 2) {
-	   return net;
-        }
-	// Qrouter will route power and ground nets even if the
-	// standard cell power and ground pins are not listed in
-	// the nets section.  Because of this, it is okay to have
-	// only one node.
-	else if (net->numnodes == 1 && (net->netnum == VDD_NET ||
-		net->netnum == GND_NET))
-	   return net;
-     }
-  }
+  // NetOrderTable is the routing queue built by create_netorder(),
+  // holding only nets that can be routed.
+
+  if ((order >= 0) && (order < NetOrderTableSize))
+     return NetOrderTable[order];
   if (Verbose > 0) {
      fprintf(stderr, "getnettoroute():  Fell through\n");
   }
@@ -728,6 +759,174 @@ NET getnettoroute(int order)
 
 } /* getnettoroute() */
 
+/*--------------------------------------------------------------*/
+/* route_with_collisions() ---					*/
+/*								*/
+/* Route net "net" with stage = 1, allowing collisions with	*/
+/* other nets.  If that fails, clear the net's "noripup" list	*/
+/* and try once more, unless that was already done before.	*/
+/* Returns the result of doroute().				*/
+/*--------------------------------------------------------------*/
+
+int route_with_collisions(ROUTECTX ctx, NET net)
+{
+   NETLIST nl;
+   int result;
+
+   result = doroute(ctx, net, (u_char)1);
+   if ((result != 0) && (net->noripup != NULL)) {
+      if ((net->flags & NET_PENDING) == 0) {
+	 // Clear this net's "noripup" list and try again.
+
+	 while (net->noripup) {
+	    nl = net->noripup->next;
+	    free(net->noripup);
+	    net->noripup = nl;
+	 }
+	 result = doroute(ctx, net, (u_char)1);
+	 net->flags |= NET_PENDING;	// Next time we abandon it.
+      }
+   }
+   return result;
+}
+
+/*--------------------------------------------------------------*/
+/* finish_reroute() ---						*/
+/*								*/
+/* Take the result of rerouting net "net" in the second stage.	*/
+/* If "result" is nonzero, the net could not be routed even	*/
+/* with collisions, and is abandoned.  Otherwise, if the net	*/
+/* was routed with collisions ("collided" is TRUE), rip up the	*/
+/* nets it collides with and append them to FailedNets, then	*/
+/* copy the routes of the net into Obs.				*/
+/*--------------------------------------------------------------*/
+
+void finish_reroute(NET net, int result, u_char collided)
+{
+   NETLIST nl, nl2, fn;
+
+   if (result != 0) {
+      // Complete failure to route, even allowing collisions.
+      // Abandon routing this net.
+      fflush(stdout);
+      fprintf(stderr, "----------------------------------------------\n");
+      fprintf(stderr, "Complete failure on net %s:  Abandoning.\n",
+		net->netname);
+      fprintf(stderr, "----------------------------------------------\n");
+      // Add the net to the "abandoned" list
+      nl = (NETLIST)malloc(sizeof(struct netlist_));
+      nl->net = net;
+      nl->next = Abandoned;
+      Abandoned = nl;
+
+      while (FailedNets && (FailedNets->net == net)) {
+	 nl = FailedNets->next;
+	 free(FailedNets);
+	 FailedNets = nl;
+      }
+      return;
+   }
+
+   // Analyze route for nets with which it collides
+
+   nl = (collided) ? find_colliding(net) : (NETLIST)NULL;
+
+   // Remove the colliding nets from the route grid and append
+   // them to FailedNets.
+
+   while(nl) {
+      nl2 = nl->next;
+      fprintf(stdout, "Ripping up blocking net %s\n", nl->net->netname);
+      if (ripup_net(nl->net, (u_char)1) == TRUE) { 
+	 for (fn = FailedNets; fn && fn->next != NULL; fn = fn->next);
+	 if (fn)
+	    fn->next = nl;
+	 else
+	    FailedNets = nl;
+
+	 // Add nl->net to "noripup" list for this net, so it won't be
+	 // routed over again by the net.  Avoids infinite looping in
+	 // the second stage.
+
+	 fn = (NETLIST)malloc(sizeof(struct net_));
+	 fn->next = net->noripup;
+	 net->noripup = fn;
+	 fn->net = nl->net;
+      }
+
+      nl->next = (NETLIST)NULL;
+      nl = nl2;
+   }
+
+   // Now we copy the net we routed above into Obs
+   writeback_all_routes(net);
+}
+
+/*--------------------------------------------------------------*/
+/* reroute_batch() ---						*/
+/*								*/
+/* Reroute the "n" nets of "nets" at once on the worker		*/
+/* threads, each within its region in "regions" (see		*/
+/* next_failed_batch()).  Each net is routed without collisions	*/
+/* if it can be, else with collisions;  a net that does not	*/
+/* route within its region is routed again without bounds.	*/
+/* The nets are then finished in order, as by dosecondstage().	*/
+/*--------------------------------------------------------------*/
+
+void reroute_batch(ROUTECTX ctx, NET *nets, SEG regions, int n)
+{
+   NET *cnets;
+   SEG cregions;
+   int *results, *cresults;
+   int i, nc;
+
+   results = (int *)malloc(2 * n * sizeof(int));
+   cnets = (NET *)malloc(n * sizeof(NET));
+   cregions = (SEG)malloc(n * sizeof(struct seg_));
+   if (!results || !cnets || !cregions) {
+      fprintf(stderr, "Out of memory in reroute_batch().\n");
+      exit(10);
+   }
+   cresults = results + n;
+
+   // Route as much as possible without collisions
+
+   route_nets(ctx, nets, regions, results, n, (u_char)0);
+
+   // Then route the nets that failed with collisions
+
+   nc = 0;
+   for (i = 0; i < n; i++) {
+      if (results[i] != 0) {
+	 cnets[nc] = nets[i];
+	 cregions[nc++] = regions[i];
+      }
+   }
+   if (nc > 0)
+      route_nets(ctx, cnets, cregions, cresults, nc, (u_char)1);
+
+   nc = 0;
+   for (i = 0; i < n; i++) {
+      if (results[i] == 0) {
+	 finish_reroute(nets[i], 0, FALSE);
+	 continue;
+      }
+      fflush(stdout);
+      fprintf(stderr, "Routing net %s with collisions\n", nets[i]->netname);
+      results[i] = cresults[nc++];
+      if (results[i] != 0) {
+	 fprintf(stdout, "Net %s does not route within its region;  "
+			"routing it without bounds\n", nets[i]->netname);
+	 results[i] = route_with_collisions(ctx, nets[i]);
+      }
+      finish_reroute(nets[i], results[i], TRUE);
+   }
+
+   free(results);
+   free(cnets);
+   free(cregions);
+}
+
 /*--------------------------------------------------------------*/
 /* dosecondstage() ---						*/
 /*								*/
@@ -742,14 +941,26 @@ NET getnettoroute(int order)
 /*    FailedNets list						*/
 /* 5) Route the original failing net.				*/
 /* 6) Continue until all failed nets have been processed.	*/
+/* Failed nets are taken in the order of the routing queue,	*/
+/* followed by ripped-up nets in the order they were ripped up.	*/
+/*								*/
+/* With "threads N", the failing nets are taken in batches of	*/
+/* nets whose regions are clear of each other, as in the	*/
+/* first stage, and each batch is rerouted on N threads	*/
+/* before the next batch is taken.  With "parallel mode	*/
+/* speculative", the nets are rerouted one at a time, so that	*/
+/* the routes are those made by a single thread.		*/
 /*--------------------------------------------------------------*/
 
 void
-dosecondstage()
+dosecondstage(ROUTECTX ctx)
 {
-   int failcount, origcount, result, maxtries, lasttries;
-   NET net;
-   NETLIST nl, nl2, fn;
+   int failcount, origcount, result, maxtries, maxbatch, n;
+   NET *batch;
+   SEG regions;
+
+   // Retry the failed nets in the order of the routing queue
+   FailedNets = sortlist(FailedNets);
 
    origcount = countlist(FailedNets);
    if (FailedNets)
@@ -757,6 +968,14 @@ dosecondstage()
    else
       maxtries = 0;
 
+   if ((FailedNets != NULL) && (RouteThreads > 1) &&
+		(ParallelMode != PARALLEL_SPECULATIVE))
+      start_route_workers(FALSE);
+   maxbatch = (NumWorkers > 0) ? 4 * NumWorkers : 1;
+
+   batch = (NET *)malloc(maxbatch * sizeof(NET));
+   regions = (SEG)malloc(maxbatch * sizeof(struct seg_));
+
    while (FailedNets != NULL) {
 
       // Diagnostic:  how are we doing?
@@ -765,94 +984,28 @@ dosecondstage()
       fprintf(stdout, "Number of remaining nets: %d\n", failcount);
       fprintf(stdout, "------------------------------\n");
 
-      net = FailedNets->net;
-
-      // Remove this net from the fail list
-      nl2 = FailedNets;
-      FailedNets = FailedNets->next;
-      free(nl2);
-
-      // Route as much as possible without collisions
-      result = doroute(net, (u_char)0);
-
-      if (result != 0) {
-	 fflush(stdout);
-	 fprintf(stderr, "Routing net %s with collisions\n", net->netname);
-         result = doroute(net, (u_char)1);
-         if (result != 0) {
-	    if (net->noripup != NULL) {
-	       if ((net->flags & NET_PENDING) == 0) {
-	          // Clear this net's "noripup" list and try again.
-
-	          while (net->noripup) {
-	             nl = net->noripup->next;
-	             free(net->noripup);
-	             net->noripup = nl;
-	          }
-	          result = doroute(net, (u_char)1);
-		  net->flags |= NET_PENDING;	// Next time we abandon it.
-	       }
-	    }
-	 }
-         if (result != 0) {
-	    // Complete failure to route, even allowing collisions.
-	    // Abandon routing this net.
-	    fflush(stdout);
-	    fprintf(stderr, "----------------------------------------------\n");
-	    fprintf(stderr, "Complete failure on net %s:  Abandoning.\n",
-			net->netname);
-	    fprintf(stderr, "----------------------------------------------\n");
-	    // Add the net to the "abandoned" list
-	    nl = (NETLIST)malloc(sizeof(struct netlist_));
-	    nl->net = net;
-	    nl->next = Abandoned;
-	    Abandoned = nl;
-
-	    while (FailedNets && (FailedNets->net == net)) {
-	       nl = FailedNets->next;
-	       free(FailedNets);
-	       FailedNets = nl;
-	    }
-	    continue;
-	 }
+      // Remove the next net(s) from the fail list
+      n = next_failed_batch(batch, regions, maxbatch);
 
-         // Analyze route for nets with which it collides
+      if (n > 1)
+	 reroute_batch(ctx, batch, regions, n);
 
-         nl = find_colliding(net);
-      }
-      else
-	 nl = (NETLIST)NULL;
-
-      // Remove the colliding nets from the route grid and append
-      // them to FailedNets.
-
-      while(nl) {
-	 nl2 = nl->next;
-         fprintf(stdout, "Ripping up blocking net %s\n", nl->net->netname);
-	 if (ripup_net(nl->net, (u_char)1) == TRUE) { 
-	    for (fn = FailedNets; fn && fn->next != NULL; fn = fn->next);
-	    if (fn)
-	       fn->next = nl;
-	    else
-	       FailedNets = nl;
+      else {
+	 // Route as much as possible without collisions
+	 result = doroute(ctx, batch[0], (u_char)0);
 
-	    // Add nl->net to "noripup" list for this net, so it won't be
-	    // routed over again by the net.  Avoids infinite looping in
-	    // the second stage.
-
-	    fn = (NETLIST)malloc(sizeof(struct net_));
-	    fn->next = net->noripup;
-	    net->noripup = fn;
-	    fn->net = nl->net;
+	 if (result != 0) {
+	    fflush(stdout);
+	    fprintf(stderr, "Routing net %s with collisions\n",
+			batch[0]->netname);
+	    result = route_with_collisions(ctx, batch[0]);
+	    finish_reroute(batch[0], result, TRUE);
+	    if (result != 0) continue;
 	 }
-
-	 nl->next = (NETLIST)NULL;
-	 nl = nl2;
+	 else
+	    finish_reroute(batch[0], result, FALSE);
       }
 
-      // Now we copy the net we routed above into Obs
-      writeback_all_routes(net);
-
       // Failsafe---if we have been looping enough times to exceed
       // maxtries (which is set to 8 route attempts per original failed
       // net), then we check progress.  If we have reduced the number
@@ -871,6 +1024,10 @@ dosecondstage()
 	 }
       }
    }
+
+   if (NumWorkers > 0) stop_route_workers(ctx);
+   free(batch);
+   free(regions);
 }
 
 /*--------------------------------------------------------------*/
@@ -884,16 +1041,16 @@ dosecondstage()
 /* point on each node.						*/
 /*--------------------------------------------------------------*/
 
-void createMask(NET net)
+void createMask(ROUTECTX ctx, NET net)
 {
   NODE n1, n2;
-  int i, j, o, l;
+  int o, l;
   DPOINT dtap, d1tap, d2tap, mintap;
   int dx, dy, dist, mindist;
   int x1, x2, y1, y2;
-  int xcent, ycent, xmin, ymin, xmax, ymax;
+  int xcent, ycent, xmin, ymin, xmax, ymax, count;
 
-  fillMask(0);
+  fillMask(ctx, 0);
 
   if (net->numnodes == 2) { 
 
@@ -904,8 +1061,13 @@ void createMask(NET net)
      // Simple 2-pass---pick up first tap on n1, find closest tap on n2,
      // then find closest tap on n1.
      d1tap = (n1->taps == NULL) ? n1->extend : n1->taps;
-     for (d2tap = (n2->taps == NULL) ? n2->extend : n2->taps; d2tap != NULL;
-		d2tap = d2tap->next) {
+     d2tap = (n2->taps == NULL) ? n2->extend : n2->taps;
+     if (d1tap == NULL || d2tap == NULL) {
+	fillMask(ctx, 1);
+	return;
+     }
+     mintap = d2tap;
+     for (; d2tap != NULL; d2tap = d2tap->next) {
 	dx = d2tap->gridx - d1tap->gridx;
 	dy = d2tap->gridy - d1tap->gridy;
 	dist = dx * dx + dy * dy;
@@ -939,13 +1101,13 @@ void createMask(NET net)
 
      // Place a track on every tap and extend position
      for (d1tap = n1->taps; d1tap != NULL; d1tap = d1tap->next)
-	Mask[d1tap->layer][OGRID(d1tap->x, d1tap->y, d1tap->layer)] = (u_char)1;
+	MASK_SET(ctx, d1tap->gridx, d1tap->gridy, d1tap->layer);
      for (d1tap = n1->extend; d1tap != NULL; d1tap = d1tap->next)
-	Mask[d1tap->layer][OGRID(d1tap->x, d1tap->y, d1tap->layer)] = (u_char)1;
+	MASK_SET(ctx, d1tap->gridx, d1tap->gridy, d1tap->layer);
      for (d2tap = n2->taps; d2tap != NULL; d2tap = d2tap->next)
-	Mask[d2tap->layer][OGRID(d2tap->x, d2tap->y, d2tap->layer)] = (u_char)1;
+	MASK_SET(ctx, d2tap->gridx, d2tap->gridy, d2tap->layer);
      for (d2tap = n2->extend; d2tap != NULL; d2tap = d2tap->next)
-	Mask[d2tap->layer][OGRID(d2tap->x, d2tap->y, d2tap->layer)] = (u_char)1;
+	MASK_SET(ctx, d2tap->gridx, d2tap->gridy, d2tap->layer);
 
      // Find the orientation of the lowest tap layer.  Lay alternate vertical
      // and horizontal tracks according to track orientation.
@@ -953,46 +1115,43 @@ void createMask(NET net)
      for (; l < Num_layers; l++) {
         o = LefGetRouteOrientation(l);
 	if (!o) {
-           for (i = x1 - 1; i <= x1 + 1; i++)
-	      for (j = y1 - 1; j <= y2 + 1; j++)	// Left vertical route
-	         Mask[l][OGRID(i, j, l)] = (u_char)1;
-
-           for (i = x2 - 1; i <= x2 + 1; i++)
-	      for (j = y1 - 1; j <= y2 + 1; j++)	// Right vertical route
-	         Mask[l][OGRID(i, j, l)] = (u_char)1;
+	   setMaskBox(ctx, x1 - 1, y1 - 1, x1 + 1, y2 + 1, l);  // Left vertical route
+	   setMaskBox(ctx, x2 - 1, y1 - 1, x2 + 1, y2 + 1, l);  // Right vertical route
 	}
 	else {
-           for (i = x1 - 1; i <= x2 + 1; i++)
-	      for (j = y1 - 1; j <= y1 + 1; j++)	// Bottom horizontal route
-	         Mask[l][OGRID(i, j, l)] = (u_char)1;
-
-           for (i = x1 - 1; i <= x2 + 1; i++)
-	      for (j = y2 - 1; j <= y2 + 1; j++)	// Top horizontal route
-	         Mask[l][OGRID(i, j, l)] = (u_char)1;
+	   setMaskBox(ctx, x1 - 1, y1 - 1, x2 + 1, y1 + 1, l);  // Bottom horizontal route
+	   setMaskBox(ctx, x1 - 1, y2 - 1, x2 + 1, y2 + 1, l);  // Top horizontal route
 	}
      }
 
-     fprintf(stdout, "2-port mask edges rectangle (%d %d) to (%d %d)\n",
+     if (Verbose > 0)
+        fprintf(stdout, "2-port mask edges rectangle (%d %d) to (%d %d)\n",
 		x1, y1, x2, y2);
   }
   else {
 
      // Use the first tap point for each node to get a rough bounding box and
      // centroid of all taps
-     xcent = ycent = 0;
+     xcent = ycent = count = 0;
      xmax = ymax = -(MAXRT);
      xmin = ymin = MAXRT;
      for (n1 = net->netnodes; n1 != NULL; n1 = n1->next) {
 	dtap = (n1->taps == NULL) ? n1->extend : n1->taps;
+	if (dtap == NULL) continue;
 	xcent += dtap->gridx;
 	ycent += dtap->gridy;
 	if (dtap->gridx > xmax) xmax = dtap->gridx;
 	if (dtap->gridx < xmin) xmin = dtap->gridx;
 	if (dtap->gridy > ymax) ymax = dtap->gridy;
 	if (dtap->gridy < ymin) ymin = dtap->gridy;
+	count++;
+     }
+     if (count == 0) {
+	fillMask(ctx, 1);
+	return;
      }
-     xcent /= net->numnodes;
-     ycent /= net->numnodes;
+     xcent /= count;
+     ycent /= count;
 
      if (xmax - xmin > ymax - ymin) {
 	// Horizontal trunk
@@ -1007,98 +1166,180 @@ void createMask(NET net)
      // Allow routes at all tap and extension points
      for (n1 = net->netnodes; n1 != NULL; n1 = n1->next) {
         for (dtap = n1->taps; dtap != NULL; dtap = dtap->next)
-	   Mask[dtap->layer][OGRID(dtap->gridx, dtap->gridy, dtap->layer)] = (u_char)1;
+	   MASK_SET(ctx, dtap->gridx, dtap->gridy, dtap->layer);
         for (dtap = n1->extend; dtap != NULL; dtap = dtap->next)
-	   Mask[dtap->layer][OGRID(dtap->gridx, dtap->gridy, dtap->layer)] = (u_char)1;
+	   MASK_SET(ctx, dtap->gridx, dtap->gridy, dtap->layer);
      }
 
      for (l = 0; l < Num_layers; l++) {
 	// If the layer orientation is the same as the trunk, place mask around
 	// trunk line.
 	if (o == LefGetRouteOrientation(l)) {
-           for (i = xmin - 1; i <= xmax + 1; i++)
-	      for (j = ymin - 1; j <= ymax + 1; j++)
-	         Mask[l][OGRID(i, j, l)] = (u_char)1;
+	   setMaskBox(ctx, xmin - 1, ymin - 1, xmax + 1, ymax + 1, l);
 	}
 	else {
            for (n1 = net->netnodes; n1 != NULL; n1 = n1->next) {
 	      dtap = (n1->taps == NULL) ? n1->extend : n1->taps;
-	      if (o == 1) {	// Horizontal trunk, vertical branches
-                 for (i = dtap->gridx - 1; i <= dtap->gridx + 1; i++) {
-	            for (j = dtap->gridy - 1; j <= ycent + 1; j++)
-	               Mask[l][OGRID(i, j, l)] = (u_char)1;
-	            for (j = ycent - 1; j <= dtap->gridy + 1; j++)
-	               Mask[l][OGRID(i, j, l)] = (u_char)1;
-	         }
-	      } 
-	      else {		// Vertical trunk, horizontal branches
-                 for (j = dtap->gridy - 1; j <= dtap->gridy + 1; j++) {
-	            for (i = dtap->gridx - 1; i <= xcent + 1; i++)
-	               Mask[l][OGRID(i, j, l)] = (u_char)1;
-	            for (i = xcent - 1; i <= dtap->gridx + 1; i++)
-	               Mask[l][OGRID(i, j, l)] = (u_char)1;
-		 }
-	      }
+	      if (dtap == NULL) continue;
+	      if (o == 1)	// Horizontal trunk, vertical branches
+		 setMaskBox(ctx, dtap->gridx - 1, MIN(dtap->gridy, ycent) - 1,
+			dtap->gridx + 1, MAX(dtap->gridy, ycent) + 1, l);
+	      else		// Vertical trunk, horizontal branches
+		 setMaskBox(ctx, MIN(dtap->gridx, xcent) - 1, dtap->gridy - 1,
+			MAX(dtap->gridx, xcent) + 1, dtap->gridy + 1, l);
 	   }
 	}
      }
-     fprintf(stdout, "multi-port mask has trunk line (%d %d) to (%d %d)\n",
+     if (Verbose > 0)
+        fprintf(stdout, "multi-port mask has trunk line (%d %d) to (%d %d)\n",
 		xmin, ymin, xmax, ymax);
   }
 }
 
 /*--------------------------------------------------------------*/
-/* expandMask --- Extend the Mask area by 1 in all directions	*/
-/* by recursive search over all active mask positions (set to	*/
-/* nonzero).  Value 1 is used for new mask positions; value 2	*/
-/* tracks mask positions that have been processed.		*/
+/* setMaskBox --- Set the Mask over the rectangle (x1, y1) to	*/
+/* (x2, y2) on layer l, clipped to the route grid.		*/
 /*--------------------------------------------------------------*/
 
-void expandMask(int x, int y, int l) {
-   if (Mask[l][OGRID(x, y, l)] == 0) {
-      Mask[l][OGRID(x, y, l)] = (u_char)2;
-   }
-   else if (Mask[l][OGRID(x, y, l)] == 1) {
-      Mask[l][OGRID(x, y, l)] = (u_char)2;	// Mark processed
-      if (x > 0) expandMask(x - 1, y, l);
-      else if (x < NumChannelsX[l] - 1) expandMask(x + 1, y, l);
-      if (y > 0) expandMask(x, y - 1, l);
-      else if (y < NumChannelsY[l] - 1) expandMask(x, y + 1, l);
-      if (l > 0) expandMask(x, y, l - 1);
-      else if (l < Num_layers - 1) expandMask(x, y, l + 1);
-   }
+void setMaskBox(ROUTECTX ctx, int x1, int y1, int x2, int y2, int l)
+{
+   int x, y;
+
+   if (x1 < 0) x1 = 0;
+   if (y1 < 0) y1 = 0;
+   if (x2 >= NumChannelsX[l]) x2 = NumChannelsX[l] - 1;
+   if (y2 >= NumChannelsY[l]) y2 = NumChannelsY[l] - 1;
+
+   for (x = x1; x <= x2; x++)
+      for (y = y1; y <= y2; y++)
+	 MASK_SET(ctx, x, y, l);
 }
 
 /*--------------------------------------------------------------*/
-/* setMask() is the same routine as expandMask() but cleans up,	*/
-/* turning all values 2 back into mask value 1.			*/
+/* expandMask --- Extend the Mask area by "halo" grid positions	*/
+/* in all directions, and to "halo" layers above and below.	*/
+/* The box-shaped growth is done one axis at a time:  each row,	*/
+/* then each column, is swept from both ends keeping the	*/
+/* distance to the last mask position seen.  This is iterative,	*/
+/* so the size of the grid is not limited by the stack.  Only	*/
+/* the bounding box of the mask, plus the halo, is swept.  All	*/
+/* route layers have the same grid dimensions (see		*/
+/* read_config()).						*/
 /*--------------------------------------------------------------*/
 
-void setMask(int x, int y, int l) {
-   if (Mask[l][OGRID(x, y, l)] == 2) {
-      Mask[l][OGRID(x, y, l)] = (u_char)1;
+void expandMask(ROUTECTX ctx, int halo)
+{
+   u_char *oldmask;
+   int l, l2, b, k, i, x, y, d, nbytes;
+   int xmin, xmax, ymin, ymax;
+
+   nbytes = MASK_BYTES(0);
+
+   // Find the extent of the mask over all layers
+
+   xmin = NumChannelsX[0];
+   ymin = NumChannelsY[0];
+   xmax = ymax = -1;
+   for (l = 0; l < Num_layers; l++) {
+      for (b = 0; b < nbytes; b++) {
+	 if (ctx->mask[l][b] == 0) continue;
+	 for (k = 0; k < 8; k++) {
+	    if (!(ctx->mask[l][b] & (1 << k))) continue;
+	    i = (b << 3) + k;
+	    x = i % NumChannelsX[0];
+	    y = i / NumChannelsX[0];
+	    if (x < xmin) xmin = x;
+	    if (x > xmax) xmax = x;
+	    if (y < ymin) ymin = y;
+	    if (y > ymax) ymax = y;
+	 }
+      }
+   }
+   if (xmax < 0) return;	// Empty mask
+
+   xmin = MAX(xmin - halo, 0);
+   ymin = MAX(ymin - halo, 0);
+   xmax = MIN(xmax + halo, NumChannelsX[0] - 1);
+   ymax = MIN(ymax + halo, NumChannelsY[0] - 1);
 
-      if (x > 0) setMask(x - 1, y, l);
-      else if (x < NumChannelsX[l] - 1) setMask(x + 1, y, l);
-      if (y > 0) setMask(x, y - 1, l);
-      else if (y < NumChannelsY[l] - 1) setMask(x, y + 1, l);
-      if (l > 0) setMask(x, y, l - 1);
-      else if (l < Num_layers - 1) setMask(x, y, l + 1);
+   oldmask = (u_char *)mem_malloc(MEM_MASK, nbytes);
+   if (!oldmask) {
+      fprintf(stderr, "Out of memory in expandMask().\n");
+      exit(3);
+   }
+
+   for (l = 0; l < Num_layers; l++) {
+
+      // Grow along each row
+      memcpy(oldmask, ctx->mask[l], nbytes);
+      for (y = ymin; y <= ymax; y++) {
+	 d = halo + 1;
+	 for (x = xmin; x <= xmax; x++) {
+	    if (MASKBITS_TEST(oldmask, x, y, l)) d = 0;
+	    else if (++d <= halo) MASK_SET(ctx, x, y, l);
+	 }
+	 d = halo + 1;
+	 for (x = xmax; x >= xmin; x--) {
+	    if (MASKBITS_TEST(oldmask, x, y, l)) d = 0;
+	    else if (++d <= halo) MASK_SET(ctx, x, y, l);
+	 }
+      }
+
+      // Grow along each column
+      memcpy(oldmask, ctx->mask[l], nbytes);
+      for (x = xmin; x <= xmax; x++) {
+	 d = halo + 1;
+	 for (y = ymin; y <= ymax; y++) {
+	    if (MASKBITS_TEST(oldmask, x, y, l)) d = 0;
+	    else if (++d <= halo) MASK_SET(ctx, x, y, l);
+	 }
+	 d = halo + 1;
+	 for (y = ymax; y >= ymin; y--) {
+	    if (MASKBITS_TEST(oldmask, x, y, l)) d = 0;
+	    else if (++d <= halo) MASK_SET(ctx, x, y, l);
+	 }
+      }
+   }
+   mem_free(MEM_MASK, oldmask, nbytes);
+
+   // Grow between layers.  Since all layers share the same grid, this
+   // is a bytewise OR of the masks of the neighboring layers, taken
+   // from copies made before any layer is changed.
+
+   if (Num_layers > 1) {
+      u_char *copymask[MAX_LAYERS];
+
+      for (l = 0; l < Num_layers; l++) {
+	 copymask[l] = (u_char *)mem_malloc(MEM_MASK, nbytes);
+	 if (!copymask[l]) {
+	    fprintf(stderr, "Out of memory in expandMask().\n");
+	    exit(3);
+	 }
+	 memcpy(copymask[l], ctx->mask[l], nbytes);
+      }
+      for (l = 0; l < Num_layers; l++) {
+	 for (l2 = l - halo; l2 <= l + halo; l2++) {
+	    if (l2 < 0 || l2 >= Num_layers || l2 == l) continue;
+	    for (b = 0; b < nbytes; b++)
+	       ctx->mask[l][b] |= copymask[l2][b];
+	 }
+      }
+      for (l = 0; l < Num_layers; l++)
+	 mem_free(MEM_MASK, copymask[l], nbytes);
    }
 }
 
 /*--------------------------------------------------------------*/
-/* fillMask() fills the Mask[] array with all 1s as a last	*/
-/* resort, ensuring that no valid routes are missed due to a	*/
-/* bad guess about the optimal route positions.			*/
+/* fillMask() fills the search mask of "ctx" with all 1s as a	*/
+/* last resort, ensuring that no valid routes are missed due to	*/
+/* a bad guess about the optimal route positions.		*/
 /*--------------------------------------------------------------*/
 
-void fillMask(int value) {
+void fillMask(ROUTECTX ctx, int value) {
    int i;
 
    for (i = 0; i < Num_layers; i++) {
-      memset((void *)Mask[i], value,
-		(size_t)(NumChannelsX[i] * NumChannelsY[i] * sizeof(u_char)));
+      memset((void *)ctx->mask[i], (value) ? 0xff : 0, (size_t)MASK_BYTES(i));
    }
 }
 
@@ -1114,7 +1355,7 @@ void fillMask(int value) {
 /*   AUTHOR and DATE: steve beccue      Fri Aug 8		*/
 /*--------------------------------------------------------------*/
 
-int doroute(NET net, u_char stage)
+int doroute(ROUTECTX ctx, NET net, u_char stage)
 {
   ROUTE rt1, lrt;
   NETLIST nlist;
@@ -1125,18 +1366,18 @@ int doroute(NET net, u_char stage)
      return 0;
   }
 
-  CurNet = net;				// Global, used by 2nd stage
+  ctx->curnet = net;			// Used by 2nd stage
 
   if (net->netnum == VDD_NET || net->netnum == GND_NET)
-     pwrbus_src = 0;
+     ctx->pwrbus_src = 0;
 
   while (1) {	// Keep going until we are unable to route to a terminal
 
-     rt1 = createemptyroute();
+     rt1 = createemptyroute(net);
      rt1->netnum = net->netnum;
 
      if (Verbose > 0) {
-        fprintf(stdout,"doroute(): added net %d path start %d\n", 
+        fprintf(ctx->log, "doroute(): added net %d path start %d\n", 
 	       net->netnum, net->netnodes->nodenum);
      }
 
@@ -1146,24 +1387,32 @@ int doroute(NET net, u_char stage)
      // a large and critical net may not get routed at all because one of the
      // first legs wouldn't route.
 
-     result = route_segs(net, rt1, stage);
+     result = route_segs(ctx, net, rt1, stage);
 
      if ((result == 0) || (net == NULL)) {
         // Nodes already routed, nothing to do
-	free(rt1);
+	arena_release(net->arena, rt1);
 	return 0;
      }
 
      if (result < 0) {		// Route failure.
+	if (ctx->bounded) {
+	   // Left for the caller to route again without bounds
+	   arena_release(net->arena, rt1);
+	   return -1;
+	}
 	nlist = (NETLIST)malloc(sizeof(struct netlist_));
 	nlist->net = net;
 	nlist->next = FailedNets;
 	FailedNets = nlist;
-	free(rt1);
+	arena_release(net->arena, rt1);
 	return -1;
      }
 
-     TotalRoutes++;
+     if (ctx->bounded)
+	ctx->routes++;		// Added to TotalRoutes by the caller
+     else
+	TotalRoutes++;
 
      if (net->routes) {
         for (lrt = net->routes; lrt->next; lrt = lrt->next);
@@ -1176,6 +1425,131 @@ int doroute(NET net, u_char stage)
   
 } /* doroute() */
 
+/*--------------------------------------------------------------*/
+/* find_target_bounds - record the extent in X, Y and layer of	*/
+/*	all positions flagged PR_TARGET on the nodes following	*/
+/*	"n1" in its net, and the cheapest cost of a single step	*/
+/*	in X and in Y on any layer, for use by search_key().	*/
+/*--------------------------------------------------------------*/
+
+void find_target_bounds(ROUTECTX ctx, NODE n1)
+{
+   NODE n2;
+   DPOINT ntap;
+   int i, pass;
+
+   ctx->targetbox.x1 = NumChannelsX[0];
+   ctx->targetbox.y1 = NumChannelsY[0];
+   ctx->targetbox.x2 = ctx->targetbox.y2 = -1;
+   ctx->targetlayer1 = Num_layers;
+   ctx->targetlayer2 = -1;
+
+   for (n2 = n1->next; n2; n2 = n2->next) {
+      for (pass = 0; pass < 2; pass++) {
+	 for (ntap = (pass == 0) ? n2->taps : n2->extend; ntap; ntap = ntap->next) {
+	    if (!(OBS2(ctx, ntap->gridx, ntap->gridy, ntap->layer)->flags
+			& PR_TARGET))
+	       continue;
+	    if (ntap->gridx < ctx->targetbox.x1) ctx->targetbox.x1 = ntap->gridx;
+	    if (ntap->gridx > ctx->targetbox.x2) ctx->targetbox.x2 = ntap->gridx;
+	    if (ntap->gridy < ctx->targetbox.y1) ctx->targetbox.y1 = ntap->gridy;
+	    if (ntap->gridy > ctx->targetbox.y2) ctx->targetbox.y2 = ntap->gridy;
+	    if (ntap->layer < ctx->targetlayer1) ctx->targetlayer1 = ntap->layer;
+	    if (ntap->layer > ctx->targetlayer2) ctx->targetlayer2 = ntap->layer;
+	 }
+      }
+   }
+
+   // No targets found (should not happen);  fall back to Dijkstra
+   if (ctx->targetlayer2 < 0) {
+      ctx->useastar = FALSE;
+      return;
+   }
+
+   // A step in X costs SegCost on a horizontal layer and JogCost on a
+   // vertical layer, and the reverse for a step in Y.  Use the lowest
+   // over all layers, since the route may change layers.
+
+   ctx->astarcostx = ctx->astarcosty = MAXRT;
+   for (i = 0; i < Num_layers; i++) {
+      if (Vert[i]) {
+	 if (JogCost < ctx->astarcostx) ctx->astarcostx = JogCost;
+	 if (SegCost < ctx->astarcosty) ctx->astarcosty = SegCost;
+      }
+      else {
+	 if (SegCost < ctx->astarcostx) ctx->astarcostx = SegCost;
+	 if (JogCost < ctx->astarcosty) ctx->astarcosty = JogCost;
+      }
+   }
+}
+
+/*--------------------------------------------------------------*/
+/* search_key - priority queue key for a grid position of the	*/
+/*	given cost.  For A* this adds an estimate of the	*/
+/*	remaining cost to the nearest target:  the Manhattan	*/
+/*	distance to the target bounding box weighted by the	*/
+/*	cheapest step cost, plus ViaCost per layer between the	*/
+/*	position and the target layers.  The estimate never	*/
+/*	exceeds the true cost, so route costs are unchanged.	*/
+/*--------------------------------------------------------------*/
+
+u_int search_key(ROUTECTX ctx, int x, int y, int lay, u_int cost)
+{
+   u_int h = 0;
+
+   if (!ctx->useastar) return cost;
+
+   if (x < ctx->targetbox.x1) h += (ctx->targetbox.x1 - x) * ctx->astarcostx;
+   else if (x > ctx->targetbox.x2) h += (x - ctx->targetbox.x2) * ctx->astarcostx;
+   if (y < ctx->targetbox.y1) h += (ctx->targetbox.y1 - y) * ctx->astarcosty;
+   else if (y > ctx->targetbox.y2) h += (y - ctx->targetbox.y2) * ctx->astarcosty;
+   if (lay < ctx->targetlayer1) h += (ctx->targetlayer1 - lay) * ViaCost;
+   else if (lay > ctx->targetlayer2) h += (lay - ctx->targetlayer2) * ViaCost;
+
+   return cost + h;
+}
+
+/*--------------------------------------------------------------*/
+/* print_search_rate - append the number of grid points	*/
+/*	expanded and the rate of expansion to the "Found a	*/
+/*	route of cost" line printed by route_segs().		*/
+/*--------------------------------------------------------------*/
+
+void print_search_rate(ROUTECTX ctx, long expanded, double seconds)
+{
+   fprintf(ctx->log, " (%ld expansions", expanded);
+   if (seconds > 0.0)
+      fprintf(ctx->log, ", %.0f/sec", (double)expanded / seconds);
+   fprintf(ctx->log, ")");
+}
+
+/*--------------------------------------------------------------*/
+/* push_point - add a grid position to the list of positions	*/
+/*	to be processed by route_segs().  In SEARCH_HEAP and	*/
+/*	SEARCH_ASTAR modes the position goes onto the priority	*/
+/*	queue, keyed by its current cost in ctx->obs2[] (see	*/
+/*	search_key());  otherwise it is pushed onto the stack	*/
+/*	"plist".						*/
+/*--------------------------------------------------------------*/
+
+void push_point(ROUTECTX ctx, POINT *plist, int x, int y, int lay)
+{
+   POINT gpoint;
+
+   if (SearchMode != SEARCH_STACK) {
+      pq_push(ctx->queue, x, y, lay,
+		search_key(ctx, x, y, lay, OBS2(ctx, x, y, lay)->prdata.cost));
+      return;
+   }
+
+   gpoint = point_alloc(ctx);
+   gpoint->x1 = x;
+   gpoint->y1 = y;
+   gpoint->layer = lay;
+   gpoint->next = *plist;
+   *plist = gpoint;
+}
+
 /*--------------------------------------------------------------*/
 /* route_segs - detailed route from node to node using onestep	*/
 /*	method   						*/
@@ -1186,15 +1560,14 @@ int doroute(NET net, u_char stage)
 /*   AUTHOR and DATE: steve beccue      Fri Aug 8		*/
 /*--------------------------------------------------------------*/
 
-int route_segs(NET net, ROUTE rt, u_char stage)
+int route_segs(ROUTECTX ctx, NET net, ROUTE rt, u_char stage)
 {
   POINT gpoint, glist, gunproc;
   SEG  seg;
-  struct seg_ bbox;
+  struct seg_ bbox, window;
   int  i, j, k, o;
-  int  x, y;
   NODE n1, n2, n2save;
-  u_int netnum, dir, forbid;
+  u_int forbid;
   char filename[32];
   int  dist, max, min, maxcost;
   int  thisnetnum, thisindex, index, pass;
@@ -1203,32 +1576,31 @@ int route_segs(NET net, ROUTE rt, u_char stage)
   u_char first = (u_char)1;
   u_char do_pwrbus;
   u_char check_order[6];
-  DPOINT n1tap, n2tap;
+  DPOINT n1tap, n2tap = (DPOINT)NULL;
   PROUTE *Pr;
+  PQENTRY pqe;
+  long expanded;
+  clock_t starttime;
+  u_char use_mask;
+  u_char resume, steiner;
+  int maskhalo;
 
-  // Make Obs2[][] a copy of Obs[][].  Convert pin obstructions to
-  // terminal positions for the net being routed.
-
-  for (i = 0; i < Num_layers; i++) {
-      for (x = 0; x < NumChannelsX[i]; x++) {
-	  for (y = 0; y < NumChannelsY[i]; y++) {
-	      netnum = Obs[i][OGRID(x, y, i)] & (~BLOCKED_MASK);
-	      Pr = &Obs2[i][OGRID(x, y, i)];
-	      if (netnum != 0) {
-	         Pr->flags = 0;		// Clear all flags
-	         Pr->prdata.net = netnum & NETNUM_MASK;
-	         dir = netnum & PINOBSTRUCTMASK;
-	         if ((dir != 0) && ((dir & STUBROUTE_X) == STUBROUTE_X)) {
-		    if ((netnum & NETNUM_MASK) == rt->netnum)
-		       Pr->prdata.net = 0;	// STUBROUTE_X not routable
-	         }
-	      } else {
-	         Pr->flags = PR_COST;		// This location is routable
-	         Pr->prdata.cost = MAXRT;
-	      }
-	  }
-      }
-  }
+  // In "search steiner" mode, the search that made the previous
+  // connection of this net is continued, with that connection
+  // already made part of the source (see set_route_to_source()).
+
+  resume = ((ctx->steinernet == net) && (ctx->steinerstage == stage) &&
+		(ctx->steinerepoch == ctx->epoch)) ? TRUE : FALSE;
+  ctx->steinernet = (NET)NULL;
+
+  if (!resume) pq_clear(ctx->queue);
+  point_pool_reset(ctx);
+
+  // Make ctx->obs2[][] a copy of Obs[][].  This is done lazily:  bumping
+  // the epoch invalidates every position, and each one is copied from
+  // Obs[][] by OBS2() the first time this search touches it.
+
+  if (!resume) new_obs2_epoch(ctx, rt->netnum);
 
   best.cost = MAXRT;
 
@@ -1245,10 +1617,14 @@ int route_segs(NET net, ROUTE rt, u_char stage)
      // sole source node
      
      do_pwrbus = TRUE;
-     for (i = 0; i < pwrbus_src; i++) n1 = n1->next;
+     for (i = 0; i < ctx->pwrbus_src; i++) n1 = n1->next;
   }
   else do_pwrbus = FALSE;
 
+  steiner = (SearchSteiner && (SearchMode != SEARCH_STACK) &&
+		!SearchCorridor && !do_pwrbus && !global_corridor(net))
+		? TRUE : FALSE;
+
   // We start at the node referenced by the route structure, and flag all
   // of its taps as PR_SOURCE, as well as all connected routes.
 
@@ -1256,23 +1632,37 @@ int route_segs(NET net, ROUTE rt, u_char stage)
   bbox.x1 = NumChannelsX[0];
   bbox.y1 = NumChannelsY[0];
 
-  if (n1 != NULL) {
-     rval = set_node_to_net(n1, PR_SOURCE, &glist, &bbox, stage);
+  if (!resume && (n1 != NULL)) {
+     rval = set_node_to_net(ctx, n1, PR_SOURCE, &glist, &bbox, stage);
 
      if (rval == -2) {
-        printf("Node of net %s has no tap points---unable to route!\n", n1->netname);
-	if (forceRoutable) make_routable(n1);
+        fprintf(ctx->log, "Node of net %s has no tap points---unable to route!\n", n1->netname);
+	if (forceRoutable && !ctx->bounded) make_routable(n1);
         return -1;
      }
   }
 
-  if (do_pwrbus == FALSE) {
+  if (resume) {
+
+     // Sources and targets are already marked.  Find any node not yet
+     // connected.
+
+     result = 0;
+     for (n2 = n1->next; n2; n2 = n2->next) {
+	if (node_is_target(ctx, n2)) {
+	   n2save = n2;
+	   result = 1;
+	}
+     }
+     net_bbox(net, &bbox.x1, &bbox.y1, &bbox.x2, &bbox.y2);
+  }
+  else if (do_pwrbus == FALSE) {
 
      // Set associated routes to PR_SOURCE
-     rval = set_routes_to_net(net, PR_SOURCE, &glist, &bbox, stage);
+     rval = set_routes_to_net(ctx, net, PR_SOURCE, &glist, &bbox, stage);
 
      if (rval == -2) {
-        printf("Node of net %s has no tap points---unable to route!\n", net->netname);
+        fprintf(ctx->log, "Node of net %s has no tap points---unable to route!\n", net->netname);
         return -1;
      }
 
@@ -1281,14 +1671,14 @@ int route_segs(NET net, ROUTE rt, u_char stage)
 
      result = 0;
      for (n2 = n1->next; n2; n2 = n2->next) {
-        rval = set_node_to_net(n2, PR_TARGET, NULL, &bbox, stage);
+        rval = set_node_to_net(ctx, n2, PR_TARGET, NULL, &bbox, stage);
         if (rval == 0) {
 	   n2save = n2;
 	   result = 1;
         }
         else if (rval == -2) {
-           printf("Node of net %s has no tap points---unable to route!\n", n2->netname);
-	   if (forceRoutable) make_routable(n2);
+           fprintf(ctx->log, "Node of net %s has no tap points---unable to route!\n", n2->netname);
+	   if (forceRoutable && !ctx->bounded) make_routable(n2);
 	   if (result == 0) result = -1;
         }
      }
@@ -1301,47 +1691,78 @@ int route_segs(NET net, ROUTE rt, u_char stage)
      /* Set all nodes that are NOT n1 to an unused net number */
      for (n2 = net->netnodes; n2; n2 = n2->next) {
 	if (n2 != n1) {
-	   disable_node_nets(n2);
+	   disable_node_nets(ctx, n2);
 	}
      }
 
-     pwrbus_src++;
-     if ((pwrbus_src > net->numnodes) || (n1 == NULL))
+     ctx->pwrbus_src++;
+     if ((ctx->pwrbus_src > net->numnodes) || (n1 == NULL))
 	result = 0;
      else {
-        set_powerbus_to_net(n1->netnum);
+        set_powerbus_to_net(ctx, n1->netnum);
 	result = 1;
      }
   }
 
   // Check for the possibility that there is already a route to the target
   if (!result) {
-     fprintf(stdout, "Finished routing net %s\n", net->netname);
+     fprintf(ctx->log, "Finished routing net %s\n", net->netname);
 
      // Remove nodes of the net from Nodeloc so that they will not be
-     // used for crossover costing of future routes.
-
-     for (i = 0; i < Num_layers; i++) {
-        for (x = 0; x < NumChannelsX[i]; x++) {
-	   for (y = 0; y < NumChannelsY[i]; y++) {
-	      n1 = Nodeloc[i][OGRID(x, y, i)];
-	      if (n1 != (NODE)NULL)
-		 if (n1->netnum == rt->netnum)
-		    Nodeloc[i][OGRID(x, y, i)] = (NODE)NULL;
-	   }
-        }
-     }
+     // used for crossover costing of future routes.  Searches run by
+     // worker threads leave this to the caller, as other searches
+     // may be reading Nodeloc.
+
+     if (!ctx->bounded) clear_net_nodelocs(rt->netnum);
 
      while (glist) {
 	gpoint = glist;
 	glist = glist->next;
-	free(gpoint);
+	point_free(ctx, gpoint);
      }
      return 0;
   }
 
+  // In heap mode, move the source points onto the priority queue.
+  // Source points have zero cost.  For A*, find the extent of the
+  // targets first, since it is needed for the key of each point.
+
+  ctx->useastar = ((SearchMode == SEARCH_ASTAR) && !do_pwrbus) ? TRUE : FALSE;
+  if (ctx->useastar) find_target_bounds(ctx, n1);
+
+  if (SearchMode != SEARCH_STACK) {
+     while (glist) {
+	gpoint = glist;
+	glist = glist->next;
+	pq_push(ctx->queue, gpoint->x1, gpoint->y1, gpoint->layer,
+		search_key(ctx, gpoint->x1, gpoint->y1, gpoint->layer, 0));
+	point_free(ctx, gpoint);
+     }
+  }
+
   // Generate a search area mask representing the "likely best route".
-  // createMask(CurNet);
+
+  // With global routing, the mask is the corridor of the net.
+
+  use_mask = ((SearchCorridor || global_corridor(net)) && !do_pwrbus)
+		? TRUE : FALSE;
+  if (use_mask) {
+     if (global_corridor(net))
+	corridor_mask(ctx, net);
+     else
+	createMask(ctx, net);
+  }
+  maskhalo = 2;
+
+  // With the grids in a scratch directory, have the area around the
+  // sources and targets read in ahead of the search.
+
+  window.x1 = MAX(bbox.x1 - OBS2_TILE, ctx->bounds.x1);
+  window.y1 = MAX(bbox.y1 - OBS2_TILE, ctx->bounds.y1);
+  window.x2 = MIN(bbox.x2 + OBS2_TILE, ctx->bounds.x2);
+  window.y2 = MIN(bbox.y2 + OBS2_TILE, ctx->bounds.y2);
+  if ((window.x1 <= window.x2) && (window.y1 <= window.y2))
+     advise_search_window(ctx, &window);
 
   // Heuristic:  Set the initial cost beyond which we stop searching.
   // This value is twice the cost of a direct route across the
@@ -1359,7 +1780,6 @@ int route_segs(NET net, ROUTE rt, u_char stage)
      maxcost /= (n1->numnodes - 1);
   }
 
-  netnum = rt->netnum;
   n1tap = n1->taps;
   if (!do_pwrbus) {
      n2 = n2save;
@@ -1367,52 +1787,76 @@ int route_segs(NET net, ROUTE rt, u_char stage)
   }
 
   if (n1tap == NULL && n1->extend == NULL) {
-     printf("Node of net %s has no tap points---unable to route!\n", n1->netname);
+     fprintf(ctx->log, "Node of net %s has no tap points---unable to route!\n", n1->netname);
      return -1;
   }
   if (n1tap == NULL) n1tap = n1->extend;
 
   if (!do_pwrbus) {
      if (n2tap == NULL && n2->extend == NULL) {
-        printf("Node of net %s has no tap points---unable to route!\n", n2->netname);
+        fprintf(ctx->log, "Node of net %s has no tap points---unable to route!\n", n2->netname);
         return -1;
      }
      if (n2tap == NULL) n2tap = n2->extend;
   }
 
-  printf("Source node @ %gum %gum layer=%d grid=(%d %d)\n",
+  fprintf(ctx->log, "Source node @ %gum %gum layer=%d grid=(%d %d)\n",
 	  n1tap->x, n1tap->y, n1tap->layer,
 	  n1tap->gridx, n1tap->gridy);
   if (!do_pwrbus) {
-     printf("Dest node @ %gum %gum layer=%d grid=(%d %d)\n",
+     fprintf(ctx->log, "Dest node @ %gum %gum layer=%d grid=(%d %d)\n",
 	  n2tap->x, n2tap->y, n2tap->layer,
 	  n2tap->gridx, n2tap->gridy);
   }
-  printf("netname = %s, route number %d\n", n1->netname, TotalRoutes );
-  fflush(stdout);
+  fprintf(ctx->log, "netname = %s, route number %d\n", n1->netname, TotalRoutes );
+  fflush(ctx->log);
+
+  expanded = ctx->expansions;
+  starttime = clock();
 
   for (pass = 0; pass < Numpasses; pass++) {
 
     if (!first) {
-       fprintf(stdout, "\n");
+       fprintf(ctx->log, "\n");
        first = (u_char)1;
     }
-    fprintf(stdout, "Pass %d", pass + 1);
-    fprintf(stdout, " (maxcost is %d)\n", maxcost);
-
-    while (gpoint = glist) {
-
-      glist = gpoint->next;
-
-      curpt.x = gpoint->x1;
-      curpt.y = gpoint->y1;
-      curpt.lay = gpoint->layer;
+    fprintf(ctx->log, "Pass %d", pass + 1);
+    fprintf(ctx->log, " (maxcost is %d)\n", maxcost);
+
+    while (1) {
+
+      if (SearchMode != SEARCH_STACK) {
+	 // Positions beyond maxcost are left on the queue for the
+	 // next pass.  For A* the key is a lower bound on the cost
+	 // of any route through the position.
+	 if (pq_topkey(ctx->queue) > (u_int)maxcost) break;
+	 if (!pq_pop(ctx->queue, &pqe)) break;
+	 gpoint = (POINT)NULL;
+	 curpt.x = pqe.x;
+	 curpt.y = pqe.y;
+	 curpt.lay = pqe.lay;
+      }
+      else {
+	 if ((gpoint = glist) == NULL) break;
+	 glist = gpoint->next;
+	 curpt.x = gpoint->x1;
+	 curpt.y = gpoint->y1;
+	 curpt.lay = gpoint->layer;
+      }
 	
-      Pr = &Obs2[curpt.lay][OGRID(curpt.x, curpt.y, curpt.lay)];
+      Pr = OBS2(ctx, curpt.x, curpt.y, curpt.lay);
 
       // ignore grid positions that have already been processed
       if (Pr->flags & PR_PROCESSED) {
-	 free(gpoint);
+	 point_free(ctx, gpoint);
+	 continue;
+      }
+
+      // ignore positions reset by reset_search_subtree() since they
+      // were queued (never the case except in "search steiner" mode)
+      if (!(Pr->flags & PR_SOURCE) && (!(Pr->flags & PR_COST) ||
+		(Pr->prdata.cost >= MAXRT))) {
+	 point_free(ctx, gpoint);
 	 continue;
       }
 
@@ -1428,13 +1872,13 @@ int route_segs(NET net, ROUTE rt, u_char stage)
 
  	 if (curpt.cost < best.cost) {
 	    if (first) {
-	       fprintf(stdout, "Found a route of cost ");
+	       fprintf(ctx->log, "Found a route of cost ");
 	       first = (u_char)0;
 	    }
 	    else
-	       fprintf(stdout, "|");
-	    fprintf(stdout, "%d", curpt.cost);
-	    fflush(stdout);
+	       fprintf(ctx->log, "|");
+	    fprintf(ctx->log, "%d", curpt.cost);
+	    fflush(ctx->log);
 
 	    // This position may be on a route, not at a terminal, so
 	    // record it.
@@ -1449,7 +1893,11 @@ int route_segs(NET net, ROUTE rt, u_char stage)
 	 }
 
          // Don't continue processing from the target
-	 free(gpoint);
+	 point_free(ctx, gpoint);
+
+	 // In heap mode, every position remaining on the queue costs
+	 // at least as much as this one, so the search is finished.
+	 if (SearchMode != SEARCH_STACK) break;
 	 continue;
       }
 
@@ -1457,32 +1905,46 @@ int route_segs(NET net, ROUTE rt, u_char stage)
 
 	 // Severely limit the search space by not processing anything that
 	 // is not under the current route mask, which identifies a narrow
-	 // "best route" solution.
-
-	 // if (Mask[curpt.lay][OGRID(curpt.x, curpt.y, curpt.lay)] == (u_char)0) {
-	 //    gpoint->next = gunproc;
-	 //    gunproc = gpoint;
-	 //    continue;
-	 // }
+	 // "best route" solution.  Source points are always processed.
+	 // The point is saved on the "unprocessed" stack and picked up on
+	 // the next pass, after the mask has been widened.
+
+	 if (use_mask && !(Pr->flags & PR_SOURCE) &&
+		!MASK_TEST(ctx, curpt.x, curpt.y, curpt.lay)) {
+	    if (gpoint == NULL) {
+	       gpoint = point_alloc(ctx);
+	       gpoint->x1 = curpt.x;
+	       gpoint->y1 = curpt.y;
+	       gpoint->layer = curpt.lay;
+	    }
+	    gpoint->next = gunproc;
+	    gunproc = gpoint;
+	    continue;
+	 }
 
          // Quick check:  Limit maximum cost to limit search space
          // Move the point onto the "unprocessed" stack and we'll pick up
          // from this point on the next pass, if needed.
 
-	 // else
-         if (curpt.cost > maxcost) {
-	    gpoint->next = gunproc;
-	    gunproc = gpoint;
+         else if (curpt.cost > maxcost) {
+	    if (gpoint == NULL)
+	       pq_push(ctx->queue, curpt.x, curpt.y, curpt.lay,
+			search_key(ctx, curpt.x, curpt.y, curpt.lay, curpt.cost));
+	    else {
+	       gpoint->next = gunproc;
+	       gunproc = gpoint;
+	    }
 	    continue;
 	 }
       }
-      free(gpoint);
+      point_free(ctx, gpoint);
+      ctx->expansions++;
 
       // check east/west/north/south, and bottom to top
 
       // 1st optimization:  Direction of route on current layer is preferred.
       o = LefGetRouteOrientation(curpt.lay);
-      forbid = Obs[curpt.lay][OGRID(curpt.x, curpt.y, curpt.lay)] & BLOCKED_MASK;
+      forbid = OBSVAL(curpt.x, curpt.y, curpt.lay) & BLOCKED_MASK;
 
       if (o == 1) {			// horizontal routes---check EAST and WEST first
 	 check_order[0] = (forbid & BLOCKED_E) ? 0 : EAST;
@@ -1511,79 +1973,49 @@ int route_segs(NET net, ROUTE rt, u_char stage)
       for (i = 5; i >= 0; i--) {
 	 switch (check_order[i]) {
 	    case EAST:
-               if ((curpt.x + 1) < NumChannelsX[curpt.lay]) {
-         	  if ((result = eval_pt(&curpt, PR_PRED_W, stage)) == 1) {
-         	     gpoint = (POINT)malloc(sizeof(struct point_));
-         	     gpoint->x1 = curpt.x + 1;
-         	     gpoint->y1 = curpt.y;
-         	     gpoint->layer = curpt.lay;
-         	     gpoint->next = glist;
-         	     glist = gpoint;
+               if (curpt.x < ctx->bounds.x2) {
+         	  if ((result = eval_pt(ctx, &curpt, PR_PRED_W, stage)) == 1) {
+         	     push_point(ctx, &glist, curpt.x + 1, curpt.y, curpt.lay);
                    }
                }
 	       break;
 
 	    case WEST:
-               if ((curpt.x - 1) >= 0) {
-         	  if ((result = eval_pt(&curpt, PR_PRED_E, stage)) == 1) {
-         	     gpoint = (POINT)malloc(sizeof(struct point_));
-         	     gpoint->x1 = curpt.x - 1;
-         	     gpoint->y1 = curpt.y;
-         	     gpoint->layer = curpt.lay;
-         	     gpoint->next = glist;
-         	     glist = gpoint;
+               if (curpt.x > ctx->bounds.x1) {
+         	  if ((result = eval_pt(ctx, &curpt, PR_PRED_E, stage)) == 1) {
+         	     push_point(ctx, &glist, curpt.x - 1, curpt.y, curpt.lay);
                   }
                }
 	       break;
          
 	    case SOUTH:
-               if ((curpt.y - 1) >= 0) {
-         	  if ((result = eval_pt(&curpt, PR_PRED_N, stage)) == 1) {
-         	     gpoint = (POINT)malloc(sizeof(struct point_));
-         	     gpoint->x1 = curpt.x;
-         	     gpoint->y1 = curpt.y - 1;
-         	     gpoint->layer = curpt.lay;
-         	     gpoint->next = glist;
-         	     glist = gpoint;
+               if (curpt.y > ctx->bounds.y1) {
+         	  if ((result = eval_pt(ctx, &curpt, PR_PRED_N, stage)) == 1) {
+         	     push_point(ctx, &glist, curpt.x, curpt.y - 1, curpt.lay);
                    }
                }
 	       break;
 
 	    case NORTH:
-               if ((curpt.y + 1) < NumChannelsY[curpt.lay]) {
-         	  if ((result = eval_pt(&curpt, PR_PRED_S, stage)) == 1) {
-         	     gpoint = (POINT)malloc(sizeof(struct point_));
-         	     gpoint->x1 = curpt.x;
-         	     gpoint->y1 = curpt.y + 1;
-         	     gpoint->layer = curpt.lay;
-         	     gpoint->next = glist;
-         	     glist = gpoint;
+               if (curpt.y < ctx->bounds.y2) {
+         	  if ((result = eval_pt(ctx, &curpt, PR_PRED_S, stage)) == 1) {
+         	     push_point(ctx, &glist, curpt.x, curpt.y + 1, curpt.lay);
                   }
                }
 	       break;
       
 	    case DOWN:
                if (curpt.lay > 0) {
-         	  if ((result = eval_pt(&curpt, PR_PRED_U, stage)) == 1) {
-         	     gpoint = (POINT)malloc(sizeof(struct point_));
-         	     gpoint->x1 = curpt.x;
-         	     gpoint->y1 = curpt.y;
-         	     gpoint->layer = curpt.lay - 1;
-         	     gpoint->next = glist;
-         	     glist = gpoint;
+         	  if ((result = eval_pt(ctx, &curpt, PR_PRED_U, stage)) == 1) {
+         	     push_point(ctx, &glist, curpt.x, curpt.y, curpt.lay - 1);
          	  }
                }
 	       break;
          
 	    case UP:
                if (curpt.lay < (Num_layers - 1)) {
-         	  if ((result = eval_pt(&curpt, PR_PRED_D, stage)) == 1) {
-         	     gpoint = (POINT)malloc(sizeof(struct point_));
-         	     gpoint->x1 = curpt.x;
-         	     gpoint->y1 = curpt.y;
-         	     gpoint->layer = curpt.lay + 1;
-         	     gpoint->next = glist;
-         	     glist = gpoint;
+         	  if ((result = eval_pt(ctx, &curpt, PR_PRED_D, stage)) == 1) {
+         	     push_point(ctx, &glist, curpt.x, curpt.y, curpt.lay + 1);
          	  }
                }
 	       break;
@@ -1598,7 +2030,7 @@ int route_segs(NET net, ROUTE rt, u_char stage)
     while (glist) {
        gpoint = glist;
        glist = glist->next;
-       free(gpoint);
+       point_free(ctx, gpoint);
     }
 
     // If we found a route, save it and return
@@ -1607,9 +2039,11 @@ int route_segs(NET net, ROUTE rt, u_char stage)
 	curpt.x = best.x;
 	curpt.y = best.y;
 	curpt.lay = best.lay;
-	if ((rval = commit_proute(rt, &curpt, stage)) != 1) break;
-	fprintf(stdout, "\nCommit to a route of cost %d\n", best.cost);
-	fprintf(stdout, "Between positions (%d %d) and (%d %d)\n",
+	print_search_rate(ctx, ctx->expansions - expanded,
+		(double)(clock() - starttime) / CLOCKS_PER_SEC);
+	if ((rval = commit_proute(ctx, net, rt, &curpt, stage)) != 1) break;
+	fprintf(ctx->log, "\nCommit to a route of cost %d\n", best.cost);
+	fprintf(ctx->log, "Between positions (%d %d) and (%d %d)\n",
 		best.x, best.y, curpt.x, curpt.y);
 	goto done;	/* route success */
     }
@@ -1622,17 +2056,49 @@ int route_segs(NET net, ROUTE rt, u_char stage)
 					// probably completely hosed long before
 					// this.
 
-    if (gunproc == NULL) break;		// route failure not due to limiting
+    if (SearchMode != SEARCH_STACK) {
+       // Points held back by the mask go back onto the queue
+       while (gunproc) {
+	  gpoint = gunproc;
+	  gunproc = gunproc->next;
+	  pq_push(ctx->queue, gpoint->x1, gpoint->y1, gpoint->layer,
+		search_key(ctx, gpoint->x1, gpoint->y1, gpoint->layer,
+		OBS2(ctx, gpoint->x1, gpoint->y1, gpoint->layer)->prdata.cost));
+	  point_free(ctx, gpoint);
+       }
+       if (pq_empty(ctx->queue)) break;
+    }
+    else if (gunproc == NULL) break;	// route failure not due to limiting
 					// search to maxcost
 
+    // Widen the search area, or remove the mask altogether for the
+    // last pass.
+
+    if (use_mask) {
+       if (pass >= Numpasses - 2) {
+	  fillMask(ctx, 1);
+	  use_mask = FALSE;
+       }
+       else {
+	  expandMask(ctx, maskhalo);
+	  maskhalo <<= 1;
+       }
+    }
+
     // Regenerate the stack of unprocessed nodes
     glist = gunproc;
     gunproc = NULL;
     
   } // pass
   
-  if (!first) fprintf(stdout, "\n");
-  fflush(stdout);
+  if (!first) fprintf(ctx->log, "\n");
+  fflush(ctx->log);
+  rval = -1;
+
+  // A search confined to a region of the parallel first stage is
+  // not a route failure yet;  the caller tries again without bounds.
+  if (ctx->bounded) goto done;
+
   fprintf(stderr, "Fell through %d passes\n", pass);
   if (!do_pwrbus)
      fprintf(stderr, "(%g,%g) <==> (%g,%g) net=%s\n",
@@ -1644,14 +2110,34 @@ int route_segs(NET net, ROUTE rt, u_char stage)
   fprintf(CNfptr, "Route Priority\t%s\n", n1->netname);
   fflush(CNfptr);
   fflush(Failfptr);
-  rval = -1;
 
 done:
-  
+
+  // In "search steiner" mode, leave the search ready to continue from
+  // the route just made toward the remaining targets.
+
+  if ((rval == 1) && steiner) {
+     set_route_to_source(ctx, net, rt, &glist, stage);
+     while (glist) {
+	gpoint = glist;
+	glist = glist->next;
+	Pr = OBS2(ctx, gpoint->x1, gpoint->y1, gpoint->layer);
+	if ((Pr->flags & PR_SOURCE) || (Pr->prdata.cost < MAXRT))
+	   pq_push(ctx->queue, gpoint->x1, gpoint->y1, gpoint->layer,
+		search_key(ctx, gpoint->x1, gpoint->y1, gpoint->layer,
+		(Pr->flags & PR_SOURCE) ? 0 : Pr->prdata.cost));
+	point_free(ctx, gpoint);
+     }
+     ctx->steinernet = net;
+     ctx->steinerstage = stage;
+     ctx->steinerepoch = ctx->epoch;
+  }
+  else
+     pq_clear(ctx->queue);
   while (gunproc) {
      gpoint = gunproc;
      gunproc = gunproc->next;
-     free(gpoint);
+     point_free(ctx, gpoint);
   }
   return rval;
   
@@ -1660,17 +2146,18 @@ done:
 /*--------------------------------------------------------------*/
 /* createemptyroute - begin a ROUTE structure			*/
 /*								*/
-/*   ARGS: a nodes						*/
-/*   RETURNS: ROUTE calloc'd and ready to begin			*/
+/*   ARGS: the net the route belongs to				*/
+/*   RETURNS: ROUTE taken from the net's arena and ready to	*/
+/*	begin							*/
 /*   SIDE EFFECTS: 						*/
 /*   AUTHOR and DATE: steve beccue      Fri Aug 8		*/
 /*--------------------------------------------------------------*/
 
-ROUTE createemptyroute()
+ROUTE createemptyroute(NET net)
 {
   ROUTE rt;
 
-  rt = (ROUTE)calloc(1, sizeof(struct route_));
+  rt = (ROUTE)arena_alloc(net_arena(net), sizeof(struct route_));
   rt->netnum = 0;
   rt->segments = (SEG)NULL;
   rt->output = FALSE;
@@ -1761,25 +2248,25 @@ emit_routed_net(FILE *Cmd, NET net, u_char special, double oscale, int iscale)
 			seg->layer))
 	       layer++;
 
-	    dir1 = Obs[layer][OGRID(seg->x1, seg->y1, layer)];
+	    dir1 = OBSVAL(seg->x1, seg->y1, layer);
 	    dir1 &= PINOBSTRUCTMASK;
 	    if (dir1 && !(seg->segtype & (ST_OFFSET_START | ST_OFFSET_END))) {
 	       stubroute = 1;
 	       if (special == (u_char)0)
 		  fprintf(stdout, "Stub route distance %g to terminal"
 				" at %d %d (%d)\n",
-				Stub[layer][OGRID(seg->x1, seg->y1, layer)],
+				STUB(seg->x1, seg->y1, layer),
 				seg->x1, seg->y1, layer);
 
 	       dc = Xlowerbound + (double)seg->x1 * PitchX[layer];
 	       x = (int)((dc + EPS) * oscale);
 	       if (dir1 == STUBROUTE_EW)
-		  dc += Stub[layer][OGRID(seg->x1, seg->y1, layer)];
+		  dc += STUB(seg->x1, seg->y1, layer);
 	       x2 = (int)((dc + EPS) * oscale);
 	       dc = Ylowerbound + (double)seg->y1 * PitchY[layer];
 	       y = (int)((dc + EPS) * oscale);
 	       if (dir1 == STUBROUTE_NS)
-		  dc += Stub[layer][OGRID(seg->x1, seg->y1, layer)];
+		  dc += STUB(seg->x1, seg->y1, layer);
 	       y2 = (int)((dc + EPS) * oscale);
 	       if (dir1 == STUBROUTE_EW) {
 		  horizontal = TRUE;
@@ -1797,10 +2284,10 @@ emit_routed_net(FILE *Cmd, NET net, u_char special, double oscale, int iscale)
 		  // distinguish routes from taps.
 
 		  if ((x < x2) && (seg->x1 < (NumChannelsX[layer] - 1))) {
-		     tdir = Obs[layer][OGRID(seg->x1 + 1, seg->y1, layer)];
+		     tdir = OBSVAL(seg->x1 + 1, seg->y1, layer);
 		     if ((tdir & ~PINOBSTRUCTMASK) ==
 					(net->netnum | ROUTED_NET)) {
-			if (Stub[layer][OGRID(seg->x1, seg->y1, layer)] +
+			if (STUB(seg->x1, seg->y1, layer) +
 					LefGetRouteKeepout(layer) >= PitchX[layer]) {
 		      	   dc = Xlowerbound + (double)(seg->x1 + 1)
 					* PitchX[layer];
@@ -1809,10 +2296,10 @@ emit_routed_net(FILE *Cmd, NET net, u_char special, double oscale, int iscale)
 		     }
 		  }
 		  else if ((x > x2) && (seg->x1 > 0)) {
-		     tdir = Obs[layer][OGRID(seg->x1 - 1, seg->y1, layer)];
+		     tdir = OBSVAL(seg->x1 - 1, seg->y1, layer);
 		     if ((tdir & ~PINOBSTRUCTMASK) ==
 					(net->netnum | ROUTED_NET)) {
-			if (-Stub[layer][OGRID(seg->x1, seg->y1, layer)] +
+			if (-STUB(seg->x1, seg->y1, layer) +
 					LefGetRouteKeepout(layer) >= PitchX[layer]) {
 		      	   dc = Xlowerbound + (double)(seg->x1 - 1)
 					* PitchX[layer];
@@ -1857,10 +2344,10 @@ emit_routed_net(FILE *Cmd, NET net, u_char special, double oscale, int iscale)
 		  // distance and resolve the error.
 
 		  if ((y < y2) && (seg->y1 < (NumChannelsY[layer] - 1))) {
-		     tdir = Obs[layer][OGRID(seg->x1, seg->y1 + 1, layer)];
+		     tdir = OBSVAL(seg->x1, seg->y1 + 1, layer);
 		     if ((tdir & ~PINOBSTRUCTMASK) ==
 						(net->netnum | ROUTED_NET)) {
-			if (Stub[layer][OGRID(seg->x1, seg->y1, layer)] +
+			if (STUB(seg->x1, seg->y1, layer) +
 					LefGetRouteKeepout(layer) >= PitchY[layer]) {
 		      	   dc = Ylowerbound + (double)(seg->y1 + 1)
 					* PitchY[layer];
@@ -1869,10 +2356,10 @@ emit_routed_net(FILE *Cmd, NET net, u_char special, double oscale, int iscale)
 		     }
 		  }
 		  else if ((y > y2) && (seg->y1 > 0)) {
-		     tdir = Obs[layer][OGRID(seg->x1, seg->y1 - 1, layer)];
+		     tdir = OBSVAL(seg->x1, seg->y1 - 1, layer);
 		     if ((tdir & ~PINOBSTRUCTMASK) ==
 						(net->netnum | ROUTED_NET)) {
-			if (-Stub[layer][OGRID(seg->x1, seg->y1, layer)] +
+			if (-STUB(seg->x1, seg->y1, layer) +
 					LefGetRouteKeepout(layer) >= PitchY[layer]) {
 		      	   dc = Ylowerbound + (double)(seg->y1 - 1)
 					* PitchY[layer];
@@ -1929,16 +2416,15 @@ emit_routed_net(FILE *Cmd, NET net, u_char special, double oscale, int iscale)
 	    dir2 = 0;
 
 	    if (seg->segtype & ST_OFFSET_START) {
-	       dir1 = Obs[seg->layer][OGRID(seg->x1, seg->y1, seg->layer)] &
+	       dir1 = OBSVAL(seg->x1, seg->y1, seg->layer) &
 				PINOBSTRUCTMASK;
 	       if (dir1 == 0 && lastseg) {
-		  dir1 = Obs[lastseg->layer][OGRID(lastseg->x2, lastseg->y2,
-					lastseg->layer)] & PINOBSTRUCTMASK;
-		  offset1 = Stub[lastseg->layer][OGRID(lastseg->x2,
-					lastseg->y2, lastseg->layer)];
+		  dir1 = OBSVAL(lastseg->x2, lastseg->y2,
+					lastseg->layer) & PINOBSTRUCTMASK;
+		  offset1 = STUB(lastseg->x2, lastseg->y2, lastseg->layer);
 	       }
 	       else
-		  offset1 = Stub[seg->layer][OGRID(seg->x1, seg->y1, seg->layer)];
+		  offset1 = STUB(seg->x1, seg->y1, seg->layer);
 
 	       // Additional offset for vias vs. plain route layer
 	       if (seg->segtype & ST_VIA) {
@@ -1958,17 +2444,17 @@ emit_routed_net(FILE *Cmd, NET net, u_char special, double oscale, int iscale)
 	       }
 	    }
 	    if (seg->segtype & ST_OFFSET_END) {
-	       dir2 = Obs[seg->layer][OGRID(seg->x2, seg->y2, seg->layer)] &
+	       dir2 = OBSVAL(seg->x2, seg->y2, seg->layer) &
 				PINOBSTRUCTMASK;
 	       if (dir2 == 0 && seg->next) {
-		  dir2 = Obs[seg->next->layer][OGRID(seg->next->x1,
-					seg->next->y1, seg->next->layer)] &
+		  dir2 = OBSVAL(seg->next->x1,
+					seg->next->y1, seg->next->layer) &
 					PINOBSTRUCTMASK;
-		  offset2 = Stub[seg->next->layer][OGRID(seg->next->x1,
-					seg->next->y1, seg->next->layer)];
+		  offset2 =
+				  STUB(seg->next->x1, seg->next->y1, seg->next->layer);
 	       }
 	       else
-		  offset2 = Stub[seg->layer][OGRID(seg->x2, seg->y2, seg->layer)];
+		  offset2 = STUB(seg->x2, seg->y2, seg->layer);
 
 	       // Additional offset for vias vs. plain route layer
 	       if (seg->segtype & ST_VIA) {
@@ -2059,16 +2545,16 @@ emit_routed_net(FILE *Cmd, NET net, u_char special, double oscale, int iscale)
 		     // that need position offsets to avoid a DRC spacing error
 
 		     if (viaOffsetX[layer][0] > 0) {
-			if (seg->x1 > 0 && ((tdir = (Obs[layer][OGRID(seg->x1 - 1,
-				seg->y1, layer)] & ~PINOBSTRUCTMASK)) != 
+			if (seg->x1 > 0 && ((tdir = (OBSVAL(seg->x1 - 1,
+				seg->y1, layer) & ~PINOBSTRUCTMASK)) != 
 				(net->netnum | ROUTED_NET)) &&
 				((tdir & (ROUTED_NET | NO_NET) == ROUTED_NET))) {
 			   pathvia(Cmd, layer, x + viaOffsetX[layer][0],
 					y, lastx, lasty, seg->x1, seg->y1, invscale);
 			}
 			else if ((seg->x1 < NumChannelsX[layer] - 1)
-				&& ((tdir = (Obs[layer][OGRID(seg->x1 + 1, seg->y1,
-				layer)] & ~PINOBSTRUCTMASK)) != 
+				&& ((tdir = (OBSVAL(seg->x1 + 1, seg->y1,
+				layer) & ~PINOBSTRUCTMASK)) != 
 				(net->netnum | ROUTED_NET)) &&
 				((tdir & (ROUTED_NET | NO_NET) == ROUTED_NET))) {
 			   pathvia(Cmd, layer, x - viaOffsetX[layer][0],
@@ -2079,16 +2565,16 @@ emit_routed_net(FILE *Cmd, NET net, u_char special, double oscale, int iscale)
 					seg->y1, invscale);
 		     }
 		     else if (viaOffsetY[layer][0] > 0) {
-			if (seg->y1 > 0 && ((tdir = (Obs[layer][OGRID(seg->x1,
-				seg->y1 - 1, layer)] & ~PINOBSTRUCTMASK)) != 
+			if (seg->y1 > 0 && ((tdir = (OBSVAL(seg->x1,
+				seg->y1 - 1, layer) & ~PINOBSTRUCTMASK)) != 
 				(net->netnum | ROUTED_NET)) &&
 				((tdir & (ROUTED_NET | NO_NET) == ROUTED_NET))) {
 			   pathvia(Cmd, layer, x, y - viaOffsetY[layer][0],
 					lastx, lasty, seg->x1, seg->y1, invscale);
 			}
 			else if ((seg->y1 < NumChannelsY[layer] - 1)
-				&& ((tdir = (Obs[layer][OGRID(seg->x1, seg->y1 + 1,
-				layer)] & ~PINOBSTRUCTMASK)) != 
+				&& ((tdir = (OBSVAL(seg->x1, seg->y1 + 1,
+				layer) & ~PINOBSTRUCTMASK)) != 
 				(net->netnum | ROUTED_NET)) &&
 				((tdir & (ROUTED_NET | NO_NET) == ROUTED_NET))) {
 			   pathvia(Cmd, layer, x, y - viaOffsetY[layer][0],
@@ -2099,16 +2585,16 @@ emit_routed_net(FILE *Cmd, NET net, u_char special, double oscale, int iscale)
 					seg->y1, invscale);
 		     }
 		     else if (viaOffsetX[layer][1] > 0) {
-			if (seg->x1 > 0 && ((tdir = (Obs[layer + 1][OGRID(seg->x1 - 1,
-				seg->y1, layer + 1)] & ~PINOBSTRUCTMASK)) != 
+			if (seg->x1 > 0 && ((tdir = (OBSVAL(seg->x1 - 1,
+				seg->y1, layer + 1) & ~PINOBSTRUCTMASK)) != 
 				(net->netnum | ROUTED_NET)) &&
 				((tdir & (ROUTED_NET | NO_NET) == ROUTED_NET))) {
 			   pathvia(Cmd, layer, x + viaOffsetX[layer][1],
 					y, lastx, lasty, seg->x1, seg->y1, invscale);
 			}
 			else if ((seg->x1 < NumChannelsX[layer + 1] - 1)
-				&& ((tdir = (Obs[layer + 1][OGRID(seg->x1 + 1, seg->y1,
-				layer + 1)] & ~PINOBSTRUCTMASK)) != 
+				&& ((tdir = (OBSVAL(seg->x1 + 1, seg->y1,
+				layer + 1) & ~PINOBSTRUCTMASK)) != 
 				(net->netnum | ROUTED_NET)) &&
 				((tdir & (ROUTED_NET | NO_NET) == ROUTED_NET))) {
 			   pathvia(Cmd, layer, x - viaOffsetX[layer][1],
@@ -2119,16 +2605,16 @@ emit_routed_net(FILE *Cmd, NET net, u_char special, double oscale, int iscale)
 					seg->y1, invscale);
 		     }
 		     else if (viaOffsetY[layer][1] > 0) {
-			if (seg->y1 > 0 && ((tdir = (Obs[layer + 1][OGRID(seg->x1,
-				seg->y1 - 1, layer + 1)] & ~PINOBSTRUCTMASK)) != 
+			if (seg->y1 > 0 && ((tdir = (OBSVAL(seg->x1,
+				seg->y1 - 1, layer + 1) & ~PINOBSTRUCTMASK)) != 
 				(net->netnum | ROUTED_NET)) &&
 				((tdir & (ROUTED_NET | NO_NET) == ROUTED_NET))) {
 			   pathvia(Cmd, layer, x, y - viaOffsetY[layer][1],
 					lastx, lasty, seg->x1, seg->y1, invscale);
 			}
 			else if ((seg->y1 < NumChannelsY[layer + 1] - 1)
-				&& ((tdir = (Obs[layer][OGRID(seg->x1, seg->y1 + 1,
-				layer + 1)] & ~PINOBSTRUCTMASK)) != 
+				&& ((tdir = (OBSVAL(seg->x1, seg->y1 + 1,
+				layer) & ~PINOBSTRUCTMASK)) != 
 				(net->netnum | ROUTED_NET)) &&
 				((tdir & (ROUTED_NET | NO_NET) == ROUTED_NET))) {
 			   pathvia(Cmd, layer, x, y - viaOffsetY[layer][1],
@@ -2162,25 +2648,25 @@ emit_routed_net(FILE *Cmd, NET net, u_char special, double oscale, int iscale)
 	     cancel = FALSE;
 	     seg = lastseg;
 	     layer = seg->layer;
-	     dir2 = Obs[layer][OGRID(seg->x2, seg->y2, layer)];
+	     dir2 = OBSVAL(seg->x2, seg->y2, layer);
 	     dir2 &= PINOBSTRUCTMASK;
 	     if (dir2 && !(seg->segtype & (ST_OFFSET_END | ST_OFFSET_START))) {
 		stubroute = 1;
 		if (special == (u_char)0)
 		   fprintf(stdout, "Stub route distance %g to terminal"
 				" at %d %d (%d)\n",
-				Stub[layer][OGRID(seg->x2, seg->y2, layer)],
+				STUB(seg->x2, seg->y2, layer),
 				seg->x2, seg->y2, layer);
 
 		dc = Xlowerbound + (double)seg->x2 * PitchX[layer];
 		x = (int)((dc + EPS) * oscale);
 		if (dir2 == STUBROUTE_EW)
-		   dc += Stub[layer][OGRID(seg->x2, seg->y2, layer)];
+		   dc += STUB(seg->x2, seg->y2, layer);
 		x2 = (int)((dc + EPS) * oscale);
 		dc = Ylowerbound + (double)seg->y2 * PitchY[layer];
 		y = (int)((dc + EPS) * oscale);
 		if (dir2 == STUBROUTE_NS)
-		   dc += Stub[layer][OGRID(seg->x2, seg->y2, layer)];
+		   dc += STUB(seg->x2, seg->y2, layer);
 		y2 = (int)((dc + EPS) * oscale);
 		if (dir2 == STUBROUTE_EW) {
 		   horizontal = TRUE;
@@ -2192,10 +2678,10 @@ emit_routed_net(FILE *Cmd, NET net, u_char special, double oscale, int iscale)
 		   // distance and resolve the error.
 
 		   if ((x < x2) && (seg->x2 < (NumChannelsX[layer] - 1))) {
-		      tdir = Obs[layer][OGRID(seg->x2 + 1, seg->y2, layer)];
+		      tdir = OBSVAL(seg->x2 + 1, seg->y2, layer);
 		      if ((tdir & ~PINOBSTRUCTMASK) ==
 						(net->netnum | ROUTED_NET)) {
-			 if (Stub[layer][OGRID(seg->x2, seg->y2, layer)] +
+			 if (STUB(seg->x2, seg->y2, layer) +
 					LefGetRouteKeepout(layer) >= PitchX[layer]) {
 		      	    dc = Xlowerbound + (double)(seg->x2 + 1)
 					* PitchX[layer];
@@ -2204,10 +2690,10 @@ emit_routed_net(FILE *Cmd, NET net, u_char special, double oscale, int iscale)
 		      }
 		   }
 		   else if ((x > x2) && (seg->x2 > 0)) {
-		      tdir = Obs[layer][OGRID(seg->x2 - 1, seg->y2, layer)];
+		      tdir = OBSVAL(seg->x2 - 1, seg->y2, layer);
 		      if ((tdir & ~PINOBSTRUCTMASK) ==
 						(net->netnum | ROUTED_NET)) {
-			 if (-Stub[layer][OGRID(seg->x2, seg->y2, layer)] +
+			 if (-STUB(seg->x2, seg->y2, layer) +
 					LefGetRouteKeepout(layer) >= PitchX[layer]) {
 		      	    dc = Xlowerbound + (double)(seg->x2 - 1)
 					* PitchX[layer];
@@ -2252,10 +2738,10 @@ emit_routed_net(FILE *Cmd, NET net, u_char special, double oscale, int iscale)
 		   // distance and resolve the error.
 
 		   if ((y < y2) && (seg->y2 < (NumChannelsY[layer] - 1))) {
-		      tdir = Obs[layer][OGRID(seg->x2, seg->y2 + 1, layer)];
+		      tdir = OBSVAL(seg->x2, seg->y2 + 1, layer);
 		      if ((tdir & ~PINOBSTRUCTMASK) ==
 						(net->netnum | ROUTED_NET)) {
-			 if (Stub[layer][OGRID(seg->x2, seg->y2, layer)] +
+			 if (STUB(seg->x2, seg->y2, layer) +
 					LefGetRouteKeepout(layer) >= PitchY[layer]) {
 		      	    dc = Ylowerbound + (double)(seg->y2 + 1)
 					* PitchY[layer];
@@ -2264,10 +2750,10 @@ emit_routed_net(FILE *Cmd, NET net, u_char special, double oscale, int iscale)
 		      }
 		   }
 		   else if ((y > y2) && (seg->y2 > 0)) {
-		      tdir = Obs[layer][OGRID(seg->x2, seg->y2 - 1, layer)];
+		      tdir = OBSVAL(seg->x2, seg->y2 - 1, layer);
 		      if ((tdir & ~PINOBSTRUCTMASK) ==
 						(net->netnum | ROUTED_NET)) {
-			 if (-Stub[layer][OGRID(seg->x2, seg->y2, layer)] +
+			 if (-STUB(seg->x2, seg->y2, layer) +
 					LefGetRouteKeepout(layer) >= PitchY[layer]) {
 		      	    dc = Ylowerbound + (double)(seg->y2 - 1)
 					* PitchY[layer];
@@ -2429,10 +2915,7 @@ void emit_routes(char *filename, double oscale, int iscale)
 
        /* Find this net */
 
-       for (net = Nlnets; net; net = net->next) {
-	  if (!strcmp(net->netname, netname))
-	     break;
-       }
+       net = DefFindNet(netname);
        if (!net) {
 	  fprintf(stderr, "emit_routes():  Net %s cannot be found.\n",
 		netname);
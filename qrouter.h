@@ -8,6 +8,35 @@
 #ifndef QROUTER_H
 
 #define OGRID(x, y, layer) ((int)((x) + ((y) * NumChannelsX[(layer)])))
+
+// The search mask of a ROUTECTX is a bitset over the grid positions
+// of each layer
+#define MASK_BYTES(layer) ((NumChannelsX[layer] * NumChannelsY[layer] + 7) >> 3)
+#define MASK_SET(ctx, x, y, layer) ((ctx)->mask[layer][OGRID(x, y, layer) >> 3] \
+		|= (u_char)(1 << (OGRID(x, y, layer) & 7)))
+#define MASK_TEST(ctx, x, y, layer) MASKBITS_TEST((ctx)->mask[layer], x, y, layer)
+#define MASKBITS_TEST(bits, x, y, layer) ((bits)[OGRID(x, y, layer) >> 3] & \
+		(u_char)(1 << (OGRID(x, y, layer) & 7)))
+
+// The obs2 array of a ROUTECTX is laid out in square tiles of
+// OBS2_TILE x OBS2_TILE positions, so that the positions a search
+// reaches, which spread out around its sources, fill few memory pages.
+#define OBS2_SHIFT	4
+#define OBS2_TILE	(1 << OBS2_SHIFT)
+#define OBS2_TILESX(layer) ((NumChannelsX[layer] + OBS2_TILE - 1) >> OBS2_SHIFT)
+#define OBS2_TILESY(layer) ((NumChannelsY[layer] + OBS2_TILE - 1) >> OBS2_SHIFT)
+#define OBS2_SIZE(layer) (OBS2_TILESX(layer) * OBS2_TILESY(layer) << \
+		(2 * OBS2_SHIFT))
+#define O2GRID(x, y, layer) (((((y) >> OBS2_SHIFT) * OBS2_TILESX(layer) + \
+		((x) >> OBS2_SHIFT)) << (2 * OBS2_SHIFT)) | \
+		(((y) & (OBS2_TILE - 1)) << OBS2_SHIFT) | ((x) & (OBS2_TILE - 1)))
+
+// Pointer to the obs2 entry of a ROUTECTX at (x, y, layer), copying it
+// from Obs first if it has not yet been touched in the current search.
+#define OBS2(ctx, x, y, layer) \
+		(((ctx)->obs2[layer][O2GRID(x, y, layer)].epoch == (ctx)->epoch) \
+		? &(ctx)->obs2[layer][O2GRID(x, y, layer)] \
+		: init_obs2(ctx, x, y, layer))
 #define MIN(x, y) (((x) < (y)) ? (x) : (y))
 #define MAX(x, y) (((x) > (y)) ? (x) : (y))
 
@@ -35,9 +64,6 @@ typedef unsigned long  u_long;
 /* Maximum number of route layers */
 #define MAX_LAYERS    9
 
-/* Maximum number of pins in a gate */
-#define MAX_GATE_NODES 64
-
 /* Cell name (and othe names) max length */
 #define MAX_NAME_LEN    64
 
@@ -67,6 +93,21 @@ typedef unsigned long  u_long;
 #define VIA_PATTERN_NORMAL	 0
 #define VIA_PATTERN_INVERT	 1
 
+// define types of wavefront search used by route_segs()
+#define SEARCH_STACK		 0	// Depth-first point stack (original)
+#define SEARCH_HEAP		 1	// Lowest-cost-first (Dijkstra) heap
+#define SEARCH_ASTAR		 2	// Heap keyed on cost plus target estimate
+#define SEARCH_DIAL		 3	// Lowest-cost-first bucket queue
+
+// define keys by which create_netorder() sorts the nets
+#define ORDER_PINS		 0	// Most nodes first (original)
+#define ORDER_LENGTH		 1	// Smallest bounding box first
+#define ORDER_CONGESTION	 2	// Highest estimated congestion first
+
+// define ways of routing the first stage on several threads
+#define PARALLEL_REGIONS	 0	// Nets in separate regions at once
+#define PARALLEL_SPECULATIVE	 1	// Nets in order, committed in order
+
 // define a structure containing x, y, and layer
 
 typedef struct gridp_ GRIDP;
@@ -82,6 +123,7 @@ typedef struct proute_ PROUTE;
 
 struct proute_ {        // partial route
    u_char flags; 	// values PR_PROCESSED and PR_CONFLICT
+   u_short epoch;	// search in which this position was last set up
    union {
       u_int cost;	// cost of route coming from predecessor
       u_int net;	// net number at route point
@@ -186,11 +228,14 @@ struct node_ {
   char    *netname;   		   // name of net this node belongs to
   int     netnum;                  // number of net this node belongs to
   int     numnodes;		   // number of nodes on this net
+  u_int   nodeidx;		   // index in NodeTable (0 if none yet)
 };
 
 // these are instances of gates in the netlist.  The description of a 
 // given gate is gateinfo.  The same structure is used for both the
-// gateinfo and the instances.
+// gateinfo and the instances.  The pin arrays hold "nodes" entries;
+// an instance shares the pin names of its gateinfo, and a gateinfo
+// has no netnum[] or noderec[].
 
 typedef struct gate_ *GATE;
 
@@ -199,11 +244,12 @@ struct gate_ {
     char *gatename;     	     // e.g. x112
     char *gatetype;     	     // e.g. nd02d1
     int  nodes;                      // number of nodes on this gate
-    char *node[MAX_GATE_NODES];	     // names of the pins on this gate
-    int    netnum[MAX_GATE_NODES];   // net number connected to each pin
-    NODE   noderec[MAX_GATE_NODES];  // node record for each pin
-    DSEG   taps[MAX_GATE_NODES];     // list of gate node locations and layers
+    char **node;		     // names of the pins on this gate
+    int    *netnum;		     // net number connected to each pin
+    NODE   *noderec;		     // node record for each pin
+    DSEG   *taps;		     // list of gate node locations and layers
     DSEG   obs;			     // list of obstructions in gate
+    struct hashtable_ *nodetable;    // index of node names (macros only)
     double width, height;
     double placedX;                 
     double placedY;
@@ -219,6 +265,10 @@ struct gate_ {
 // Structure for a network to be routed
 
 typedef struct net_ *NET;
+
+// Arena holding the ROUTE and SEG records of a net (see mem.h)
+
+typedef struct arena_ *ARENA;
 typedef struct netlist_ *NETLIST;
 
 struct net_ {
@@ -234,6 +284,68 @@ struct net_ {
 			// route this net.  This will not be allowed
 			// a second time, to avoid looping.
    ROUTE   routes;	// routes for this net
+   ARENA   arena;	// records of the routes, or NULL if none yet
+};
+
+// State of one wavefront search.  route_segs() and the routines it
+// calls keep everything they change while searching in a ROUTECTX,
+// so that each context can run a search independently of any other.
+// Outside of the context, a search reads Obs[][], Nodeidx[][] and
+// Stub[][], and (stage 0 only) commit_proute() writes the route into
+// Obs[][].  Obs[] is per thread, so that a thread may search against
+// its own copy of the grid (see parallel.c).
+
+typedef struct routectx_ *ROUTECTX;
+
+// Sparse grid of floats (see grid.h)
+
+typedef struct fgrid_ *FGRID;
+
+// Paged grid of u_int (see grid.h)
+
+typedef struct pgrid_ *PGRID;
+
+struct routectx_ {
+   PROUTE  *obs2[MAX_LAYERS];	// working copy of Obs
+   u_short epoch;		// obs2 positions not of this epoch are stale
+   int     netnum;		// net being routed in the current epoch
+   u_char  *mask[MAX_LAYERS];	// search area bitset (corridor search)
+   struct pqueue_ *queue;	// priority queue (all but SEARCH_STACK)
+   NET     curnet;		// net being routed, used by 2nd stage
+   int     pwrbus_src;		// next power bus node to route from
+   FILE    *log;		// stream for messages from the search
+   struct seg_ bounds;		// grid area that the search may use
+   u_char  bounded;		// search run by a worker thread, with
+				// failures and Nodeidx[] changes left
+				// to the caller (see parallel.c)
+   struct seg_ touched;		// extent of positions read by searches
+   struct seg_ window;		// area advised as needed for the last
+				// search, with a scratch directory
+
+   // Target extents and per-axis step costs for the SEARCH_ASTAR estimate
+   struct seg_ targetbox;
+   int     targetlayer1, targetlayer2;
+   int     astarcostx, astarcosty;
+   u_char  useastar;
+
+   // A search left ready by route_segs() to be continued for the next
+   // connection of the same net ("search steiner" mode)
+   NET     steinernet;
+   u_char  steinerstage;
+   u_short steinerepoch;
+
+   // Pool of POINT records (see queue.h)
+   struct pointblock_ *pointblocks;	// all blocks allocated
+   struct pointblock_ *pointcurblock;	// block records are taken from
+   int     pointcurindex;		// next unused record in pointcurblock
+   POINT   pointfreelist;		// records returned by point_free()
+
+   // Statistics
+   long    expansions;		// grid points expanded in route_segs
+   long    reexpansions;	// grid points expanded more than once
+   long    pointallocs;		// POINT records handed out
+   long    pointmallocs;	// POINT blocks allocated with malloc()
+   int     routes;		// routes made by a bounded search
 };
 
 // Flags used by NET "flags" record
@@ -288,21 +400,18 @@ struct netlist_ {
 extern STRING DontRoute;
 extern STRING CriticalNet;
 extern GATE   GateInfo;		// standard cell macro information
-extern NET    CurNet;
 extern NETLIST FailedNets;	// nets that have failed the first pass
 extern NETLIST Abandoned;	// nets that have failed the second pass
 
 extern GATE   Nlgates;
 extern NET    Nlnets;
 
-extern u_int  *Obs[MAX_LAYERS];		// obstructions by layer, y, x
-extern PROUTE *Obs2[MAX_LAYERS]; 	// working copy of Obs 
-extern float  *Obsinfo[MAX_LAYERS];	// temporary detailed obstruction info
-extern float  *Stub[MAX_LAYERS];	// stub route distances to pins
-extern NODE   *Nodeloc[MAX_LAYERS];	// nodes are attached to grid points
-					// for reverse lookup
-extern NODE   *Nodesav[MAX_LAYERS];	// copy of Nodeloc used for restoring
-					// Nodeloc after net rip-up
+extern __thread PGRID Obs[MAX_LAYERS];		// obstructions by layer (see grid.h)
+extern FGRID  Obsinfo[MAX_LAYERS];	// temporary detailed obstruction info
+extern FGRID  Stub[MAX_LAYERS];		// stub route distances to pins
+					// (both sparse, see grid.h)
+extern PGRID  Nodeidx[MAX_LAYERS];	// nodes are attached to grid points
+					// for reverse lookup (see node.h)
 extern DSEG  UserObs;			// user-defined obstruction layers
 
 extern u_char needblockX[MAX_LAYERS];
@@ -320,16 +429,21 @@ extern int    set_num_channels();
 extern int    allocate_obs_array();
 
 NET    getnettoroute();
-void   dosecondstage();
-int    doroute(NET net, u_char stage);
-int    route_segs(NET net, ROUTE rt, u_char stage);
-ROUTE  createemptyroute();
+void   dosecondstage(ROUTECTX ctx);
+NETLIST sortlist(NETLIST net);
+int    doroute(ROUTECTX ctx, NET net, u_char stage);
+int    route_segs(ROUTECTX ctx, NET net, ROUTE rt, u_char stage);
+void   push_point(ROUTECTX ctx, POINT *plist, int x, int y, int lay);
+void   find_target_bounds(ROUTECTX ctx, NODE n1);
+u_int  search_key(ROUTECTX ctx, int x, int y, int lay, u_int cost);
+void   print_search_rate(ROUTECTX ctx, long expanded, double seconds);
+ROUTE  createemptyroute(NET net);
 void   emit_routes(char *filename, double oscale, int iscale);
 
-void   createMask();
-void   fillMask();
-void   setMask();
-void   expandMask();
+void   createMask(ROUTECTX ctx, NET net);
+void   fillMask(ROUTECTX ctx, int value);
+void   setMaskBox(ROUTECTX ctx, int x1, int y1, int x2, int y2, int l);
+void   expandMask(ROUTECTX ctx, int halo);
 
 void   pathstart(FILE *cmd, int layer, int x, int y, u_char special, double oscale,
 			double invscale);
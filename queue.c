@@ -0,0 +1,333 @@
+/*--------------------------------------------------------------*/
+/* queue.c -- priority queue of grid points for the wavefront	*/
+/* search in route_segs()					*/
+/*								*/
+/* Used in place of the point stack when "search mode" is set	*/
+/* to "heap", "astar", or "dial", so that grid positions are	*/
+/* expanded in order of increasing cost and are (normally)	*/
+/* expanded only once.  The queue is either a binary heap or,	*/
+/* since all route costs are small integers, a circular array	*/
+/* of buckets indexed by cost (Dial's algorithm).		*/
+/*--------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "qrouter.h"
+#include "queue.h"
+#include "mem.h"
+
+#define PQ_INITIAL_SIZE	1024
+
+/*--------------------------------------------------------------*/
+/* pq_init --- initialize an empty queue of the given type.	*/
+/*	For PQ_BUCKET, "maxstep" is the largest difference	*/
+/*	expected between the lowest key in the queue and any	*/
+/*	key pushed onto it.					*/
+/*--------------------------------------------------------------*/
+
+void pq_init(PQUEUE pq, u_char type, int maxstep)
+{
+   pq->type = type;
+   pq->entries = (PQENTRY *)NULL;
+   pq->size = 0;
+   pq->alloc = 0;
+   pq->buckets = (PQBUCKET *)NULL;
+   pq->nbuckets = 0;
+   pq->curkey = pq->maxkey = 0;
+   pq->seq = 0;
+
+   if (type == PQ_BUCKET)
+      pq_resize_buckets(pq, (maxstep < 1) ? 2 : maxstep + 1);
+}
+
+/*--------------------------------------------------------------*/
+/* pq_resize_buckets --- (re)allocate the bucket array of a	*/
+/*	PQ_BUCKET queue with "nbuckets" buckets, moving any	*/
+/*	entries already queued into their new buckets.		*/
+/*--------------------------------------------------------------*/
+
+void pq_resize_buckets(PQUEUE pq, int nbuckets)
+{
+   PQBUCKET *oldbuckets;
+   PQENTRY *e;
+   int i, j, oldn;
+
+   oldbuckets = pq->buckets;
+   oldn = pq->nbuckets;
+
+   pq->buckets = (PQBUCKET *)mem_calloc(MEM_SEARCH, nbuckets,
+		sizeof(PQBUCKET));
+   if (pq->buckets == NULL) {
+      fprintf(stderr, "Out of memory in pq_resize_buckets().\n");
+      exit(10);
+   }
+   pq->nbuckets = nbuckets;
+   if (oldbuckets == NULL) return;
+
+   pq->size = 0;
+   for (i = 0; i < oldn; i++) {
+      for (j = oldbuckets[i].first; j < oldbuckets[i].size; j++) {
+	 e = &oldbuckets[i].entries[j];
+	 pq_push(pq, e->x, e->y, e->lay, e->key);
+      }
+      mem_free(MEM_SEARCH, oldbuckets[i].entries,
+		oldbuckets[i].alloc * sizeof(PQENTRY));
+   }
+   mem_free(MEM_SEARCH, oldbuckets, oldn * sizeof(PQBUCKET));
+}
+
+/*--------------------------------------------------------------*/
+/* pq_push --- add a grid position to the queue with the	*/
+/*	given key.  Memory is grown as needed and is not freed	*/
+/*	by pq_clear(), so that repeated searches do not		*/
+/*	repeatedly allocate memory.				*/
+/*--------------------------------------------------------------*/
+
+void pq_push(PQUEUE pq, int x, int y, int lay, u_int key)
+{
+   int i, p, oldalloc;
+   PQENTRY *e;
+   PQBUCKET *b;
+
+   if (pq->type == PQ_BUCKET) {
+      if (pq->size == 0)
+	 pq->curkey = pq->maxkey = key;
+      else {
+	 // Keys outside the span of the bucket array force it to grow
+	 if (key < pq->curkey) {
+	    if (pq->maxkey - key >= pq->nbuckets)
+	       pq_resize_buckets(pq, (pq->maxkey - key + 1) << 1);
+	    pq->curkey = key;
+	 }
+	 else if (key - pq->curkey >= pq->nbuckets)
+	    pq_resize_buckets(pq, (key - pq->curkey + 1) << 1);
+	 if (key > pq->maxkey) pq->maxkey = key;
+      }
+
+      b = &pq->buckets[key % pq->nbuckets];
+      if (b->size == b->alloc) {
+	 oldalloc = b->alloc;
+	 b->alloc = (b->alloc == 0) ? 16 : (b->alloc << 1);
+	 b->entries = (PQENTRY *)mem_realloc(MEM_SEARCH, b->entries,
+		oldalloc * sizeof(PQENTRY), b->alloc * sizeof(PQENTRY));
+	 if (b->entries == NULL) {
+	    fprintf(stderr, "Out of memory in pq_push().\n");
+	    exit(10);
+	 }
+      }
+      e = &b->entries[b->size++];
+      e->key = key;
+      e->seq = pq->seq++;
+      e->x = x;
+      e->y = y;
+      e->lay = lay;
+      pq->size++;
+      return;
+   }
+
+   if (pq->size == pq->alloc) {
+      oldalloc = pq->alloc;
+      pq->alloc = (pq->alloc == 0) ? PQ_INITIAL_SIZE : (pq->alloc << 1);
+      pq->entries = (PQENTRY *)mem_realloc(MEM_SEARCH, pq->entries,
+		oldalloc * sizeof(PQENTRY), pq->alloc * sizeof(PQENTRY));
+      if (pq->entries == NULL) {
+	 fprintf(stderr, "Out of memory in pq_push().\n");
+	 exit(10);
+      }
+   }
+   e = pq->entries;
+
+   // Sift up from the bottom of the heap.  A new entry follows all
+   // those of equal key, which were pushed before it.
+
+   i = pq->size++;
+   while (i > 0) {
+      p = (i - 1) >> 1;
+      if (e[p].key <= key) break;
+      e[i] = e[p];
+      i = p;
+   }
+   e[i].key = key;
+   e[i].seq = pq->seq++;
+   e[i].x = x;
+   e[i].y = y;
+   e[i].lay = lay;
+}
+
+/*--------------------------------------------------------------*/
+/* pq_pop --- remove the entry with the lowest key from the	*/
+/*	queue and copy it into "entry".				*/
+/*								*/
+/*  RETURNS: 1 if an entry was popped, 0 if the queue is empty	*/
+/*--------------------------------------------------------------*/
+
+int pq_pop(PQUEUE pq, PQENTRY *entry)
+{
+   int i, c;
+   PQENTRY *e, last;
+   PQBUCKET *b;
+
+   if (pq->size == 0) return 0;
+
+   if (pq->type == PQ_BUCKET) {
+      // Advance to the first non-empty bucket.  Entries of equal
+      // key are taken first-in, first-out.
+      while ((b = &pq->buckets[pq->curkey % pq->nbuckets])->size == 0)
+	 pq->curkey++;
+      *entry = b->entries[b->first++];
+      if (b->first == b->size) b->first = b->size = 0;
+      pq->size--;
+      return 1;
+   }
+
+   e = pq->entries;
+   *entry = e[0];
+   last = e[--pq->size];
+
+   // Sift the last entry down from the top of the heap
+
+   i = 0;
+   while ((c = (i << 1) + 1) < pq->size) {
+      if ((c + 1 < pq->size) && PQ_BEFORE(e[c + 1], e[c])) c++;
+      if (!PQ_BEFORE(e[c], last)) break;
+      e[i] = e[c];
+      i = c;
+   }
+   e[i] = last;
+   return 1;
+}
+
+/*--------------------------------------------------------------*/
+/* pq_topkey --- return the lowest key in the queue without	*/
+/*	removing it.  Returns MAXRT if the queue is empty.	*/
+/*--------------------------------------------------------------*/
+
+u_int pq_topkey(PQUEUE pq)
+{
+   if (pq->size == 0) return MAXRT;
+
+   if (pq->type == PQ_BUCKET) {
+      while (pq->buckets[pq->curkey % pq->nbuckets].size == 0)
+	 pq->curkey++;
+      return pq->curkey;
+   }
+   return pq->entries[0].key;
+}
+
+/*--------------------------------------------------------------*/
+/* pq_clear --- empty the queue, keeping its memory		*/
+/*--------------------------------------------------------------*/
+
+void pq_clear(PQUEUE pq)
+{
+   int i;
+
+   if (pq->type == PQ_BUCKET && pq->size > 0)
+      for (i = 0; i < pq->nbuckets; i++)
+	 pq->buckets[i].first = pq->buckets[i].size = 0;
+   pq->size = 0;
+   pq->seq = 0;
+}
+
+/*--------------------------------------------------------------*/
+/* pq_free --- free the memory of the queue, leaving it empty	*/
+/*--------------------------------------------------------------*/
+
+void pq_free(PQUEUE pq)
+{
+   int i;
+
+   for (i = 0; i < pq->nbuckets; i++)
+      mem_free(MEM_SEARCH, pq->buckets[i].entries,
+		pq->buckets[i].alloc * sizeof(PQENTRY));
+   mem_free(MEM_SEARCH, pq->buckets, pq->nbuckets * sizeof(PQBUCKET));
+   mem_free(MEM_SEARCH, pq->entries, pq->alloc * sizeof(PQENTRY));
+   pq->buckets = (PQBUCKET *)NULL;
+   pq->entries = (PQENTRY *)NULL;
+   pq->nbuckets = pq->alloc = pq->size = 0;
+}
+
+/*--------------------------------------------------------------*/
+/* point_alloc --- get a POINT record from the pool of "ctx".	*/
+/*	Records returned by point_free() are reused first, then	*/
+/*	unused records of the current block.  A new block is	*/
+/*	malloc'd only when all existing blocks are in use.	*/
+/*--------------------------------------------------------------*/
+
+POINT point_alloc(ROUTECTX ctx)
+{
+   POINT gpoint;
+   POINTBLOCK pb;
+
+   ctx->pointallocs++;
+
+   if (ctx->pointfreelist != NULL) {
+      gpoint = ctx->pointfreelist;
+      ctx->pointfreelist = gpoint->next;
+      return gpoint;
+   }
+
+   if ((ctx->pointcurblock == NULL) ||
+		(ctx->pointcurindex == POINT_BLOCK_SIZE)) {
+      if ((ctx->pointcurblock != NULL) && (ctx->pointcurblock->next != NULL))
+	 ctx->pointcurblock = ctx->pointcurblock->next;
+      else {
+	 pb = (POINTBLOCK)mem_malloc(MEM_SEARCH, sizeof(struct pointblock_));
+	 if (pb == NULL) {
+	    fprintf(stderr, "Out of memory in point_alloc().\n");
+	    exit(10);
+	 }
+	 ctx->pointmallocs++;
+	 pb->next = NULL;
+	 if (ctx->pointcurblock == NULL)
+	    ctx->pointblocks = pb;
+	 else
+	    ctx->pointcurblock->next = pb;
+	 ctx->pointcurblock = pb;
+      }
+      ctx->pointcurindex = 0;
+   }
+   return &ctx->pointcurblock->points[ctx->pointcurindex++];
+}
+
+/*--------------------------------------------------------------*/
+/* point_free --- return a POINT record to the pool of "ctx"	*/
+/*--------------------------------------------------------------*/
+
+void point_free(ROUTECTX ctx, POINT gpoint)
+{
+   if (gpoint == NULL) return;
+   gpoint->next = ctx->pointfreelist;
+   ctx->pointfreelist = gpoint;
+}
+
+/*--------------------------------------------------------------*/
+/* point_pool_reset --- return all POINT records to the pool	*/
+/*	of "ctx".  Blocks are kept for reuse by the next search.	*/
+/*--------------------------------------------------------------*/
+
+void point_pool_reset(ROUTECTX ctx)
+{
+   ctx->pointfreelist = NULL;
+   ctx->pointcurblock = ctx->pointblocks;
+   ctx->pointcurindex = 0;
+}
+
+/*--------------------------------------------------------------*/
+/* point_pool_free --- free all POINT blocks of "ctx"		*/
+/*--------------------------------------------------------------*/
+
+void point_pool_free(ROUTECTX ctx)
+{
+   POINTBLOCK pb;
+
+   while (ctx->pointblocks != NULL) {
+      pb = ctx->pointblocks->next;
+      mem_free(MEM_SEARCH, ctx->pointblocks, sizeof(struct pointblock_));
+      ctx->pointblocks = pb;
+   }
+   point_pool_reset(ctx);
+}
+
+/* end of queue.c */
@@ -0,0 +1,99 @@
+/*--------------------------------------------------------------*/
+/* queue.h -- priority queue of grid points for the wavefront	*/
+/* search in route_segs()					*/
+/*--------------------------------------------------------------*/
+
+#ifndef QUEUE_H
+
+// One queued grid position.  "key" is the cost of the position at
+// the time it was pushed;  if the position is later reached at a
+// lower cost it is pushed again, and the stale entry is discarded
+// when popped because the position has already been processed.
+// Entries of equal key are popped in the order they were pushed,
+// by both queue types, so that the heap and bucket queues expand
+// positions in the same order and find the same routes.
+
+typedef struct pqentry_ PQENTRY;
+
+struct pqentry_ {
+   u_int key;
+   u_int seq;		// order of the push, breaking ties (PQ_HEAP)
+   int   x, y;
+   int   lay;
+};
+
+#define PQ_BEFORE(a, b)	(((a).key < (b).key) || (((a).key == (b).key) && \
+			((a).seq < (b).seq)))
+
+// Queue types
+
+#define PQ_HEAP		0	// Binary heap, lowest key at the top
+#define PQ_BUCKET	1	// Circular bucket queue (Dial's algorithm)
+
+// One bucket of a PQ_BUCKET queue, holding entries of equal key.
+// Entries are taken from "first" on.
+
+typedef struct pqbucket_ PQBUCKET;
+
+struct pqbucket_ {
+   PQENTRY *entries;
+   int     first;
+   int     size;
+   int     alloc;
+};
+
+// Priority queue.  A PQ_HEAP queue keeps its entries in "entries".
+// A PQ_BUCKET queue keeps entries of key K in bucket K % nbuckets,
+// which works as long as no key pushed exceeds the lowest key in the
+// queue by "nbuckets" or more.  That holds when keys are route costs
+// and nbuckets is larger than the most that one step can cost;  if
+// it does not, the bucket array is enlarged.
+
+typedef struct pqueue_ *PQUEUE;
+
+struct pqueue_ {
+   u_char  type;		// PQ_HEAP or PQ_BUCKET
+   PQENTRY *entries;
+   int     size;		// number of entries in the queue
+   int     alloc;		// number of entries allocated (PQ_HEAP)
+   PQBUCKET *buckets;		// bucket array (PQ_BUCKET)
+   int     nbuckets;
+   u_int   curkey;		// lowest key in the queue (PQ_BUCKET)
+   u_int   maxkey;		// highest key pushed (PQ_BUCKET)
+   u_int   seq;			// pushes since the queue was cleared
+};
+
+void	pq_init(PQUEUE pq, u_char type, int maxstep);
+void	pq_push(PQUEUE pq, int x, int y, int lay, u_int key);
+int	pq_pop(PQUEUE pq, PQENTRY *entry);
+u_int	pq_topkey(PQUEUE pq);
+void	pq_clear(PQUEUE pq);
+void	pq_free(PQUEUE pq);
+void	pq_resize_buckets(PQUEUE pq, int nbuckets);
+
+#define pq_empty(pq)	((pq)->size == 0)
+
+// Pool of POINT records, one for each ROUTECTX.  Records are carved
+// out of large blocks and recycled through a free list;
+// point_pool_reset() returns every record to the pool at once, and is
+// called at the start of each route_segs(), since no POINT outlives a
+// single search.
+
+#define POINT_BLOCK_SIZE	4096
+
+typedef struct pointblock_ *POINTBLOCK;
+
+struct pointblock_ {
+   POINTBLOCK next;
+   struct point_ points[POINT_BLOCK_SIZE];
+};
+
+POINT	point_alloc(ROUTECTX ctx);
+void	point_free(ROUTECTX ctx, POINT gpoint);
+void	point_pool_reset(ROUTECTX ctx);
+void	point_pool_free(ROUTECTX ctx);
+
+#define QUEUE_H
+#endif
+
+/* end of queue.h */
@@ -0,0 +1,21 @@
+#!/bin/sh
+#
+# Regression cases for qrouter.  Run from this directory, after
+# building qrouter in the directory above ("make check").
+
+QROUTER=${QROUTER:-../qrouter}
+status=0
+
+# spacing:  negotiated routes must not be written over the grid
+# points that routes of other nets block for spacing.
+
+$QROUTER -c spacing.cfg spacing > spacing.log 2>&1
+if grep -q "is too close to another net" spacing.log; then
+   echo "spacing: passed"
+else
+   echo "spacing: FAILED (no negotiated route held back for spacing)"
+   status=1
+fi
+
+rm -f spacing.log spacing_route.def failed cn
+exit $status